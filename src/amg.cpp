@@ -0,0 +1,346 @@
+//
+//  amg.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include <cassert>
+#include <cmath>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+
+#include "amg.h"
+#include "sparse_product.h"
+#include "solver_stats.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace oocholmod {
+
+    namespace {
+        double secondsSince(steady_clock::time_point start){
+            return duration<double>(steady_clock::now() - start).count();
+        }
+
+        // the diagonal and a Gershgorin bound of the spectral radius of D^-1*A
+        template<typename Int>
+        double diagonal(const cholmod_sparse *A, vector<double>& d){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            long n = A->ncol;
+            d.assign(n, 0);
+            double rho = 0;
+#pragma omp parallel for schedule(static) reduction(max:rho)
+            for (long j = 0; j < n; j++){
+                double sum = 0;
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    if (Ai[k] == j){
+                        d[j] = Ax[k];
+                    }
+                    sum += fabs(Ax[k]);
+                }
+                rho = max(rho, d[j] != 0 ? sum/fabs(d[j]) : 0);
+            }
+            return rho;
+        }
+
+        // Greedy aggregation of the strongly connected unknowns (A holds both triangular parts, so column j lists the
+        // neighbours of j). Returns the number of aggregates.
+        template<typename Int>
+        int aggregate(const cholmod_sparse *A, const vector<double>& d, double theta, vector<int>& aggregates){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            long n = A->ncol;
+            vector<char> strong(Ap[n]);
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long j = 0; j < n; j++){
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    Int i = Ai[k];
+                    strong[k] = i != j && fabs(Ax[k]) >= theta*sqrt(fabs(d[i]*d[j]));
+                }
+            }
+            aggregates.assign(n, -1);
+            int count = 0;
+            // 1. unknowns whose strong neighbours are all free form an aggregate with them
+            for (long j = 0; j < n; j++){
+                if (aggregates[j] != -1){
+                    continue;
+                }
+                bool free = true;
+                for (Int k = Ap[j]; k < Ap[j+1] && free; k++){
+                    free = !strong[k] || aggregates[Ai[k]] == -1;
+                }
+                if (!free){
+                    continue;
+                }
+                aggregates[j] = count;
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    if (strong[k]){
+                        aggregates[Ai[k]] = count;
+                    }
+                }
+                count++;
+            }
+            // 2. the remaining unknowns join an aggregate of a strong neighbour
+            vector<int> first = aggregates;
+            for (long j = 0; j < n; j++){
+                for (Int k = Ap[j]; k < Ap[j+1] && aggregates[j] == -1; k++){
+                    if (strong[k] && first[Ai[k]] != -1){
+                        aggregates[j] = first[Ai[k]];
+                    }
+                }
+            }
+            // 3. the rest form aggregates with their free strong neighbours
+            for (long j = 0; j < n; j++){
+                if (aggregates[j] != -1){
+                    continue;
+                }
+                aggregates[j] = count;
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    if (strong[k] && aggregates[Ai[k]] == -1){
+                        aggregates[Ai[k]] = count;
+                    }
+                }
+                count++;
+            }
+            return count;
+        }
+    }
+
+    AMG::AMG()
+    :initialized{false}
+    {
+    }
+
+    AMG::AMG(AMG&& move)
+    :levels{std::move(move.levels)}, levelInfo{std::move(move.levelInfo)}, coarseFactor{std::move(move.coarseFactor)},
+    options(move.options), initialized{move.initialized}
+    {
+        move.initialized = false;
+    }
+
+    AMG& AMG::operator=(AMG&& other){
+        if (this != &other){
+            levels = std::move(other.levels);
+            levelInfo = std::move(other.levelInfo);
+            coarseFactor = std::move(other.coarseFactor);
+            options = other.options;
+            initialized = other.initialized;
+
+            other.initialized = false;
+        }
+        return *this;
+    }
+
+    bool AMG::isInitialized() const {
+        return initialized;
+    }
+
+    bool AMG::setup(const SparseMatrix& A, const AMGOptions& options){
+#ifdef DEBUG
+        assert(A.getMatrixState() == BUILT);
+        assert(A.getRows() == A.getColumns());
+#endif
+        ScopedTimer timer("amg setup", A.itype());
+        this->options = options;
+        levels.clear();
+        levelInfo.clear();
+        initialized = false;
+        SparseMatrix fine = A.copy();
+        fine.expand();
+        IndexType indexType = A.getIndexType();
+        vector<double> d;
+        vector<int> aggregates;
+        while (true){
+            steady_clock::time_point start = steady_clock::now();
+            Level level;
+            level.A = std::move(fine);
+            int n = level.A.getRows();
+            double rho = indexType == INDEX_LONG ? diagonal<SuiteSparse_long>(level.A.sparse, d) : diagonal<int>(level.A.sparse, d);
+            level.inverseDiagonal = DenseMatrix(n, 1);
+            for (int i = 0; i < n; i++){
+                level.inverseDiagonal(i) = d[i] != 0 ? 1/d[i] : 0;
+            }
+            level.x = DenseMatrix(n, 1, 0.);
+            level.b = DenseMatrix(n, 1, 0.);
+            level.r = DenseMatrix(n, 1, 0.);
+            AMGLevelInfo info = {n, level.A.getNumberOfElements(), 0, 0};
+            bool coarsest = n <= options.maxCoarseSize || (int)levels.size() + 1 >= options.maxLevels;
+            int coarse = 0;
+            if (!coarsest){
+                coarse = indexType == INDEX_LONG ? aggregate<SuiteSparse_long>(level.A.sparse, d, options.strengthThreshold, aggregates)
+                : aggregate<int>(level.A.sparse, d, options.strengthThreshold, aggregates);
+                coarsest = coarse == 0 || coarse >= n;
+            }
+            if (coarsest){
+                SparseMatrix upper = level.A.copy();
+                upper.symmetrize();
+                coarseFactor = upper.analyze();
+                bool factorized = coarseFactor.factorize(upper);
+                info.setupTime = secondsSince(start);
+                levels.push_back(std::move(level));
+                levelInfo.push_back(info);
+                timer.setSuccess(factorized);
+                initialized = factorized;
+                return factorized;
+            }
+            // tentative prolongation: the normalized indicator of each aggregate
+            vector<int> size(coarse, 0);
+            for (int a : aggregates){
+                size[a]++;
+            }
+            SparseMatrix T{static_cast<unsigned int>(n), static_cast<unsigned int>(coarse), false, static_cast<size_t>(n), indexType};
+            for (int i = 0; i < n; i++){
+                T(i, aggregates[i]) = 1/sqrt((double)size[aggregates[i]]);
+            }
+            T.build();
+            // P = T - weight/rho * D^-1*A*T
+            SpGEMMPlan product;
+            SparseMatrix AT = product.analyze(level.A, T);
+            DenseMatrix rowScale(n, 1);
+            for (int i = 0; i < n; i++){
+                rowScale(i) = -options.prolongationWeight/rho*level.inverseDiagonal(i);
+            }
+            AT.scale(rowScale, DenseMatrix(coarse, 1, 1.));
+            level.P = std::move(AT) + T;
+            level.R = transposed(level.P);
+            SpGEMMPlan galerkin;
+            fine = galerkin.analyzeGalerkin(level.P, level.A);
+            info.setupTime = secondsSince(start);
+            levels.push_back(std::move(level));
+            levelInfo.push_back(info);
+        }
+    }
+
+    void AMG::resetSolveTimes(){
+        for (AMGLevelInfo& info : levelInfo){
+            info.solveTime = 0;
+        }
+    }
+
+    // damped Jacobi: x += weight*D^-1*(b - A*x)
+    void AMG::smooth(Level& level, bool zeroGuess){
+        long n = level.A.getRows();
+        double weight = options.jacobiWeight;
+        double *x = level.x.getData();
+        const double *b = level.b.getData();
+        double *r = level.r.getData();
+        const double *inverseDiagonal = level.inverseDiagonal.getData();
+        for (int step = 0; step < options.smoothingSteps; step++){
+            if (zeroGuess && step == 0){
+#pragma omp parallel for schedule(static)
+                for (long i = 0; i < n; i++){
+                    x[i] = weight*inverseDiagonal[i]*b[i];
+                }
+                continue;
+            }
+            level.r.set(b);
+            multiply(level.A, level.x, level.r, -1, 1, true);
+#pragma omp parallel for schedule(static)
+            for (long i = 0; i < n; i++){
+                x[i] += weight*inverseDiagonal[i]*r[i];
+            }
+        }
+    }
+
+    void AMG::cycle(size_t l){
+        steady_clock::time_point start = steady_clock::now();
+        Level& level = levels[l];
+        if (l + 1 == levels.size()){
+            solve(coarseFactor, level.b, level.x);
+            levelInfo[l].solveTime += secondsSince(start);
+            return;
+        }
+        Level& next = levels[l+1];
+        smooth(level, true);
+        level.r.set(level.b.getData());
+        multiply(level.A, level.x, level.r, -1, 1, true);
+        multiply(level.P, level.r, next.b, 1, 0, true);
+        levelInfo[l].solveTime += secondsSince(start);
+        cycle(l + 1);
+        start = steady_clock::now();
+        multiply(level.R, next.x, level.x, 1, 1, true);
+        smooth(level, false);
+        levelInfo[l].solveTime += secondsSince(start);
+    }
+
+    void AMG::apply(const DenseMatrix& b, DenseMatrix& x){
+#ifdef DEBUG
+        assert(initialized);
+        assert(b.getRows() == levels[0].A.getRows() && b.getColumns() == 1);
+        assert(x.getRows() == b.getRows() && x.getColumns() == 1);
+#endif
+        levels[0].b.set(b.getData());
+        cycle(0);
+        x.set(levels[0].x.getData());
+    }
+
+    DenseMatrix solve(AMG& M, const DenseMatrix& b, RefinementInfo *info, int maxIterations, double tolerance){
+#ifdef DEBUG
+        assert(M.initialized);
+        assert(b.getRows() == M.levels[0].A.getRows() && b.getColumns() == 1);
+#endif
+        ScopedTimer timer("amg pcg", M.levels[0].A.getIndexType() == INDEX_LONG ? CHOLMOD_LONG : CHOLMOD_INT);
+        const SparseMatrix& A = M.levels[0].A;
+        long n = b.getRows();
+        DenseMatrix x(n, 1, 0.);
+        DenseMatrix r = b.copy();
+        DenseMatrix z(n, 1);
+        DenseMatrix p(n, 1);
+        DenseMatrix q(n, 1);
+        double *xData = x.getData(), *rData = r.getData(), *zData = z.getData(), *pData = p.getData(), *qData = q.getData();
+        double bNorm = b.length();
+        double residual = bNorm > 0 ? 1 : 0;
+        int iteration = 0;
+        if (bNorm > 0){
+            M.apply(r, z);
+            p.set(zData);
+            double rz = r.dot(z);
+            while (iteration < maxIterations && residual >= tolerance){
+                iteration++;
+                multiply(A, p, q, 1, 0, true); // A' = A
+                double alpha = rz/p.dot(q);
+#pragma omp parallel for schedule(static)
+                for (long i = 0; i < n; i++){
+                    xData[i] += alpha*pData[i];
+                    rData[i] -= alpha*qData[i];
+                }
+                residual = r.length()/bNorm;
+                if (residual < tolerance){
+                    break;
+                }
+                M.apply(r, z);
+                double rzNext = r.dot(z);
+                double beta = rzNext/rz;
+                rz = rzNext;
+#pragma omp parallel for schedule(static)
+                for (long i = 0; i < n; i++){
+                    pData[i] = zData[i] + beta*pData[i];
+                }
+            }
+        }
+        timer.setSuccess(residual < tolerance);
+        if (info){
+            info->iterations = iteration;
+            info->residual = residual;
+            info->converged = residual < tolerance;
+        }
+        return x;
+    }
+
+    ostream& operator<<(ostream& os, const AMG& M){
+        const vector<AMGLevelInfo>& levels = M.getLevelInfo();
+        os << "level        rows    elements   setup (s)   solve (s)" << endl;
+        for (size_t l = 0; l < levels.size(); l++){
+            os << setw(5) << l << setw(12) << levels[l].rows << setw(12) << levels[l].elements
+               << setw(12) << levels[l].setupTime << setw(12) << levels[l].solveTime << endl;
+        }
+        return os;
+    }
+}
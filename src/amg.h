@@ -0,0 +1,94 @@
+//
+//  amg.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <vector>
+#include <iostream>
+
+#include "sparse_matrix.h"
+#include "dense_matrix.h"
+#include "factor.h"
+
+namespace oocholmod {
+
+    struct AMGOptions {
+        double strengthThreshold;   // i and j are strongly connected if |a_ij| >= strengthThreshold*sqrt(|a_ii*a_jj|)
+        int maxLevels;
+        int maxCoarseSize;          // a level with at most this many rows is the coarsest (and is factorized)
+        double jacobiWeight;        // weight of the damped Jacobi smoother
+        int smoothingSteps;         // number of pre- and post-smoothing steps
+        double prolongationWeight;  // P = (I - prolongationWeight/rho(D^-1*A) * D^-1*A) * T
+        AMGOptions()
+        :strengthThreshold{0.08}, maxLevels{10}, maxCoarseSize{1000}, jacobiWeight{2.0/3.0}, smoothingSteps{1},
+        prolongationWeight{4.0/3.0}
+        {
+        }
+    };
+
+    struct AMGLevelInfo {
+        int rows;
+        size_t elements;    // number of elements of the level matrix (both triangular parts)
+        double setupTime;   // seconds to build the level (or to factorize the coarsest level)
+        double solveTime;   // seconds spent on the level in all V-cycles since setup() or resetSolveTimes()
+    };
+
+    /// Smoothed aggregation algebraic multigrid for symmetric positive definite matrices (such as Poisson problems
+    /// too large to factorize). setup() aggregates the strongly connected unknowns of each level, smooths the piecewise
+    /// constant prolongation with damped Jacobi and computes the next level with the fused Galerkin product P'AP
+    /// (see SpGEMMPlan) until the level is small enough to be factorized with a Factor.
+    ///
+    /// A V-cycle (apply) uses damped Jacobi smoothing. The level matrices are stored with both triangular parts, so
+    /// smoothing, restriction and prolongation all use the parallel transposed product of multiply().
+    /// Use it as a preconditioner, for instance with the conjugate gradient solve below.
+    class AMG {
+    public:
+        AMG();
+        AMG(AMG&& move);
+        AMG& operator=(AMG&& other);
+
+        /// Builds the hierarchy. Returns false if the coarsest level could not be factorized.
+        bool setup(const SparseMatrix& A, const AMGOptions& options = AMGOptions());
+
+        /// x = one V-cycle (starting from zero) applied to the column vector b, an approximation of A^-1 b
+        void apply(const DenseMatrix& b, DenseMatrix& x);
+
+        friend DenseMatrix solve(AMG& M, const DenseMatrix& b, RefinementInfo *info, int maxIterations, double tolerance);
+
+        int getNumberOfLevels() const { return static_cast<int>(levels.size()); }
+        const std::vector<AMGLevelInfo>& getLevelInfo() const { return levelInfo; }
+        void resetSolveTimes();
+
+        bool isInitialized() const;
+    private:
+        AMG(const AMG& that) = delete; // prevent copy constructor
+        struct Level {
+            SparseMatrix A;                 // both triangular parts
+            SparseMatrix P;                 // prolongation from the next level
+            SparseMatrix R;                 // P'
+            DenseMatrix inverseDiagonal;
+            DenseMatrix x, b, r;
+        };
+        void cycle(size_t level);
+        void smooth(Level& level, bool zeroGuess);
+        std::vector<Level> levels;
+        std::vector<AMGLevelInfo> levelInfo;
+        Factor coarseFactor;
+        AMGOptions options;
+        bool initialized;
+    };
+
+    /// Solves Ax=b with the conjugate gradient method preconditioned by V-cycles of M, where A is the matrix M was set
+    /// up with. Iterates until the relative residual |b-Ax|/|b| is below tolerance. If info is given it reports the
+    /// number of iterations, the relative residual and whether the iteration converged.
+    DenseMatrix solve(AMG& M, const DenseMatrix& b, RefinementInfo *info = nullptr, int maxIterations = 200,
+                      double tolerance = 1e-8);
+
+    // Print the levels, their sizes and times
+    std::ostream& operator<<(std::ostream& os, const AMG& M);
+}
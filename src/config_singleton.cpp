@@ -15,6 +15,7 @@ namespace oocholmod {
     using namespace std;
     
     unique_ptr<cholmod_common> common;
+    unique_ptr<cholmod_common> longCommon;
     
     void ConfigSingleton::config(cholmod_common *config){
         destroy();
@@ -30,11 +31,27 @@ namespace oocholmod {
         return common.get();
     }
     
+    cholmod_common *ConfigSingleton::getLongCommonPtr(){
+        if (!longCommon.get()){
+            longCommon.reset(new cholmod_common());
+            cholmod_l_start(longCommon.get());
+        }
+        return longCommon.get();
+    }
+    
+    cholmod_common *ConfigSingleton::getCommonPtr(int itype){
+        return itype == CHOLMOD_LONG ? getLongCommonPtr() : getCommonPtr();
+    }
+    
     void ConfigSingleton::destroy(){
         if (common.get()){
             cholmod_finish(common.get()) ;
             common.reset(nullptr);
         }
+        if (longCommon.get()){
+            cholmod_l_finish(longCommon.get());
+            longCommon.reset(nullptr);
+        }
     }
 }
 
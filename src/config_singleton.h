@@ -17,8 +17,18 @@ namespace oocholmod {
     public:
         static void config(cholmod_common *);
         static cholmod_common *getCommonPtr();
+        /// Common used by the cholmod_l_* functions (matrices and factors with 64 bit indices)
+        static cholmod_common *getLongCommonPtr();
+        /// Returns the common matching the itype (CHOLMOD_INT or CHOLMOD_LONG) of a cholmod object
+        static cholmod_common *getCommonPtr(int itype);
         static void destroy();
     private:
     };
     
-}
\ No newline at end of file
+}
+
+/// Calls cholmod_<function> or cholmod_l_<function> depending on itype (CHOLMOD_INT or CHOLMOD_LONG). The
+/// matching common is appended to the arguments.
+#define OOCHOLMOD_CALL(itype, function, ...) \
+    ((itype) == CHOLMOD_LONG ? cholmod_l_##function(__VA_ARGS__, oocholmod::ConfigSingleton::getLongCommonPtr()) \
+                             : cholmod_##function(__VA_ARGS__, oocholmod::ConfigSingleton::getCommonPtr()))
@@ -0,0 +1,181 @@
+//
+//  dense_factor.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#ifdef NO_LAPACK
+#include "oo_lapack.h"
+#else
+#include <clapack.h>
+#endif
+
+#include "dense_factor.h"
+
+using namespace std;
+
+namespace oocholmod {
+    
+    static_assert(sizeof(__CLPK_integer) == sizeof(int), "pivots are stored as int");
+    
+    DenseLU::DenseLU()
+    :factorized{false}
+    {
+    }
+    
+    DenseLU::DenseLU(DenseLU&& move)
+    :LU{std::move(move.LU)}, pivots{std::move(move.pivots)}, factorized{move.factorized}
+    {
+        move.factorized = false;
+    }
+    
+    DenseLU& DenseLU::operator=(DenseLU&& other){
+        if (this != &other){
+            LU = std::move(other.LU);
+            pivots = std::move(other.pivots);
+            factorized = other.factorized;
+            
+            other.factorized = false;
+        }
+        return *this;
+    }
+    
+    bool DenseLU::isInitialized() const {
+        return factorized;
+    }
+    
+    bool DenseLU::factorize(const DenseMatrix& A){
+        LU = A.copy();
+        return factorize();
+    }
+    
+    bool DenseLU::factorize(DenseMatrix&& A){
+        LU = A.isView() ? A.copy() : std::move(A); // the data of a view belongs to another matrix
+        return factorize();
+    }
+    
+    bool DenseLU::factorize(){
+#ifdef DEBUG
+        assert(LU.getRows() == LU.getColumns());
+#endif
+        __CLPK_integer N = LU.getRows();
+        __CLPK_integer lda = LU.getLeadingDimension();
+        __CLPK_integer info;
+        pivots.resize(N);
+        dgetrf_(&N, &N, LU.getData(), &lda, (__CLPK_integer*)pivots.data(), &info);
+        factorized = info == 0;
+        return factorized;
+    }
+    
+    void DenseLU::solveInPlace(DenseMatrix& b) const {
+#ifdef DEBUG
+        assert(factorized);
+        assert(b.getRows() == LU.getRows());
+#endif
+        char trans = 'N';
+        __CLPK_integer N = LU.getRows();
+        __CLPK_integer nrhs = b.getColumns();
+        __CLPK_integer lda = LU.getLeadingDimension();
+        __CLPK_integer ldb = b.getLeadingDimension();
+        __CLPK_integer info;
+        dgetrs_(&trans, &N, &nrhs, LU.getData(), &lda, (__CLPK_integer*)pivots.data(), b.getData(), &ldb, &info);
+#ifdef DEBUG
+        assert(info == 0);
+#endif
+    }
+    
+    DenseMatrix solve(const DenseLU& F, const DenseMatrix& b){
+        DenseMatrix x = b.copy();
+        F.solveInPlace(x);
+        return x;
+    }
+    
+    DenseMatrix&& solve(const DenseLU& F, DenseMatrix&& b){
+        if (b.isView()){
+            b = b.copy(); // the data of a view belongs to another matrix
+        }
+        F.solveInPlace(b);
+        return move(b);
+    }
+    
+    DenseCholesky::DenseCholesky()
+    :factorized{false}
+    {
+    }
+    
+    DenseCholesky::DenseCholesky(DenseCholesky&& move)
+    :L{std::move(move.L)}, factorized{move.factorized}
+    {
+        move.factorized = false;
+    }
+    
+    DenseCholesky& DenseCholesky::operator=(DenseCholesky&& other){
+        if (this != &other){
+            L = std::move(other.L);
+            factorized = other.factorized;
+            
+            other.factorized = false;
+        }
+        return *this;
+    }
+    
+    bool DenseCholesky::isInitialized() const {
+        return factorized;
+    }
+    
+    bool DenseCholesky::factorize(const DenseMatrix& A){
+        L = A.copy();
+        return factorize();
+    }
+    
+    bool DenseCholesky::factorize(DenseMatrix&& A){
+        L = A.isView() ? A.copy() : std::move(A); // the data of a view belongs to another matrix
+        return factorize();
+    }
+    
+    bool DenseCholesky::factorize(){
+#ifdef DEBUG
+        assert(L.getRows() == L.getColumns());
+#endif
+        char uplo = 'L';
+        __CLPK_integer N = L.getRows();
+        __CLPK_integer lda = L.getLeadingDimension();
+        __CLPK_integer info;
+        dpotrf_(&uplo, &N, L.getData(), &lda, &info);
+        factorized = info == 0;
+        return factorized;
+    }
+    
+    void DenseCholesky::solveInPlace(DenseMatrix& b) const {
+#ifdef DEBUG
+        assert(factorized);
+        assert(b.getRows() == L.getRows());
+#endif
+        char uplo = 'L';
+        __CLPK_integer N = L.getRows();
+        __CLPK_integer nrhs = b.getColumns();
+        __CLPK_integer lda = L.getLeadingDimension();
+        __CLPK_integer ldb = b.getLeadingDimension();
+        __CLPK_integer info;
+        dpotrs_(&uplo, &N, &nrhs, L.getData(), &lda, b.getData(), &ldb, &info);
+#ifdef DEBUG
+        assert(info == 0);
+#endif
+    }
+    
+    DenseMatrix solve(const DenseCholesky& F, const DenseMatrix& b){
+        DenseMatrix x = b.copy();
+        F.solveInPlace(x);
+        return x;
+    }
+    
+    DenseMatrix&& solve(const DenseCholesky& F, DenseMatrix&& b){
+        if (b.isView()){
+            b = b.copy(); // the data of a view belongs to another matrix
+        }
+        F.solveInPlace(b);
+        return move(b);
+    }
+}
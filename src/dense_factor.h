@@ -0,0 +1,79 @@
+//
+//  dense_factor.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <vector>
+
+#include "dense_matrix.h"
+
+namespace oocholmod {
+    
+    /// LU factorization (with partial pivoting) of a square DenseMatrix.
+    /// Factorize once and solve with any number of right hand sides.
+    class DenseLU {
+    public:
+        DenseLU();
+        DenseLU(DenseLU&& move);
+        DenseLU& operator=(DenseLU&& other);
+        
+        // returns true if factorization is done
+        // Return false if matrix is singular
+        bool factorize(const DenseMatrix& A);
+        // factorizes A in place (avoids copying A)
+        bool factorize(DenseMatrix&& A);
+        
+        // overwrites b with the solution of Ax=b (b may contain multiple right hand sides)
+        void solveInPlace(DenseMatrix& b) const;
+        
+        friend DenseMatrix solve(const DenseLU& F, const DenseMatrix& b);
+        friend DenseMatrix&& solve(const DenseLU& F, DenseMatrix&& b);
+        
+        bool isInitialized() const;
+    private:
+        DenseLU(const DenseLU& that) = delete; // prevent copy constructor
+        bool factorize();
+        DenseMatrix LU;
+        std::vector<int> pivots;
+        bool factorized;
+    };
+    
+    /// Cholesky factorization of a symmetric positive definite DenseMatrix (only the lower triangle is used).
+    /// Factorize once and solve with any number of right hand sides.
+    class DenseCholesky {
+    public:
+        DenseCholesky();
+        DenseCholesky(DenseCholesky&& move);
+        DenseCholesky& operator=(DenseCholesky&& other);
+        
+        // returns true if factorization is done
+        // Return false if matrix is not positive definite
+        bool factorize(const DenseMatrix& A);
+        // factorizes A in place (avoids copying A)
+        bool factorize(DenseMatrix&& A);
+        
+        // overwrites b with the solution of Ax=b (b may contain multiple right hand sides)
+        void solveInPlace(DenseMatrix& b) const;
+        
+        friend DenseMatrix solve(const DenseCholesky& F, const DenseMatrix& b);
+        friend DenseMatrix&& solve(const DenseCholesky& F, DenseMatrix&& b);
+        
+        bool isInitialized() const;
+    private:
+        DenseCholesky(const DenseCholesky& that) = delete; // prevent copy constructor
+        bool factorize();
+        DenseMatrix L;
+        bool factorized;
+    };
+    
+    DenseMatrix solve(const DenseLU& F, const DenseMatrix& b);
+    DenseMatrix&& solve(const DenseLU& F, DenseMatrix&& b);
+    
+    DenseMatrix solve(const DenseCholesky& F, const DenseMatrix& b);
+    DenseMatrix&& solve(const DenseCholesky& F, DenseMatrix&& b);
+}
@@ -16,16 +16,51 @@
 #include <clapack.h>
 #endif
 
+#include <vector>
+
 #include "dense_matrix.h"
 #include "config_singleton.h"
 #include "sparse_matrix.h"
+#include "float_dense_matrix.h"
 
 using namespace std;
 
 namespace oocholmod {
+    
+    namespace {
+        // y = alpha*x + y, column by column unless both matrices are stored contiguously
+        void axpy(unsigned int nrow, unsigned int ncol, double alpha, const double *x, size_t ldx, double *y, size_t ldy){
+            if ((ldx == nrow && ldy == nrow) || ncol == 1){
+                cblas_daxpy(nrow*ncol, alpha, x, 1, y, 1);
+                return;
+            }
+            for (unsigned int c = 0; c < ncol; c++){
+                cblas_daxpy(nrow, alpha, x + c*ldx, 1, y + c*ldy, 1);
+            }
+        }
+        
+        // x = alpha*x
+        void scal(unsigned int nrow, unsigned int ncol, double alpha, double *x, size_t ldx){
+            if (ldx == nrow || ncol == 1){
+                cblas_dscal(nrow*ncol, alpha, x, 1);
+                return;
+            }
+            for (unsigned int c = 0; c < ncol; c++){
+                cblas_dscal(nrow, alpha, x + c*ldx, 1);
+            }
+        }
+        
+        // The rvalue overloads reuse the data of their temporary argument. A view (such as A.column(0)) is a
+        // temporary as well, but its data belongs to another matrix, so it is replaced by a copy first.
+        void ownData(DenseMatrix& M){
+            if (M.isView()){
+                M = M.copy();
+            }
+        }
+    }
    
     DenseMatrix::DenseMatrix(unsigned int rows, unsigned int cols, double value)
-    :nrow{rows}, ncol{cols}
+    :nrow{rows}, ncol{cols}, view{false}
     {
         dense = cholmod_allocate_dense(rows, cols, rows /* leading dimension (equal rows) */ , CHOLMOD_REAL, ConfigSingleton::getCommonPtr());
         if (!std::isnan(value)) {
@@ -38,57 +73,117 @@ namespace oocholmod {
     }
     
     DenseMatrix::DenseMatrix(cholmod_dense *dense_)
-    :dense{dense_}, nrow{static_cast<unsigned int>(dense_->nrow)}, ncol{static_cast<unsigned int>(dense_->ncol)}
+    :dense{dense_}, nrow{static_cast<unsigned int>(dense_->nrow)}, ncol{static_cast<unsigned int>(dense_->ncol)}, view{false}
+    {
+    }
+    
+    DenseMatrix::DenseMatrix(double *data, unsigned int rows, unsigned int cols, unsigned int ld)
+    :dense{new cholmod_dense()}, nrow{rows}, ncol{cols}, view{true}
     {
+#ifdef DEBUG
+        assert(data || rows*cols == 0);
+        assert(ld == 0 || ld >= rows);
+#endif
+        dense->nrow = rows;
+        dense->ncol = cols;
+        dense->d = ld == 0 ? rows : ld;
+        dense->nzmax = dense->d*cols;
+        dense->x = data;
+        dense->z = nullptr;
+        dense->xtype = CHOLMOD_REAL;
+        dense->dtype = CHOLMOD_DOUBLE;
     }
     
     DenseMatrix::DenseMatrix(DenseMatrix&& move)
-    :dense{move.dense}, nrow{move.nrow}, ncol{move.ncol}
+    :dense{move.dense}, nrow{move.nrow}, ncol{move.ncol}, view{move.view}
     {
         move.dense = nullptr;
         move.nrow = 0;
         move.ncol = 0;
+        move.view = false;
     }
     
     DenseMatrix& DenseMatrix::operator=(DenseMatrix&& other)
     {
         if (this != &other)
         {
-            if (dense){
-                cholmod_free_dense(&dense, ConfigSingleton::getCommonPtr());
-            }
+            releaseDense();
             dense = other.dense;
             nrow = other.nrow;
             ncol = other.ncol;
+            view = other.view;
             
             other.dense = nullptr;
             other.nrow = 0;
             other.ncol = 0;
+            other.view = false;
         }
         return *this;
     }
     
     DenseMatrix::~DenseMatrix()
     {
-        if (dense){
+        releaseDense();
+    }
+    
+    void DenseMatrix::releaseDense(){
+        if (view){
+            delete dense; // only the header is owned by a view
+        } else if (dense){
             cholmod_free_dense(&dense, ConfigSingleton::getCommonPtr());
-            dense = nullptr;
         }
+        dense = nullptr;
+        view = false;
+    }
+    
+    DenseMatrix DenseMatrix::block(unsigned int row, unsigned int col, unsigned int rows, unsigned int cols) {
+#ifdef DEBUG
+        assert(dense);
+        assert(row + rows <= nrow && col + cols <= ncol);
+#endif
+        return DenseMatrix(getData() + col*dense->d + row, rows, cols, static_cast<unsigned int>(dense->d));
+    }
+    
+    DenseMatrix DenseMatrix::columnBlock(unsigned int firstColumn, unsigned int columns) {
+        return block(0, firstColumn, nrow, columns);
+    }
+    
+    DenseMatrix DenseMatrix::rowBlock(unsigned int firstRow, unsigned int rows) {
+        return block(firstRow, 0, rows, ncol);
+    }
+    
+    DenseMatrix DenseMatrix::column(unsigned int col) {
+        return block(0, col, nrow, 1);
     }
     
     void DenseMatrix::zero(){
-        memset(dense->x, 0, nrow * ncol * sizeof(double));
+        if (isContiguous()){
+            memset(dense->x, 0, nrow * ncol * sizeof(double));
+            return;
+        }
+        double *data = getData();
+        for (int c = 0; c < ncol; c++){
+            memset(data + c*dense->d, 0, nrow * sizeof(double));
+        }
     }
     
     SparseMatrix DenseMatrix::toSparse() const {
         return SparseMatrix(cholmod_dense_to_sparse(dense, true, ConfigSingleton::getCommonPtr()));
     }
+    
+    FloatDenseMatrix DenseMatrix::toFloat() const {
+        FloatDenseMatrix res(nrow, ncol);
+        get(res.getData());
+        return res;
+    }
+    
     void DenseMatrix::fill(double value)
     {
         double *data = getData();
+        size_t ld = dense->d;
         for (int c = 0; c < ncol; c++){
             for (int r = 0; r < nrow; r++){
-                data[c*nrow + r] = value;
+                data[c*ld + r] = value;
             }
         }
     }
@@ -103,14 +198,14 @@ namespace oocholmod {
         assert(ncol == 1 || nrow == 1);
         assert(b.ncol == ncol && b.nrow == nrow);
 #endif
-        return cblas_ddot(nrow*ncol, getData(), 1, b.getData(), 1);
+        return cblas_ddot(nrow*ncol, getData(), increment(), b.getData(), b.increment());
     }
     
     double DenseMatrix::length() const {
 #ifdef DEBUG
         assert(ncol == 1 || nrow == 1);
 #endif
-        return cblas_dnrm2(ncol*nrow, getData(), 1);
+        return cblas_dnrm2(ncol*nrow, getData(), increment());
     }
     
     void DenseMatrix::elemDivide(const DenseMatrix& b, DenseMatrix& dest) const {
@@ -119,9 +214,10 @@ namespace oocholmod {
 #endif
         double *thisData = getData();
         double *bData = b.getData();
+        size_t ld = dense->d, bld = b.dense->d;
         for (int c = 0; c < ncol; c++){
             for (int r = 0; r < nrow; r++){
-                thisData[c*nrow + r] /= bData[c*nrow + r];
+                thisData[c*ld + r] /= bData[c*bld + r];
             }
         }
     }
@@ -140,18 +236,17 @@ namespace oocholmod {
 #endif
         double *thisData = dest.getData();
         double *bData = b.getData();
+        size_t ld = dest.dense->d, bld = b.dense->d;
         for (int c = 0; c < ncol; c++){
             for (int r = 0; r < nrow; r++){
-                thisData[c*nrow + r] *= bData[c*nrow + r];
+                thisData[c*ld + r] *= bData[c*bld + r];
             }
         }
     }
     
     DenseMatrix DenseMatrix::copy() const{
         DenseMatrix dest(nrow,ncol);
-        const double *srcPtr = getData();
-        double *destPtr = dest.getData();
-        memcpy(destPtr, srcPtr, nrow*ncol*sizeof(double));
+        dest.set(getData(), dense->d);
         return dest;
     }
     
@@ -160,32 +255,52 @@ namespace oocholmod {
         assert(dense);
 #endif
         double *data = getData();
+        size_t ld = dense->d;
         for (int c = 0; c < ncol; c++){
             for (int r = 0; r < nrow; r++){
-                data[c*nrow + r] = inData[c*nrow + r];
+                data[c*ld + r] = inData[c*nrow + r];
             }
         }
     }
     
-    void DenseMatrix::set(double *data){
+    void DenseMatrix::set(const double *data, size_t ldData){
 #ifdef DEBUG
         assert(dense);
+        assert(ldData == 0 || ldData >= nrow);
 #endif
-        memcpy(dense->x, data, nrow*ncol*sizeof(double));
+        if (ldData == 0){
+            ldData = nrow;
+        }
+        if (isContiguous() && (ldData == nrow || ncol <= 1)){
+            memcpy(dense->x, data, nrow*ncol*sizeof(double));
+            return;
+        }
+        double *dest = getData();
+        for (int c = 0; c < ncol; c++){
+            memcpy(dest + c*dense->d, data + c*ldData, nrow*sizeof(double));
+        }
     }
     
     void DenseMatrix::get(double *outData) const {
 #ifdef DEBUG
         assert(dense);
 #endif
-        memcpy(outData, dense->x, nrow*ncol*sizeof(double));
+        if (isContiguous()){
+            memcpy(outData, dense->x, nrow*ncol*sizeof(double));
+            return;
+        }
+        const double *data = getData();
+        for (int c = 0; c < ncol; c++){
+            memcpy(outData + c*nrow, data + c*dense->d, nrow*sizeof(double));
+        }
     }
     
     void DenseMatrix::get(float *outData) const {
         double *data = getData();
+        size_t ld = dense->d;
         for (int c = 0; c < ncol; c++){
             for (int r = 0; r < nrow; r++){
-                outData[c*nrow + r] = (float)data[c*nrow + r];
+                outData[c*nrow + r] = (float)data[c*ld + r];
             }
         }
     }
@@ -194,6 +309,7 @@ namespace oocholmod {
         std::swap(dense, other.dense);
         std::swap(nrow, other.nrow);
         std::swap(ncol, other.ncol);
+        std::swap(view, other.view);
     }
     
     void swap(DenseMatrix& v1, DenseMatrix& v2) {
@@ -208,7 +324,7 @@ namespace oocholmod {
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
 #endif
         DenseMatrix res = RHS.copy();
-        cblas_daxpy(LHS.nrow*LHS.ncol, 1., LHS.getData(), 1, res.getData(), 1);
+        axpy(LHS.nrow, LHS.ncol, 1., LHS.getData(), LHS.dense->d, res.getData(), res.dense->d);
         return res;
     }
     
@@ -223,7 +339,8 @@ namespace oocholmod {
         assert(LHS.dense && RHS.dense);
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
 #endif
-        cblas_daxpy(LHS.nrow*LHS.ncol, 1., LHS.getData(), 1, RHS.getData(), 1);
+        ownData(RHS);
+        axpy(LHS.nrow, LHS.ncol, 1., LHS.getData(), LHS.dense->d, RHS.getData(), RHS.dense->d);
         return move(RHS);
     }
     
@@ -234,7 +351,12 @@ namespace oocholmod {
     
     DenseMatrix& DenseMatrix::operator+=(const DenseMatrix& RHS)
     {
-        RHS + move(*this);
+#ifdef DEBUG
+        assert(dense && RHS.dense);
+        assert(nrow == RHS.nrow && ncol == RHS.ncol);
+#endif
+        // in place (also for a view)
+        axpy(nrow, ncol, 1., RHS.getData(), RHS.dense->d, getData(), dense->d);
         return *this;
     }
 
@@ -246,7 +368,7 @@ namespace oocholmod {
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
 #endif
         DenseMatrix res = RHS.copy();
-        cblas_daxpy(LHS.nrow*LHS.ncol, -1., LHS.getData(), 1, res.getData(), 1);
+        axpy(LHS.nrow, LHS.ncol, -1., LHS.getData(), LHS.dense->d, res.getData(), res.dense->d);
         return res;
     }
 
@@ -256,8 +378,8 @@ namespace oocholmod {
         assert(LHS.dense && RHS.dense);
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
 #endif
-	
-        cblas_daxpy(LHS.nrow*LHS.ncol, 1., (-1.0*RHS).getData(), 1, LHS.getData(), 1);
+        ownData(LHS);
+        axpy(LHS.nrow, LHS.ncol, -1., RHS.getData(), RHS.dense->d, LHS.getData(), LHS.dense->d);
         return std::move(LHS);
 	
     }
@@ -268,8 +390,9 @@ namespace oocholmod {
         assert(LHS.dense && RHS.dense);
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
 #endif
-	RHS = -1.*RHS;
-        cblas_daxpy(LHS.nrow*LHS.ncol, 1., LHS.getData(), 1, RHS.getData(), 1);
+        ownData(RHS);
+        scal(RHS.nrow, RHS.ncol, -1., RHS.getData(), RHS.dense->d);
+        axpy(LHS.nrow, LHS.ncol, 1., LHS.getData(), LHS.dense->d, RHS.getData(), RHS.dense->d);
         return std::move(RHS);
     }
 
@@ -280,7 +403,12 @@ namespace oocholmod {
 
     DenseMatrix& DenseMatrix::operator-=(const DenseMatrix& RHS)
     {
-        RHS - std::move(*this);
+#ifdef DEBUG
+        assert(dense && RHS.dense);
+        assert(nrow == RHS.nrow && ncol == RHS.ncol);
+#endif
+        // in place (also for a view)
+        axpy(nrow, ncol, -1., RHS.getData(), RHS.dense->d, getData(), dense->d);
         return *this;
     }
 
@@ -291,9 +419,8 @@ namespace oocholmod {
 #ifdef DEBUG
         assert(LHS.dense);
 #endif
-        cholmod_dense *dense = cholmod_copy_dense(LHS.dense, ConfigSingleton::getCommonPtr());
-        DenseMatrix res(dense);
-        cblas_dscal (LHS.nrow*LHS.ncol, RHS, res.getData(), 1);
+        DenseMatrix res = LHS.copy();
+        scal(res.nrow, res.ncol, RHS, res.getData(), res.dense->d);
         return res;
     }
     
@@ -302,7 +429,8 @@ namespace oocholmod {
 #ifdef DEBUG
         assert(LHS.dense);
 #endif
-        cblas_dscal (LHS.nrow*LHS.ncol, RHS, LHS.getData(), 1);
+        ownData(LHS);
+        scal(LHS.nrow, LHS.ncol, RHS, LHS.getData(), LHS.dense->d);
         return move(LHS);
     }
     
@@ -318,7 +446,11 @@ namespace oocholmod {
     
     DenseMatrix& DenseMatrix::operator*=(const double& RHS)
     {
-        move(*this) * RHS;
+#ifdef DEBUG
+        assert(dense);
+#endif
+        // in place (also for a view)
+        scal(nrow, ncol, RHS, getData(), dense->d);
         return *this;
     }
     
@@ -332,10 +464,10 @@ namespace oocholmod {
         
         if(RHS.ncol == 1)
         {
-            cblas_dgemv(CblasColMajor, CblasNoTrans, LHS.nrow, LHS.ncol, 1., LHS.getData(), LHS.nrow, RHS.getData(), 1, 0., res.getData(), 1);
+            cblas_dgemv(CblasColMajor, CblasNoTrans, LHS.nrow, LHS.ncol, 1., LHS.getData(), LHS.dense->d, RHS.getData(), 1, 0., res.getData(), 1);
         }
         else {
-            cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, LHS.nrow, RHS.ncol, LHS.ncol, 1., LHS.getData(), LHS.nrow, RHS.getData(), RHS.nrow, 0., res.getData(), res.nrow);
+            cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, LHS.nrow, RHS.ncol, LHS.ncol, 1., LHS.getData(), LHS.dense->d, RHS.getData(), RHS.dense->d, 0., res.getData(), res.nrow);
         }
         return res;
     }
@@ -344,14 +476,15 @@ namespace oocholmod {
     void DenseMatrix::transpose()
     {
         double *data = getData();
+        size_t ld = dense->d;
         cholmod_dense *d = cholmod_allocate_dense(ncol, nrow, ncol, CHOLMOD_REAL, ConfigSingleton::getCommonPtr());
         double *outData = (double*)d->x;
         for (int c = 0; c < ncol; c++){
             for (int r = 0; r < nrow; r++){
-                outData[r*ncol + c] = data[c*nrow + r];
+                outData[r*ncol + c] = data[c*ld + r];
             }
         }
-        cholmod_free_dense(&dense, ConfigSingleton::getCommonPtr());
+        releaseDense(); // a view becomes an ordinary matrix (the external data is left unchanged)
         dense = d;
         
         int temp = nrow;
@@ -363,11 +496,11 @@ namespace oocholmod {
         if (nrow != RHS.nrow || ncol != RHS.ncol){
             return false;
         }
-        double *data = getData();
-        double *rhsData = RHS.getData();
-        for (int i=0;i<nrow*ncol;i++){
-            if (data[i] != rhsData[i]){
-                return false;
+        for (int c = 0; c < ncol; c++){
+            for (int r = 0; r < nrow; r++){
+                if ((*this)(r, c) != RHS(r, c)){
+                    return false;
+                }
             }
         }
         return true;
@@ -382,9 +515,10 @@ namespace oocholmod {
         DenseMatrix res(M.ncol, M.nrow);
         double *data = M.getData();
         double *outData = res.getData();
+        size_t ld = M.dense->d;
         for (int c = 0; c < M.ncol; c++){
             for (int r = 0; r < M.nrow; r++){
-                outData[r*M.ncol + c] = data[c*M.nrow + r];
+                outData[r*M.ncol + c] = data[c*ld + r];
             }
         }
         return res;
@@ -405,15 +539,16 @@ namespace oocholmod {
 #endif
         __CLPK_integer N = b.nrow;
         __CLPK_integer nrhs = b.ncol;
-        __CLPK_integer lda = A.nrow;
-        __CLPK_integer ldb = b.nrow;
-        __CLPK_integer ipiv[N];
+        vector<__CLPK_integer> ipiv(N); // heap allocated (large N overflows the stack)
         __CLPK_integer info;
         
         cholmod_dense *a = cholmod_copy_dense(A.dense, ConfigSingleton::getCommonPtr());
         cholmod_dense *res = cholmod_copy_dense(b.dense, ConfigSingleton::getCommonPtr());
+        __CLPK_integer lda = a->d; // the copies keep the leading dimensions of A and b
+        __CLPK_integer ldb = res->d;
         
-        dgesv_(&N, &nrhs, (double*)a->x, &lda, ipiv, (double*)res->x, &ldb, &info);
+        dgesv_(&N, &nrhs, (double*)a->x, &lda, ipiv.data(), (double*)res->x, &ldb, &info);
+        cholmod_free_dense(&a, ConfigSingleton::getCommonPtr());
 #ifdef DEBUG
         assert(info == 0);
 #endif
@@ -427,15 +562,16 @@ namespace oocholmod {
         assert(A.nrow == A.ncol);
         assert(A.nrow == b.nrow);
 #endif
+        ownData(A);
         __CLPK_integer N = b.nrow;
         __CLPK_integer nrhs = b.ncol;
-        __CLPK_integer lda = A.nrow;
-        __CLPK_integer ldb = b.nrow;
-        __CLPK_integer ipiv[N];
+        __CLPK_integer lda = A.dense->d;
+        vector<__CLPK_integer> ipiv(N);
         __CLPK_integer info;
         
         cholmod_dense *res = cholmod_copy_dense(b.dense, ConfigSingleton::getCommonPtr());
-        dgesv_(&N, &nrhs, A.getData(), &lda, ipiv, (double*)res->x, &ldb, &info);
+        __CLPK_integer ldb = res->d;
+        dgesv_(&N, &nrhs, A.getData(), &lda, ipiv.data(), (double*)res->x, &ldb, &info);
 #ifdef DEBUG
         assert(info == 0);
 #endif
@@ -449,15 +585,17 @@ namespace oocholmod {
         assert(A.nrow == A.ncol);
         assert(A.nrow == b.nrow);
 #endif
+        ownData(b);
         __CLPK_integer N = b.nrow;
         __CLPK_integer nrhs = b.ncol;
-        __CLPK_integer lda = A.nrow;
-        __CLPK_integer ldb = b.nrow;
-        __CLPK_integer ipiv[N];
+        __CLPK_integer ldb = b.dense->d;
+        vector<__CLPK_integer> ipiv(N);
         __CLPK_integer info;
         
         cholmod_dense *a = cholmod_copy_dense(A.dense, ConfigSingleton::getCommonPtr());
-        dgesv_(&N, &nrhs, (double*)a->x, &lda, ipiv, b.getData(), &ldb, &info);
+        __CLPK_integer lda = a->d;
+        dgesv_(&N, &nrhs, (double*)a->x, &lda, ipiv.data(), b.getData(), &ldb, &info);
+        cholmod_free_dense(&a, ConfigSingleton::getCommonPtr());
 #ifdef DEBUG
         assert(info == 0);
 #endif
@@ -471,14 +609,16 @@ namespace oocholmod {
         assert(A.nrow == A.ncol);
         assert(A.nrow == b.nrow);
 #endif
+        ownData(A);
+        ownData(b);
         __CLPK_integer N = b.nrow;
         __CLPK_integer nrhs = b.ncol;
-        __CLPK_integer lda = A.nrow;
-        __CLPK_integer ldb = b.nrow;
-        __CLPK_integer ipiv[N];
+        __CLPK_integer lda = A.dense->d;
+        __CLPK_integer ldb = b.dense->d;
+        vector<__CLPK_integer> ipiv(N);
         __CLPK_integer info;
         
-        dgesv_(&N, &nrhs, A.getData(), &lda, ipiv, b.getData(), &ldb, &info);
+        dgesv_(&N, &nrhs, A.getData(), &lda, ipiv.data(), b.getData(), &ldb, &info);
 #ifdef DEBUG
         assert(info == 0);
 #endif
@@ -19,6 +19,7 @@ namespace oocholmod {
     // forward declaration
     class SparseMatrix;
     class Factor;
+    class FloatDenseMatrix;
     
     class DenseMatrix {
     public:
@@ -28,6 +29,11 @@ namespace oocholmod {
         
         DenseMatrix(cholmod_dense *x);
         
+        /// Creates a view of external column major data (nothing is allocated or copied). Column c starts at
+        /// data + c*ld (ld = 0 means ld = rows). The data must outlive the view and is not freed by it.
+        /// All operations, including BLAS calls and solves, work directly on the external memory.
+        DenseMatrix(double *data, unsigned int rows, unsigned int cols = 1, unsigned int ld = 0);
+        
         DenseMatrix(DenseMatrix&& move);
         
         DenseMatrix& operator=(DenseMatrix&& other);
@@ -41,7 +47,7 @@ namespace oocholmod {
             assert(dense);
             assert(row < nrow && col < ncol);
 #endif
-            return ((double*)dense->x)[col*nrow + row];
+            return ((double*)dense->x)[col*dense->d + row];
         }
         
         inline double operator()(unsigned int row, unsigned int col = 0) const
@@ -50,7 +56,7 @@ namespace oocholmod {
             assert(dense);
             assert(row < nrow && col < ncol);
 #endif
-            return ((double*)dense->x)[col*nrow + row];
+            return ((double*)dense->x)[col*dense->d + row];
         }
         
         // OPERATORS
@@ -83,6 +89,7 @@ namespace oocholmod {
         
         friend DenseMatrix operator*(const DenseMatrix& LHS, const SparseMatrix& RHS);
         friend DenseMatrix operator*(const SparseMatrix& LHS, const DenseMatrix& RHS);
+        friend void multiply(const SparseMatrix& A, const DenseMatrix& x, DenseMatrix& y, double alpha, double beta, bool transA);
         
         /// Returns the infinity-norm, 1-norm, or 2-norm of a dense matrix. Can compute the 2-norm only for a dense column vector. 
         ///  type of norm: 0: inf. norm, 1: 1-norm, 2: 2-norm 
@@ -101,6 +108,7 @@ namespace oocholmod {
         
         friend DenseMatrix solve(const SparseMatrix& A, const DenseMatrix& b);
         friend DenseMatrix solve(const Factor& F, const DenseMatrix& b);
+        friend void solve(const Factor& F, const DenseMatrix& b, DenseMatrix& x);
         
         // Print
         friend std::ostream& operator<<(std::ostream& os, const DenseMatrix& A);
@@ -112,6 +120,22 @@ namespace oocholmod {
         
         int getColumns() const{ return ncol; }
         
+        /// Distance between the columns in getData() (equals getRows() unless the matrix is a view)
+        int getLeadingDimension() const{ return static_cast<int>(dense->d); }
+        
+        /// True if the matrix is a view of external data
+        bool isView() const{ return view; }
+        
+        /// Views (see the view constructor) of a part of the matrix without copying. The views share the leading
+        /// dimension of this matrix, and are valid as long as the data of this matrix is. Writing to a view writes to
+        /// this matrix, so views can only be taken of a non-const matrix (copy() a const one). The operators and
+        /// solves that reuse a temporary argument copy a view first (A.column(0) * 2 leaves A unchanged); use +=, -=,
+        /// *= or solveInPlace to update a view in place.
+        DenseMatrix block(unsigned int row, unsigned int col, unsigned int rows, unsigned int cols);
+        DenseMatrix columnBlock(unsigned int firstColumn, unsigned int columns);
+        DenseMatrix rowBlock(unsigned int firstRow, unsigned int rows);
+        DenseMatrix column(unsigned int col);
+        
         DenseMatrix copy() const;
         void zero();
         // computes the L^2 norm of the vector
@@ -127,10 +151,14 @@ namespace oocholmod {
         
         SparseMatrix toSparse() const;
         
+        /// Converts to a single precision matrix
+        FloatDenseMatrix toFloat() const;
+        
         double dot(const DenseMatrix& b) const;
         void fill(double value);
         void set(float *data);
-        void set(double *data);
+        /// Copies column major data with leading dimension ldData (0 means ldData = rows)
+        void set(const double *data, size_t ldData = 0);
         void get(double *outData) const;
         void get(float *outData) const;
         
@@ -141,9 +169,13 @@ namespace oocholmod {
     private:
         DenseMatrix(const DenseMatrix& that) = delete; // prevent copy constructor
         DenseMatrix operator=(const DenseMatrix& other) = delete; // prevent copy assignment operator
+        void releaseDense();
+        bool isContiguous() const { return dense->d == nrow || ncol <= 1; }
+        int increment() const { return nrow == 1 ? static_cast<int>(dense->d) : 1; } // between vector elements
         cholmod_dense *dense;
         unsigned int nrow;
         unsigned int ncol;
+        bool view;
     };
     
     // Addition
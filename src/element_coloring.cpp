@@ -0,0 +1,53 @@
+//
+//  element_coloring.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include "element_coloring.h"
+
+#include <cassert>
+#include <algorithm>
+
+using namespace std;
+
+namespace oocholmod {
+
+    vector<vector<int>> colorElements(const vector<int>& elementDofs, int dofsPerElement){
+#ifdef DEBUG
+        assert(dofsPerElement > 0);
+        assert(elementDofs.size() % dofsPerElement == 0);
+#endif
+        int elements = static_cast<int>(elementDofs.size() / dofsPerElement);
+        int dofs = elementDofs.empty() ? 0 : *max_element(elementDofs.begin(), elementDofs.end()) + 1;
+        vector<vector<int>> dofColors(dofs);    // colors of the elements colored so far that contain the dof
+        vector<int> usedBy;                     // usedBy[c] == e if color c is used by a neighbour of element e
+        vector<vector<int>> colors;
+        for (int e = 0; e < elements; e++){
+            const int *dof = &elementDofs[e*dofsPerElement];
+            for (int k = 0; k < dofsPerElement; k++){
+                for (int c : dofColors[dof[k]]){
+                    usedBy[c] = e;
+                }
+            }
+            int color = 0;
+            while (color < (int)colors.size() && usedBy[color] == e){
+                color++;
+            }
+            if (color == (int)colors.size()){
+                colors.push_back(vector<int>());
+                usedBy.push_back(-1);
+            }
+            colors[color].push_back(e);
+            for (int k = 0; k < dofsPerElement; k++){
+                vector<int>& c = dofColors[dof[k]];
+                if (find(c.begin(), c.end(), color) == c.end()){
+                    c.push_back(color);
+                }
+            }
+        }
+        return colors;
+    }
+}
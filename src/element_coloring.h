@@ -0,0 +1,35 @@
+//
+//  element_coloring.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <vector>
+
+namespace oocholmod {
+
+    /// Greedy coloring of finite elements such that no two elements of a color share a dof. Element e has the dofs
+    /// elementDofs[e*dofsPerElement ... (e+1)*dofsPerElement-1]. Returns the elements of each color (in increasing
+    /// order). Compute it once per mesh and use it with assembleColored.
+    std::vector<std::vector<int>> colorElements(const std::vector<int>& elementDofs, int dofsPerElement);
+
+    /// Calls assemble(element) for every element, in parallel over the elements of each color (when compiled with
+    /// OpenMP). Elements of a color do not share dofs, so assemble can add to a built SparseMatrix with
+    /// SparseMatrix::add (and to a right hand side) without atomic updates or locks. Do not use operator() of the
+    /// SparseMatrix, which returns a shared dummy entry for elements outside the pattern. The colors are assembled one
+    /// after the other.
+    template<typename Assemble>
+    void assembleColored(const std::vector<std::vector<int>>& colors, Assemble assemble){
+        for (const std::vector<int>& elements : colors){
+            long count = static_cast<long>(elements.size());
+#pragma omp parallel for schedule(static)
+            for (long k = 0; k < count; k++){
+                assemble(elements[k]);
+            }
+        }
+    }
+}
@@ -6,29 +6,367 @@
 //  Copyright (c) 2013 DTU Compute. All rights reserved.
 //  License: LGPL 3.0
 
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
 #include "factor.h"
 #include "sparse_matrix.h"
 #include "dense_matrix.h"
 #include "config_singleton.h"
+#include "solver_stats.h"
 
 using namespace std;
 
 namespace oocholmod {
     
+    namespace {
+        // Copies the supernodal factor L with the values x (of factor->x or its single precision copy) into a
+        // simplicial column form
+        template<typename Int, typename Source, typename Value>
+        void copySupernodal(const cholmod_factor *factor, const Source *x, vector<SuiteSparse_long>& column, vector<int>& row, vector<Value>& values){
+            const Int *super = (const Int*)factor->super;
+            const Int *pi = (const Int*)factor->pi;
+            const Int *px = (const Int*)factor->px;
+            const Int *s = (const Int*)factor->s;
+            size_t nz = 0;
+            for (size_t k = 0; k < factor->nsuper; k++){
+                Int nsrow = pi[k+1]-pi[k];
+                for (Int j = super[k]; j < super[k+1]; j++){
+                    nz += nsrow - (j-super[k]);
+                }
+            }
+            column.resize(factor->n+1);
+            row.resize(nz);
+            values.resize(nz);
+            SuiteSparse_long index = 0;
+            for (size_t k = 0; k < factor->nsuper; k++){
+                Int nsrow = pi[k+1]-pi[k];
+                for (Int j = super[k]; j < super[k+1]; j++){
+                    Int offset = j-super[k];
+                    column[j] = index;
+                    for (Int r = offset; r < nsrow; r++){
+                        row[index] = (int)s[pi[k]+r];
+                        values[index] = (Value)x[px[k] + offset*nsrow + r];
+                        index++;
+                    }
+                }
+            }
+            column[factor->n] = index;
+        }
+        
+        // Copies the columns p, i, x of a simplicial factor (nz is null if the columns are packed)
+        template<typename Int, typename Source, typename Value>
+        void copySimplicial(size_t n, const Int *p, const Int *i, const Int *nz, const Source *x, vector<SuiteSparse_long>& column, vector<int>& row, vector<Value>& values){
+            column.resize(n+1);
+            column[0] = 0;
+            for (size_t j = 0; j < n; j++){
+                column[j+1] = column[j] + (nz ? nz[j] : p[j+1]-p[j]);
+            }
+            row.resize(column[n]);
+            values.resize(column[n]);
+            for (size_t j = 0; j < n; j++){
+                for (SuiteSparse_long k = 0; k < column[j+1]-column[j]; k++){
+                    row[column[j]+k] = (int)i[p[j]+k];
+                    values[column[j]+k] = (Value)x[p[j]+k];
+                }
+            }
+        }
+        
+        // Overwrites the first n doubles of x with floats (in place, front to back: float k is written over bytes that
+        // have already been read) and shrinks the allocation of x to n floats. allocated is the size of x in doubles
+        // and is set to its size in floats. Returns the float values (x itself if the reallocation fails).
+        float *toSinglePrecision(int itype, void *x, size_t n, size_t& allocated){
+            char *bytes = (char*)x;
+            for (size_t k = 0; k < n; k++){
+                double value;
+                memcpy(&value, bytes + k*sizeof(double), sizeof(double));
+                float single = (float)value;
+                memcpy(bytes + k*sizeof(float), &single, sizeof(float));
+            }
+            allocated *= sizeof(double)/sizeof(float);
+            return (float*)OOCHOLMOD_CALL(itype, realloc, max<size_t>(n, 1), sizeof(float), x, &allocated);
+        }
+        
+        // Solves LL'y = y for a block of nrhs right hand sides stored row by row (y[i*nrhs + c]) with a supernodal
+        // factor with the float values Lx. Each supernode is a dense block of columns sharing its rows, so its values
+        // are read once for all right hand sides and the updates of the rows below it are collected in t.
+        template<typename Int>
+        void solveSupernodal(const cholmod_factor *factor, const float *Lx, double *y, int nrhs, vector<double>& t){
+            const Int *super = (const Int*)factor->super;
+            const Int *pi = (const Int*)factor->pi;
+            const Int *px = (const Int*)factor->px;
+            const Int *s = (const Int*)factor->s;
+            long nsuper = factor->nsuper;
+            // solve Ly = y
+            for (long k = 0; k < nsuper; k++){
+                Int first = super[k], nscol = super[k+1]-first, nsrow = pi[k+1]-pi[k], m = nsrow-nscol;
+                const Int *rows = s + pi[k] + nscol; // the rows below the diagonal block
+                const float *X = Lx + px[k];         // column-major nsrow x nscol block
+                t.assign(m*nrhs, 0);
+                for (Int o = 0; o < nscol; o++){
+                    const float *column = X + o*nsrow;
+                    double *yo = y + (first+o)*nrhs;
+                    double d = column[o];
+                    for (int c = 0; c < nrhs; c++){
+                        yo[c] /= d;
+                    }
+                    for (Int r = o+1; r < nscol; r++){
+                        double l = column[r];
+                        double *yr = y + (first+r)*nrhs;
+                        for (int c = 0; c < nrhs; c++){
+                            yr[c] -= l*yo[c];
+                        }
+                    }
+                    for (Int r = 0; r < m; r++){
+                        double l = column[nscol+r];
+                        double *tr = &t[r*nrhs];
+                        for (int c = 0; c < nrhs; c++){
+                            tr[c] += l*yo[c];
+                        }
+                    }
+                }
+                for (Int r = 0; r < m; r++){
+                    double *yr = y + rows[r]*nrhs;
+                    for (int c = 0; c < nrhs; c++){
+                        yr[c] -= t[r*nrhs + c];
+                    }
+                }
+            }
+            // solve L'y = y
+            for (long k = nsuper-1; k >= 0; k--){
+                Int first = super[k], nscol = super[k+1]-first, nsrow = pi[k+1]-pi[k], m = nsrow-nscol;
+                const Int *rows = s + pi[k] + nscol;
+                const float *X = Lx + px[k];
+                t.resize(m*nrhs);
+                for (Int r = 0; r < m; r++){
+                    copy(y + rows[r]*nrhs, y + (rows[r]+1)*nrhs, &t[r*nrhs]);
+                }
+                for (Int o = nscol-1; o >= 0; o--){
+                    const float *column = X + o*nsrow;
+                    double *yo = y + (first+o)*nrhs;
+                    for (Int r = o+1; r < nscol; r++){
+                        double l = column[r];
+                        const double *yr = y + (first+r)*nrhs;
+                        for (int c = 0; c < nrhs; c++){
+                            yo[c] -= l*yr[c];
+                        }
+                    }
+                    for (Int r = 0; r < m; r++){
+                        double l = column[nscol+r];
+                        const double *tr = &t[r*nrhs];
+                        for (int c = 0; c < nrhs; c++){
+                            yo[c] -= l*tr[c];
+                        }
+                    }
+                    double d = column[o];
+                    for (int c = 0; c < nrhs; c++){
+                        yo[c] /= d;
+                    }
+                }
+            }
+        }
+        
+        // Solves LL'y = y (as solveSupernodal) with a packed simplicial factor (diagonal entry first in each column)
+        template<typename Int>
+        void solveSimplicial(size_t n, const Int *Lp, const Int *Li, const float *Lx, double *y, int nrhs){
+            for (size_t j = 0; j < n; j++){
+                double *yj = y + j*nrhs;
+                double d = Lx[Lp[j]];
+                for (int c = 0; c < nrhs; c++){
+                    yj[c] /= d;
+                }
+                for (Int p = Lp[j]+1; p < Lp[j+1]; p++){
+                    double l = Lx[p];
+                    double *yr = y + Li[p]*nrhs;
+                    for (int c = 0; c < nrhs; c++){
+                        yr[c] -= l*yj[c];
+                    }
+                }
+            }
+            for (size_t j = n; j-- > 0;){
+                double *yj = y + j*nrhs;
+                for (Int p = Lp[j]+1; p < Lp[j+1]; p++){
+                    double l = Lx[p];
+                    const double *yr = y + Li[p]*nrhs;
+                    for (int c = 0; c < nrhs; c++){
+                        yj[c] -= l*yr[c];
+                    }
+                }
+                double d = Lx[Lp[j]];
+                for (int c = 0; c < nrhs; c++){
+                    yj[c] /= d;
+                }
+            }
+        }
+        
+        // L as a unit lower triangular matrix (without the diagonal, rows sorted in each column) and the diagonal D
+        struct LDL {
+            vector<SuiteSparse_long> p;
+            vector<int> i;
+            vector<double> x;
+            vector<double> d;
+        };
+        
+        // Converts columns with the diagonal entry first (of an LL' or LDL' factor) to LDL
+        template<typename Value>
+        void toLDL(const vector<SuiteSparse_long>& column, const vector<int>& row, const vector<Value>& values, bool isLL, LDL& L){
+            size_t n = column.size()-1;
+            L.p.resize(n+1);
+            L.i.resize(column[n]-n);
+            L.x.resize(column[n]-n);
+            L.d.resize(n);
+            vector<pair<int, double>> entries;
+            L.p[0] = 0;
+            for (size_t j = 0; j < n; j++){
+                double diagonal = values[column[j]];
+                L.d[j] = isLL ? diagonal*diagonal : diagonal;
+                entries.clear();
+                for (SuiteSparse_long k = column[j]+1; k < column[j+1]; k++){
+                    entries.push_back(make_pair(row[k], isLL ? values[k]/diagonal : (double)values[k]));
+                }
+                sort(entries.begin(), entries.end());
+                L.p[j+1] = L.p[j] + entries.size();
+                for (size_t k = 0; k < entries.size(); k++){
+                    L.i[L.p[j]+k] = entries[k].first;
+                    L.x[L.p[j]+k] = entries[k].second;
+                }
+            }
+        }
+        
+        // Entries of Z = (LDL')^-1 on the pattern of L by the Takahashi recurrences (from the last column to the first):
+        // Z(i,j) = -sum_k Z(i,k) L(k,j) and Z(j,j) = 1/D(j) - sum_k Z(j,k) L(k,j) with k > j in the pattern of L(:,j).
+        // The pattern of L(:,j) is a clique in the pattern of L, so all Z(i,k) needed are computed before column j.
+        void takahashi(const LDL& L, vector<double>& zx, vector<double>& zd){
+            long n = L.d.size();
+            zx.assign(L.x.size(), 0);
+            zd.assign(n, 0);
+            for (long j = n-1; j >= 0; j--){
+                SuiteSparse_long from = L.p[j], to = L.p[j+1];
+                for (SuiteSparse_long a = from; a < to; a++){
+                    int i = L.i[a];
+                    double sum = 0;
+                    for (SuiteSparse_long b = from; b < to; b++){
+                        int k = L.i[b];
+                        double zik;
+                        if (i == k){
+                            zik = zd[i];
+                        } else {
+                            int c = min(i, k), r = max(i, k);
+                            const int *slot = lower_bound(&L.i[0] + L.p[c], &L.i[0] + L.p[c+1], r);
+#ifdef DEBUG
+                            assert(slot != &L.i[0] + L.p[c+1] && *slot == r);
+#endif
+                            zik = zx[slot - &L.i[0]];
+                        }
+                        sum += zik*L.x[b];
+                    }
+                    zx[a] = -sum;
+                }
+                double sum = 0;
+                for (SuiteSparse_long a = from; a < to; a++){
+                    sum += zx[a]*L.x[a];
+                }
+                zd[j] = 1/L.d[j] - sum;
+            }
+        }
+        
+        // sum of log|d| over the diagonal entries d of L with the values x and (if simplicial) the column pointers p
+        // (the diagonal entry is the first entry of each column)
+        template<typename Int, typename Value>
+        double logDiagonal(const cholmod_factor *factor, const Value *x, const Int *p){
+            double sum = 0;
+            if (factor->is_super){
+                const Int *super = (const Int*)factor->super;
+                const Int *pi = (const Int*)factor->pi;
+                const Int *px = (const Int*)factor->px;
+                for (size_t k = 0; k < factor->nsuper; k++){
+                    Int nsrow = pi[k+1]-pi[k];
+                    for (Int j = 0; j < super[k+1]-super[k]; j++){
+                        sum += log(fabs((double)x[px[k] + j + j*nsrow]));
+                    }
+                }
+            } else {
+                for (size_t j = 0; j < factor->n; j++){
+                    sum += log(fabs((double)x[p[j]]));
+                }
+            }
+            return sum;
+        }
+        
+        // The upper triangular part of P'ZP, where Z is stored on the pattern of L (zx) and its diagonal (zd)
+        template<typename Int>
+        cholmod_sparse *permutedUpper(const LDL& L, const vector<double>& zx, const vector<double>& zd, const vector<int>& perm){
+            size_t n = zd.size();
+            vector<SuiteSparse_long> next(n+1, 0);
+            for (size_t j = 0; j < n; j++){
+                next[perm[j]+1]++;
+                for (SuiteSparse_long k = L.p[j]; k < L.p[j+1]; k++){
+                    next[max(perm[L.i[k]], perm[j])+1]++;
+                }
+            }
+            for (size_t j = 0; j < n; j++){
+                next[j+1] += next[j];
+            }
+            cholmod_sparse *Z = OOCHOLMOD_CALL(sizeof(Int) == sizeof(int) ? CHOLMOD_INT : CHOLMOD_LONG, allocate_sparse, n, n,
+                                               max<size_t>(next[n], 1), true, true, SYMMETRIC_UPPER, CHOLMOD_REAL);
+            Int *Zp = (Int*)Z->p;
+            Int *Zi = (Int*)Z->i;
+            double *Zx = (double*)Z->x;
+            copy(next.begin(), next.end(), Zp);
+            vector<pair<Int, double>> entries(next[n]);
+            for (size_t j = 0; j < n; j++){
+                entries[next[perm[j]]++] = make_pair((Int)perm[j], zd[j]);
+                for (SuiteSparse_long k = L.p[j]; k < L.p[j+1]; k++){
+                    int r = perm[L.i[k]], c = perm[j];
+                    entries[next[max(r, c)]++] = make_pair((Int)min(r, c), zx[k]);
+                }
+            }
+            for (size_t j = 0; j < n; j++){
+                sort(entries.begin() + Zp[j], entries.begin() + Zp[j+1]);
+                for (Int k = Zp[j]; k < Zp[j+1]; k++){
+                    Zi[k] = entries[k].first;
+                    Zx[k] = entries[k].second;
+                }
+            }
+            return Z;
+        }
+        
+        // D(j) of a simplicial LDL' factor (the first entry of column j)
+        template<typename Int>
+        double pivot(const cholmod_factor *factor, size_t j){
+            return ((const double*)factor->x)[((const Int*)factor->p)[j]];
+        }
+        
+        template<typename Int>
+        int permutation(const cholmod_factor *factor, int k){
+            return factor->Perm ? (int)((const Int*)factor->Perm)[k] : k;
+        }
+    }
+    
     Factor::Factor()
-    :factor{nullptr}
+    :factor{nullptr}, precision{DOUBLE_PRECISION}, mode{CHOLESKY}, lnz{0}, flops{0}, singleValues{nullptr},
+    singleColumn{nullptr}, singleRow{nullptr}, singleValuesSize{0}, singleRowSize{0}
     {
     }
     
-    Factor::Factor(cholmod_factor *factor)
-    :factor{factor}
+    Factor::Factor(cholmod_factor *factor, FactorMode mode)
+    :factor{factor}, precision{DOUBLE_PRECISION}, mode{mode}, lnz{ConfigSingleton::getCommonPtr(factor ? factor->itype : CHOLMOD_INT)->lnz},
+    flops{ConfigSingleton::getCommonPtr(factor ? factor->itype : CHOLMOD_INT)->fl}, singleValues{nullptr},
+    singleColumn{nullptr}, singleRow{nullptr}, singleValuesSize{0}, singleRowSize{0}
     {
     }
     
     Factor::Factor(Factor&& move)
-    :factor{move.factor}
+    :factor{move.factor}, precision{move.precision}, mode{move.mode}, lnz{move.lnz}, flops{move.flops},
+    singleValues{move.singleValues}, singleColumn{move.singleColumn}, singleRow{move.singleRow},
+    singleValuesSize{move.singleValuesSize}, singleRowSize{move.singleRowSize}
     {
         move.factor = nullptr;
+        move.precision = DOUBLE_PRECISION;
+        move.singleValues = nullptr;
+        move.singleColumn = nullptr;
+        move.singleRow = nullptr;
     }
     
     bool Factor::isInitialized(){
@@ -38,13 +376,27 @@ namespace oocholmod {
     Factor& Factor::operator=(Factor&& other){
         if (this != &other){
             if (factor != nullptr){
-                cholmod_free_factor(&factor, ConfigSingleton::getCommonPtr()) ;
+                releaseSinglePrecision();
+                OOCHOLMOD_CALL(factor->itype, free_factor, &factor);
             }
             // copy
             factor = other.factor;
+            precision = other.precision;
+            mode = other.mode;
+            lnz = other.lnz;
+            flops = other.flops;
+            singleValues = other.singleValues;
+            singleColumn = other.singleColumn;
+            singleRow = other.singleRow;
+            singleValuesSize = other.singleValuesSize;
+            singleRowSize = other.singleRowSize;
 
             // clean up
             other.factor = nullptr;
+            other.precision = DOUBLE_PRECISION;
+            other.singleValues = nullptr;
+            other.singleColumn = nullptr;
+            other.singleRow = nullptr;
         }
         
         return *this;
@@ -52,43 +404,354 @@ namespace oocholmod {
     
     Factor::~Factor(){
         if (factor){
-            cholmod_free_factor(&factor, ConfigSingleton::getCommonPtr()) ;
+            releaseSinglePrecision();
+            OOCHOLMOD_CALL(factor->itype, free_factor, &factor);
         }
     }
     
-    bool Factor::factorize(const SparseMatrix& A){
+    bool Factor::factorize(const SparseMatrix& A, FactorPrecision precision){
 #ifdef DEBUG
         assert(A.symmetry != ASYMMETRIC);
         assert(A.sparse);
         assert(factor);
+        assert(A.sparse->itype == factor->itype);
+        assert(mode == CHOLESKY || precision == DOUBLE_PRECISION); // the single precision factor is LL'
 #endif
-        auto Common = ConfigSingleton::getCommonPtr();
-        cholmod_factorize(A.sparse, factor, Common) ; /* factorize */
+        ScopedTimer timer("factorize", factor->itype);
+        releaseSinglePrecision();
+        auto Common = ConfigSingleton::getCommonPtr(factor->itype);
+        int finalLL = Common->final_ll;
+        if (mode == LDLT){
+            Common->final_ll = false;
+        }
+        OOCHOLMOD_CALL(factor->itype, factorize, A.sparse, factor); /* factorize */
+        Common->final_ll = finalLL;
+        timer.setFactor(factor, lnz, flops);
         if (Common->status == CHOLMOD_OK){
+            if (precision == SINGLE_PRECISION){
+                convertToSinglePrecision();
+            }
             return true;
         }
         Common->status = 0;
+        timer.setSuccess(false);
         return false;
     }
     
+    void Factor::convertToSinglePrecision(){
+        int itype = factor->itype;
+        size_t n = factor->n;
+        if (factor->is_super){
+            // the supernodes (and their rows) stay in the symbolic factor
+            singleValuesSize = factor->xsize;
+            singleValues = toSinglePrecision(itype, factor->x, factor->xsize, singleValuesSize);
+        } else {
+            // simplicial LDL' is converted to packed LL' in place, and its columns are handed over with the values
+            OOCHOLMOD_CALL(itype, change_factor, CHOLMOD_REAL, true, false, true, true, factor);
+            size_t nz = itype == CHOLMOD_LONG ? (size_t)((const SuiteSparse_long*)factor->p)[n] : (size_t)((const int*)factor->p)[n];
+            singleValuesSize = factor->nzmax;
+            singleValues = toSinglePrecision(itype, factor->x, nz, singleValuesSize);
+            singleColumn = factor->p;
+            singleRow = factor->i;
+            singleRowSize = factor->nzmax;
+            factor->p = nullptr;
+            factor->i = nullptr;
+        }
+        factor->x = nullptr;
+        // free the rest of the numeric factor but keep the symbolic analysis for the next factorization
+        OOCHOLMOD_CALL(itype, change_factor, CHOLMOD_PATTERN, false, factor->is_super, true, true, factor);
+        precision = SINGLE_PRECISION;
+    }
+    
+    void Factor::releaseSinglePrecision(){
+        if (singleValues){
+            size_t indexSize = factor->itype == CHOLMOD_LONG ? sizeof(SuiteSparse_long) : sizeof(int);
+            OOCHOLMOD_CALL(factor->itype, free, singleValuesSize, sizeof(float), singleValues);
+            if (singleColumn){
+                OOCHOLMOD_CALL(factor->itype, free, factor->n+1, indexSize, singleColumn);
+                OOCHOLMOD_CALL(factor->itype, free, singleRowSize, indexSize, singleRow);
+            }
+        }
+        singleValues = nullptr;
+        singleColumn = nullptr;
+        singleRow = nullptr;
+        precision = DOUBLE_PRECISION;
+    }
+    
+    Inertia Factor::getInertia(double tolerance) const {
+#ifdef DEBUG
+        assert(factor);
+#endif
+        Inertia inertia{0, 0, 0};
+        if (precision == SINGLE_PRECISION){
+            inertia.positive = (int)factor->n;
+            return inertia;
+        }
+        if (factor->is_ll){
+            inertia.positive = (int)factor->minor;
+            return inertia;
+        }
+        auto d = factor->itype == CHOLMOD_LONG ? pivot<SuiteSparse_long> : pivot<int>;
+        // the columns after a failed pivot (factor->minor) are not computed
+        size_t n = min<size_t>(factor->minor, factor->n);
+        double maxPivot = 0;
+        for (size_t j = 0; j < n; j++){
+            maxPivot = max(maxPivot, fabs(d(factor, j)));
+        }
+        if (n < factor->n){
+            inertia.zero++;
+        }
+        for (size_t j = 0; j < n; j++){
+            double dj = d(factor, j);
+            if (fabs(dj) <= tolerance*maxPivot){
+                inertia.zero++;
+            } else if (dj > 0){
+                inertia.positive++;
+            } else {
+                inertia.negative++;
+            }
+        }
+        return inertia;
+    }
+    
+    double Factor::logDeterminant() const {
+#ifdef DEBUG
+        assert(factor);
+#endif
+        bool isLong = factor->itype == CHOLMOD_LONG;
+        if (precision == SINGLE_PRECISION){
+            double sum = isLong ? logDiagonal(factor, singleValues, (const SuiteSparse_long*)singleColumn)
+                                : logDiagonal(factor, singleValues, (const int*)singleColumn);
+            return 2*sum;
+        }
+        const double *x = (const double*)factor->x;
+        double sum = isLong ? logDiagonal(factor, x, (const SuiteSparse_long*)factor->p)
+                            : logDiagonal(factor, x, (const int*)factor->p);
+        return factor->is_ll ? 2*sum : sum;
+    }
+    
+    bool Factor::copyColumns(vector<SuiteSparse_long>& column, vector<int>& row, vector<double>& values) const {
+        bool isLong = factor->itype == CHOLMOD_LONG;
+        bool single = precision == SINGLE_PRECISION;
+        if (factor->is_super){
+            if (single){
+                if (isLong){
+                    copySupernodal<SuiteSparse_long>(factor, singleValues, column, row, values);
+                } else {
+                    copySupernodal<int>(factor, singleValues, column, row, values);
+                }
+            } else {
+                if (isLong){
+                    copySupernodal<SuiteSparse_long>(factor, (const double*)factor->x, column, row, values);
+                } else {
+                    copySupernodal<int>(factor, (const double*)factor->x, column, row, values);
+                }
+            }
+        } else {
+            size_t n = factor->n;
+            if (single){
+                if (isLong){
+                    copySimplicial(n, (const SuiteSparse_long*)singleColumn, (const SuiteSparse_long*)singleRow,
+                                   (const SuiteSparse_long*)nullptr, singleValues, column, row, values);
+                } else {
+                    copySimplicial(n, (const int*)singleColumn, (const int*)singleRow, (const int*)nullptr,
+                                   singleValues, column, row, values);
+                }
+            } else {
+                const double *x = (const double*)factor->x;
+                if (isLong){
+                    copySimplicial(n, (const SuiteSparse_long*)factor->p, (const SuiteSparse_long*)factor->i,
+                                   (const SuiteSparse_long*)factor->nz, x, column, row, values);
+                } else {
+                    copySimplicial(n, (const int*)factor->p, (const int*)factor->i, (const int*)factor->nz, x,
+                                   column, row, values);
+                }
+            }
+        }
+        return single || factor->is_ll;
+    }
+    
+    SparseMatrix selectedInverse(const Factor& F)
+    {
+#ifdef DEBUG
+        assert(F.factor);
+#endif
+        ScopedTimer timer("selected inverse", F.factor->itype);
+        timer.setFactor(F.factor, F.lnz, F.flops);
+        vector<SuiteSparse_long> column;
+        vector<int> row;
+        vector<double> values;
+        bool isLL = F.copyColumns(column, row, values);
+        LDL L;
+        toLDL(column, row, values, isLL, L);
+        vector<double> zx, zd;
+        takahashi(L, zx, zd);
+        bool isLong = F.factor->itype == CHOLMOD_LONG;
+        vector<int> perm(F.factor->n);
+        for (size_t k = 0; k < perm.size(); k++){
+            perm[k] = isLong ? permutation<SuiteSparse_long>(F.factor, (int)k) : permutation<int>(F.factor, (int)k);
+        }
+        cholmod_sparse *Z = isLong ? permutedUpper<SuiteSparse_long>(L, zx, zd, perm) : permutedUpper<int>(L, zx, zd, perm);
+        return SparseMatrix(Z);
+    }
+    
+    DenseMatrix inverseDiagonal(const Factor& F)
+    {
+#ifdef DEBUG
+        assert(F.factor);
+#endif
+        ScopedTimer timer("selected inverse", F.factor->itype);
+        timer.setFactor(F.factor, F.lnz, F.flops);
+        vector<SuiteSparse_long> column;
+        vector<int> row;
+        vector<double> values;
+        bool isLL = F.copyColumns(column, row, values);
+        LDL L;
+        toLDL(column, row, values, isLL, L);
+        vector<double> zx, zd;
+        takahashi(L, zx, zd);
+        bool isLong = F.factor->itype == CHOLMOD_LONG;
+        DenseMatrix d(static_cast<unsigned int>(F.factor->n), 1);
+        for (size_t k = 0; k < zd.size(); k++){
+            d(isLong ? permutation<SuiteSparse_long>(F.factor, (int)k) : permutation<int>(F.factor, (int)k)) = zd[k];
+        }
+        return d;
+    }
+    
+    DenseMatrix Factor::solveSinglePrecision(const DenseMatrix& b) const {
+        int n = static_cast<int>(factor->n);
+        int columns = b.getColumns();
+        bool isLong = factor->itype == CHOLMOD_LONG;
+        std::vector<int> perm(n);
+        for (int k = 0; k < n; k++){
+            perm[k] = isLong ? permutation<SuiteSparse_long>(factor, k) : permutation<int>(factor, k);
+        }
+        // the right hand sides are solved in blocks (in parallel), each with a single pass over L
+        const int blockSize = 16;
+        int blocks = (columns + blockSize - 1) / blockSize;
+        DenseMatrix x(n, columns);
+#pragma omp parallel for schedule(dynamic, 1) if(blocks > 1)
+        for (int block = 0; block < blocks; block++){
+            int first = block*blockSize;
+            int nrhs = min(blockSize, columns - first);
+            // the permuted right hand sides, row by row
+            std::vector<double> y((size_t)n*nrhs), t;
+            for (int k = 0; k < n; k++){
+                for (int c = 0; c < nrhs; c++){
+                    y[(size_t)k*nrhs + c] = b(perm[k], first + c);
+                }
+            }
+            if (factor->is_super){
+                if (isLong){
+                    solveSupernodal<SuiteSparse_long>(factor, singleValues, y.data(), nrhs, t);
+                } else {
+                    solveSupernodal<int>(factor, singleValues, y.data(), nrhs, t);
+                }
+            } else {
+                if (isLong){
+                    solveSimplicial(n, (const SuiteSparse_long*)singleColumn, (const SuiteSparse_long*)singleRow,
+                                    singleValues, y.data(), nrhs);
+                } else {
+                    solveSimplicial(n, (const int*)singleColumn, (const int*)singleRow, singleValues, y.data(), nrhs);
+                }
+            }
+            for (int k = 0; k < n; k++){
+                for (int c = 0; c < nrhs; c++){
+                    x(perm[k], first + c) = y[(size_t)k*nrhs + c];
+                }
+            }
+        }
+        return x;
+    }
+    
     DenseMatrix solve(const Factor& F, const DenseMatrix& b)
     {
 #ifdef DEBUG
         assert(F.factor);
         assert(b.dense);
 #endif
+        if (F.factor->itype == CHOLMOD_LONG && F.precision == DOUBLE_PRECISION){
+            // solve into a matrix allocated with the int common (which DenseMatrix frees it with)
+            DenseMatrix res(static_cast<unsigned int>(F.factor->n), b.getColumns());
+            solve(F, b, res);
+            return res;
+        }
+        ScopedTimer timer("solve", F.factor->itype);
+        timer.setFactor(F.factor, F.lnz, 4*F.lnz*b.getColumns());
+        if (F.precision == SINGLE_PRECISION){
+            return F.solveSinglePrecision(b);
+        }
         cholmod_dense *x = cholmod_solve(CHOLMOD_A, F.factor, b.dense, ConfigSingleton::getCommonPtr());
         return DenseMatrix(x);
     }
     
+    void solve(const Factor& F, const DenseMatrix& b, DenseMatrix& x)
+    {
+#ifdef DEBUG
+        assert(F.factor);
+        assert(b.dense && x.dense);
+        assert(x.nrow == F.factor->n && x.ncol == b.ncol);
+#endif
+        if (F.precision == SINGLE_PRECISION || x.dense->d != x.nrow){
+            // CHOLMOD only solves into matrices with leading dimension n
+            DenseMatrix res = solve(F, b);
+            x.set(res.getData());
+            return;
+        }
+        ScopedTimer timer("solve", F.factor->itype);
+        timer.setFactor(F.factor, F.lnz, 4*F.lnz*b.getColumns());
+        cholmod_dense *X = x.dense, *y = nullptr, *e = nullptr;
+        OOCHOLMOD_CALL(F.factor->itype, solve2, CHOLMOD_A, F.factor, b.dense, nullptr, &X, nullptr, &y, &e);
+#ifdef DEBUG
+        assert(X == x.dense);
+#endif
+        OOCHOLMOD_CALL(F.factor->itype, free_dense, &y);
+        OOCHOLMOD_CALL(F.factor->itype, free_dense, &e);
+    }
+    
     SparseMatrix solve(const Factor& F, const SparseMatrix& b)
     {
 #ifdef DEBUG
         assert(F.factor);
         assert(b.sparse);
+        assert(b.sparse->itype == F.factor->itype);
 #endif
-        cholmod_sparse *x = cholmod_spsolve(CHOLMOD_A, F.factor, b.sparse, ConfigSingleton::getCommonPtr());
+        ScopedTimer timer("solve", F.factor->itype);
+        timer.setFactor(F.factor, F.lnz, 4*F.lnz*b.getColumns());
+        if (F.precision == SINGLE_PRECISION){
+            return F.solveSinglePrecision(b.toDense()).toSparse();
+        }
+        cholmod_sparse *x = OOCHOLMOD_CALL(F.factor->itype, spsolve, CHOLMOD_A, F.factor, b.sparse);
         return SparseMatrix(x);
     }
     
+    DenseMatrix solve(const Factor& F, const SparseMatrix& A, const DenseMatrix& b, RefinementInfo *info,
+                      int maxIterations, double tolerance)
+    {
+        double normA = A.norm(0);
+        double normB = b.norm(0);
+        DenseMatrix x = solve(F, b);
+        double lastResidual = INFINITY;
+        RefinementInfo result{0, INFINITY, false};
+        while (true) {
+            DenseMatrix r = b - A * x;
+            result.residual = r.norm(0) / (normA * x.norm(0) + normB);
+            if (result.residual <= tolerance || normB == 0){
+                result.converged = true;
+                break;
+            }
+            // stop when the residual no longer decreases (the factor is too inaccurate for A)
+            if (result.iterations == maxIterations || result.residual > 0.5 * lastResidual){
+                break;
+            }
+            lastResidual = result.residual;
+            x += solve(F, r);
+            result.iterations++;
+        }
+        if (info){
+            *info = result;
+        }
+        return x;
+    }
+    
 }
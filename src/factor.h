@@ -9,6 +9,7 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
 #include <cholmod.h>
 
@@ -18,9 +19,33 @@ namespace oocholmod {
     class SparseMatrix; // forward declaration
     class DenseMatrix;
     
+    enum FactorPrecision {
+        DOUBLE_PRECISION,
+        SINGLE_PRECISION // L is stored in single precision (solves still accumulate in double)
+    };
+    
+    enum FactorMode {
+        CHOLESKY,   // LL' (supernodal or simplicial, chosen by CHOLMOD), requires a positive definite matrix
+        LDLT        // simplicial LDL' without pivoting, for symmetric indefinite but quasi-definite matrices (KKT systems)
+    };
+    
+    /// Number of positive, negative and zero pivots (entries of D) of a factorization
+    struct Inertia {
+        int positive;
+        int negative;
+        int zero;
+    };
+    
+    /// Result of an iterative solve (iterative refinement or preconditioned conjugate gradients)
+    struct RefinementInfo {
+        int iterations;
+        double residual; // normwise backward error of the returned solution
+        bool converged;
+    };
+    
     class Factor {
         friend class SparseMatrix;
-        Factor(cholmod_factor *factor);
+        Factor(cholmod_factor *factor, FactorMode mode = CHOLESKY);
     public:
         Factor();
         Factor(Factor&& move);
@@ -28,19 +53,75 @@ namespace oocholmod {
         virtual ~Factor();
         
         // returns true if factorization is done
-        // Return false if matrix is not positive definite
-        bool factorize(const SparseMatrix& sparse);
+        // Return false if matrix is not positive definite (or, for an LDLT factor, if a pivot is zero)
+        // With SINGLE_PRECISION the factor is computed in double precision and its values are then converted to
+        // float in place, so the factor kept between solves takes half the memory of its values (and the peak is
+        // that of a double precision factor). A supernodal factor keeps its supernodes, and the solve is blocked
+        // over the supernodes and over the right hand sides. Use the refining solve to recover full double
+        // precision accuracy.
+        bool factorize(const SparseMatrix& sparse, FactorPrecision precision = DOUBLE_PRECISION);
+        
+        FactorPrecision getPrecision() const { return precision; }
+        FactorMode getMode() const { return mode; }
+        
+        /// Inertia of the factorized matrix. Pivots with |d| <= tolerance*max|d| are counted as zero. If factorize
+        /// failed, only the pivots up to the failed one (counted as zero) are known. An LL' factor only has positive pivots.
+        Inertia getInertia(double tolerance = 0) const;
+        
+        /// Number of nonzeros in L and floating point operations of a factorization, as estimated by analyze()
+        double getNumberOfNonzeros() const { return lnz; }
+        double getFlops() const { return flops; }
+        
+        /// log(det(A)) of the factorized matrix, read from the diagonal of the factor (log|det(A)| if D of an LDL'
+        /// factor has negative entries)
+        double logDeterminant() const;
         
         friend DenseMatrix solve(const Factor& F, const DenseMatrix& b);
+        friend void solve(const Factor& F, const DenseMatrix& b, DenseMatrix& x);
         friend SparseMatrix solve(const Factor& F, const SparseMatrix& b);
         
+        friend SparseMatrix selectedInverse(const Factor& F);
+        friend DenseMatrix inverseDiagonal(const Factor& F);
+        
         bool isInitialized();
     private:
         Factor(const Factor& that) = delete; // prevent copy constructor
+        void convertToSinglePrecision();
+        void releaseSinglePrecision();
+        DenseMatrix solveSinglePrecision(const DenseMatrix& b) const;
+        // copies the columns of L with the diagonal entry first. Returns true for an LL' factor and false for LDL'
+        bool copyColumns(std::vector<SuiteSparse_long>& column, std::vector<int>& row, std::vector<double>& values) const;
         cholmod_factor *factor;
+        FactorPrecision precision;
+        FactorMode mode;
+        double lnz;
+        double flops;
+        // L in single precision. The values of the factor are converted to float in place and handed over by the
+        // factor, which keeps its symbolic analysis (the supernodes of a supernodal factor). A simplicial factor is
+        // converted to LL' first and also hands over its packed columns (with the index type of the factor).
+        float *singleValues;
+        void *singleColumn;
+        void *singleRow;
+        size_t singleValuesSize;    // allocated sizes, in elements
+        size_t singleRowSize;
     };
     
     DenseMatrix solve(const Factor& F, const DenseMatrix& b);
+    /// Solves Ax=b into the existing matrix x (for example a view of external data)
+    void solve(const Factor& F, const DenseMatrix& b, DenseMatrix& x);
     SparseMatrix solve(const Factor& F, const SparseMatrix& b);
+    
+    /// The entries of A^-1 on the pattern of L+L' (mapped back to the ordering of A), which includes the pattern of A.
+    /// Computed with the Takahashi recurrences in one backward pass over the columns of the factor instead of n solves.
+    /// Returns the upper triangular part (SYMMETRIC_UPPER).
+    SparseMatrix selectedInverse(const Factor& F);
+    /// diag(A^-1) as a column vector (computed like selectedInverse)
+    DenseMatrix inverseDiagonal(const Factor& F);
+    
+    /// Solves Ax=b using the factor of A followed by iterative refinement with residuals computed in double precision.
+    /// Iterates until the normwise backward error is below tolerance. If info is given it reports the number of
+    /// refinement steps and whether the refinement converged (if not, refactor A in double precision).
+    DenseMatrix solve(const Factor& F, const SparseMatrix& A, const DenseMatrix& b, RefinementInfo *info = nullptr,
+                      int maxIterations = 10, double tolerance = 1e-14);
 }
 
@@ -0,0 +1,223 @@
+//
+//  float_dense_matrix.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include <cstring>
+#include <algorithm>
+
+#include "float_dense_matrix.h"
+#include "dense_matrix.h"
+#include "factor.h"
+
+using namespace std;
+
+namespace oocholmod {
+
+    FloatDenseMatrix::FloatDenseMatrix(unsigned int rows, unsigned int cols, float value)
+    :values((size_t)rows*cols), nrow{rows}, ncol{cols}
+    {
+        if (!std::isnan(value)) {
+            fill(value);
+        } else {
+#ifdef DEBUG
+            fill(NAN);
+#endif
+        }
+    }
+
+    FloatDenseMatrix::FloatDenseMatrix(FloatDenseMatrix&& move)
+    :values{std::move(move.values)}, nrow{move.nrow}, ncol{move.ncol}
+    {
+        move.nrow = 0;
+        move.ncol = 0;
+    }
+
+    FloatDenseMatrix& FloatDenseMatrix::operator=(FloatDenseMatrix&& other)
+    {
+        if (this != &other)
+        {
+            values = std::move(other.values);
+            nrow = other.nrow;
+            ncol = other.ncol;
+
+            other.values.clear();
+            other.nrow = 0;
+            other.ncol = 0;
+        }
+        return *this;
+    }
+
+    void FloatDenseMatrix::zero(){
+        fill(0);
+    }
+
+    void FloatDenseMatrix::fill(float value){
+        std::fill(values.begin(), values.end(), value);
+    }
+
+    void FloatDenseMatrix::set(const float *data){
+        memcpy(values.data(), data, values.size()*sizeof(float));
+    }
+
+    void FloatDenseMatrix::get(float *outData) const {
+        memcpy(outData, values.data(), values.size()*sizeof(float));
+    }
+
+    FloatDenseMatrix FloatDenseMatrix::copy() const {
+        FloatDenseMatrix dest(nrow, ncol);
+        dest.set(getData());
+        return dest;
+    }
+
+    DenseMatrix FloatDenseMatrix::toDouble() const {
+        DenseMatrix res(nrow, ncol);
+        double *data = res.getData();
+        for (size_t i = 0; i < values.size(); i++){
+            data[i] = values[i];
+        }
+        return res;
+    }
+
+    void FloatDenseMatrix::axpy(float alpha, const FloatDenseMatrix& x){
+#ifdef DEBUG
+        assert(nrow == x.nrow && ncol == x.ncol);
+#endif
+        float *y = getData();
+        const float *xData = x.getData();
+        size_t size = values.size();
+        for (size_t i = 0; i < size; i++){
+            y[i] += alpha*xData[i];
+        }
+    }
+
+    FloatDenseMatrix& FloatDenseMatrix::operator+=(const FloatDenseMatrix& RHS){
+        axpy(1, RHS);
+        return *this;
+    }
+
+    FloatDenseMatrix& FloatDenseMatrix::operator-=(const FloatDenseMatrix& RHS){
+        axpy(-1, RHS);
+        return *this;
+    }
+
+    FloatDenseMatrix& FloatDenseMatrix::operator*=(float RHS){
+        for (float &value : values){
+            value *= RHS;
+        }
+        return *this;
+    }
+
+    FloatDenseMatrix operator+(const FloatDenseMatrix& LHS, const FloatDenseMatrix& RHS){
+        FloatDenseMatrix res = LHS.copy();
+        res += RHS;
+        return res;
+    }
+
+    FloatDenseMatrix operator-(const FloatDenseMatrix& LHS, const FloatDenseMatrix& RHS){
+        FloatDenseMatrix res = LHS.copy();
+        res -= RHS;
+        return res;
+    }
+
+    FloatDenseMatrix operator*(const FloatDenseMatrix& LHS, float RHS){
+        FloatDenseMatrix res = LHS.copy();
+        res *= RHS;
+        return res;
+    }
+
+    FloatDenseMatrix operator*(float LHS, const FloatDenseMatrix& RHS){
+        return RHS * LHS;
+    }
+
+    double FloatDenseMatrix::dot(const FloatDenseMatrix& b) const {
+#ifdef DEBUG
+        assert(ncol == 1 || nrow == 1);
+        assert(b.ncol == ncol && b.nrow == nrow);
+#endif
+        const float *x = getData();
+        const float *y = b.getData();
+        double sum = 0;
+        for (size_t i = 0; i < values.size(); i++){
+            sum += (double)x[i]*y[i];
+        }
+        return sum;
+    }
+
+    double FloatDenseMatrix::length() const {
+#ifdef DEBUG
+        assert(ncol == 1 || nrow == 1);
+#endif
+        return sqrt(dot(*this));
+    }
+
+    double FloatDenseMatrix::norm(int norm) const {
+        double res = 0;
+        if (norm == 2){
+#ifdef DEBUG
+            assert(ncol == 1);
+#endif
+            return length();
+        }
+        if (norm == 1){
+            for (unsigned int c = 0; c < ncol; c++){
+                double sum = 0;
+                for (unsigned int r = 0; r < nrow; r++){
+                    sum += fabs((*this)(r, c));
+                }
+                res = max(res, sum);
+            }
+        } else {
+            for (unsigned int r = 0; r < nrow; r++){
+                double sum = 0;
+                for (unsigned int c = 0; c < ncol; c++){
+                    sum += fabs((*this)(r, c));
+                }
+                res = max(res, sum);
+            }
+        }
+        return res;
+    }
+
+    void FloatDenseMatrix::swap(FloatDenseMatrix& other){
+        std::swap(values, other.values);
+        std::swap(nrow, other.nrow);
+        std::swap(ncol, other.ncol);
+    }
+
+    void swap(FloatDenseMatrix& v1, FloatDenseMatrix& v2){
+        v1.swap(v2);
+    }
+
+    bool FloatDenseMatrix::operator==(const FloatDenseMatrix& RHS) const {
+        return nrow == RHS.nrow && ncol == RHS.ncol && values == RHS.values;
+    }
+
+    bool FloatDenseMatrix::operator!=(const FloatDenseMatrix& RHS) const {
+        return !(*this == RHS);
+    }
+
+    FloatDenseMatrix solve(const Factor& F, const FloatDenseMatrix& b){
+        return solve(F, b.toDouble()).toFloat();
+    }
+
+    ostream& operator<<(ostream& os, const FloatDenseMatrix& A){
+        os << "[";
+        for (int r = 0; r < A.getRows(); r++){
+            for (int c = 0; c < A.getColumns(); c++){
+                os << A(r, c);
+                if (c < A.getColumns()-1){
+                    os << ", ";
+                }
+            }
+            if (r < A.getRows()-1){
+                os << ";" << endl << " ";
+            }
+        }
+        os << "];" << endl;
+        return os;
+    }
+}
@@ -0,0 +1,116 @@
+//
+//  float_dense_matrix.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cmath>
+
+namespace oocholmod {
+
+    // forward declaration
+    class DenseMatrix;
+    class FloatSparseMatrix;
+    class Factor;
+
+    /// Dense matrix storing the values in single precision (column major). Used for float pipelines, where the
+    /// values are assembled, multiplied and iterated on in float and only converted to double where CHOLMOD
+    /// requires it (see toDouble() and solve(Factor, FloatDenseMatrix)). Reductions (dot, norm) accumulate in double.
+    class FloatDenseMatrix {
+    public:
+        // In debug the matrix will be initialized to NAN
+        // In release mode, NAN will leave the matrix uninitialized
+        FloatDenseMatrix(unsigned int rows = 0, unsigned int cols = 1, float value = NAN);
+
+        FloatDenseMatrix(FloatDenseMatrix&& move);
+
+        FloatDenseMatrix& operator=(FloatDenseMatrix&& other);
+
+        inline float& operator()(unsigned int row, unsigned int col = 0)
+        {
+#ifdef DEBUG
+            assert(row < nrow && col < ncol);
+#endif
+            return values[col*nrow + row];
+        }
+
+        inline float operator()(unsigned int row, unsigned int col = 0) const
+        {
+#ifdef DEBUG
+            assert(row < nrow && col < ncol);
+#endif
+            return values[col*nrow + row];
+        }
+
+        FloatDenseMatrix& operator+=(const FloatDenseMatrix& RHS);
+        FloatDenseMatrix& operator-=(const FloatDenseMatrix& RHS);
+        FloatDenseMatrix& operator*=(float RHS);
+
+        friend FloatDenseMatrix operator+(const FloatDenseMatrix& LHS, const FloatDenseMatrix& RHS);
+        friend FloatDenseMatrix operator-(const FloatDenseMatrix& LHS, const FloatDenseMatrix& RHS);
+        friend FloatDenseMatrix operator*(const FloatDenseMatrix& LHS, float RHS);
+        friend FloatDenseMatrix operator*(float LHS, const FloatDenseMatrix& RHS);
+
+        friend FloatDenseMatrix operator*(const FloatSparseMatrix& LHS, const FloatDenseMatrix& RHS);
+
+        /// y = alpha*x + y
+        void axpy(float alpha, const FloatDenseMatrix& x);
+
+        /// Returns the infinity-norm, 1-norm, or 2-norm (column vectors only)
+        ///  type of norm: 0: inf. norm, 1: 1-norm, 2: 2-norm
+        double norm(int norm) const;
+
+        double dot(const FloatDenseMatrix& b) const;
+        // computes the L^2 norm of the vector
+        double length() const;
+
+        inline float *getData(){ return values.data(); }
+        inline const float *getData() const { return values.data(); }
+
+        int getRows() const{ return nrow; }
+
+        int getColumns() const{ return ncol; }
+
+        FloatDenseMatrix copy() const;
+        void zero();
+        void fill(float value);
+        void set(const float *data);
+        void get(float *outData) const;
+
+        /// Converts to a double precision matrix (for example to solve with a Factor)
+        DenseMatrix toDouble() const;
+
+        void swap(FloatDenseMatrix& other);
+
+        bool operator==(const FloatDenseMatrix& RHS) const;
+        bool operator!=(const FloatDenseMatrix& RHS) const;
+    private:
+        FloatDenseMatrix(const FloatDenseMatrix& that) = delete; // prevent copy constructor
+        FloatDenseMatrix operator=(const FloatDenseMatrix& other) = delete; // prevent copy assignment operator
+        std::vector<float> values;
+        unsigned int nrow;
+        unsigned int ncol;
+    };
+
+    FloatDenseMatrix operator+(const FloatDenseMatrix& LHS, const FloatDenseMatrix& RHS);
+    FloatDenseMatrix operator-(const FloatDenseMatrix& LHS, const FloatDenseMatrix& RHS);
+    FloatDenseMatrix operator*(const FloatDenseMatrix& LHS, float RHS);
+    FloatDenseMatrix operator*(float LHS, const FloatDenseMatrix& RHS);
+
+    // Swap
+    void swap(FloatDenseMatrix& v1, FloatDenseMatrix& v2);
+
+    /// Solves Ax=b with the (double or single precision) factor of A. b is converted to double for the solve
+    /// and the solution back to float.
+    FloatDenseMatrix solve(const Factor& F, const FloatDenseMatrix& b);
+
+    // Print
+    std::ostream& operator<<(std::ostream& os, const FloatDenseMatrix& A);
+}
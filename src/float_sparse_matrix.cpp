@@ -0,0 +1,315 @@
+//
+//  float_sparse_matrix.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "float_sparse_matrix.h"
+#include "config_singleton.h"
+
+using namespace std;
+
+namespace oocholmod {
+
+    namespace {
+        // Returns false if the pattern does not fit in int indices
+        template<typename Int>
+        bool copyPattern(const cholmod_sparse *sparse, vector<int>& columnPointers, vector<int>& rowIndices, vector<float>& values){
+            const Int *Ap = (const Int*)sparse->p;
+            const Int *Ai = (const Int*)sparse->i;
+            const double *Ax = (const double*)sparse->x;
+            size_t nz = Ap[sparse->ncol];
+            if (nz > INT32_MAX || sparse->nrow > INT32_MAX || sparse->ncol > INT32_MAX){
+                return false;
+            }
+            columnPointers.assign(Ap, Ap + sparse->ncol + 1);
+            rowIndices.assign(Ai, Ai + nz);
+            values.resize(nz);
+            for (size_t k = 0; k < nz; k++){
+                values[k] = (float)Ax[k];
+            }
+            return true;
+        }
+        
+        // y += A x for the columns [from, to) of an unsymmetric A
+        inline void scatterColumns(const int *Ap, const int *Ai, const float *Ax, const float *x, float *y, long from, long to){
+            for (long j = from; j < to; j++){
+                float xj = x[j];
+                for (int p = Ap[j]; p < Ap[j+1]; p++){
+                    y[Ai[p]] += Ax[p]*xj;
+                }
+            }
+        }
+    }
+
+    FloatSparseMatrix::FloatSparseMatrix(unsigned int nrow, unsigned int ncol, bool symmetric, size_t initialNumberOfElements)
+    :nrow{nrow}, ncol{ncol}, symmetry{symmetric && nrow == ncol ? SYMMETRIC_UPPER : ASYMMETRIC}, built{false}
+    {
+        tripletRows.reserve(initialNumberOfElements);
+        tripletColumns.reserve(initialNumberOfElements);
+        values.reserve(initialNumberOfElements);
+    }
+
+    FloatSparseMatrix::FloatSparseMatrix(const SparseMatrix& A)
+    :nrow{static_cast<unsigned int>(A.getRows())}, ncol{static_cast<unsigned int>(A.getColumns())}, symmetry{A.getSymmetry()}, built{true}
+    {
+#ifdef DEBUG
+        assert(A.getMatrixState() == BUILT);
+        assert(A.sparse->packed);
+#endif
+        bool fits = A.getIndexType() == INDEX_LONG ?
+            copyPattern<SuiteSparse_long>(A.sparse, columnPointers, rowIndices, values) :
+            copyPattern<int>(A.sparse, columnPointers, rowIndices, values);
+        if (!fits){
+            std::cerr<<"Cannot convert the sparse matrix to a FloatSparseMatrix: its indices do not fit in int\n";
+            nrow = 0;
+            ncol = 0;
+            built = false;
+        }
+    }
+
+    FloatSparseMatrix::FloatSparseMatrix(FloatSparseMatrix&& move)
+    :nrow{move.nrow}, ncol{move.ncol}, symmetry{move.symmetry}, built{move.built}, columnPointers{std::move(move.columnPointers)},
+    rowIndices{std::move(move.rowIndices)}, tripletRows{std::move(move.tripletRows)}, tripletColumns{std::move(move.tripletColumns)},
+    values{std::move(move.values)}
+    {
+        move.nrow = 0;
+        move.ncol = 0;
+        move.built = false;
+    }
+
+    FloatSparseMatrix& FloatSparseMatrix::operator=(FloatSparseMatrix&& other){
+        if (this != &other){
+            nrow = other.nrow;
+            ncol = other.ncol;
+            symmetry = other.symmetry;
+            built = other.built;
+            columnPointers = std::move(other.columnPointers);
+            rowIndices = std::move(other.rowIndices);
+            tripletRows = std::move(other.tripletRows);
+            tripletColumns = std::move(other.tripletColumns);
+            values = std::move(other.values);
+
+            other.nrow = 0;
+            other.ncol = 0;
+            other.built = false;
+        }
+        return *this;
+    }
+
+    MatrixState FloatSparseMatrix::getMatrixState() const {
+        if (nrow == 0 && ncol == 0){
+            return DESTROYED;
+        }
+        if (built){
+            return BUILT;
+        }
+        return tripletRows.empty() ? UNINITIALIZED : INIT;
+    }
+
+    void FloatSparseMatrix::build(){
+#ifdef DEBUG
+        assert(!built);
+#endif
+        size_t size = tripletRows.size();
+#ifdef DEBUG
+        assert(size <= INT32_MAX);
+#endif
+        if (symmetry != ASYMMETRIC){
+            for (size_t k = 0; k < size; k++){
+                int &row = tripletRows[k];
+                int &column = tripletColumns[k];
+                if ((symmetry == SYMMETRIC_UPPER && row > column) || (symmetry == SYMMETRIC_LOWER && row < column)){
+                    std::swap(row, column);
+                }
+            }
+        }
+        // counting sort by column (keeps the assembly order within each column)
+        columnPointers.assign(ncol+1, 0);
+        for (int column : tripletColumns){
+            columnPointers[column+1]++;
+        }
+        for (unsigned int j = 0; j < ncol; j++){
+            columnPointers[j+1] += columnPointers[j];
+        }
+        vector<int> next(columnPointers.begin(), columnPointers.end()-1);
+        rowIndices.resize(size);
+        vector<float> columnValues(size);
+        for (size_t k = 0; k < size; k++){
+            int index = next[tripletColumns[k]]++;
+            rowIndices[index] = tripletRows[k];
+            columnValues[index] = values[k];
+        }
+        vector<int>().swap(tripletRows);
+        vector<int>().swap(tripletColumns);
+
+        // sort the rows of each column and sum duplicates
+        vector<pair<int, float>> column;
+        int position = 0;
+        for (unsigned int j = 0; j < ncol; j++){
+            int from = columnPointers[j], to = columnPointers[j+1];
+            column.clear();
+            for (int k = from; k < to; k++){
+                column.push_back(make_pair(rowIndices[k], columnValues[k]));
+            }
+            stable_sort(column.begin(), column.end(),
+                        [](const pair<int, float> &a, const pair<int, float> &b){ return a.first < b.first; });
+            columnPointers[j] = position;
+            for (size_t k = 0; k < column.size(); k++){
+                if (position > columnPointers[j] && rowIndices[position-1] == column[k].first){
+                    columnValues[position-1] += column[k].second;
+                } else {
+                    rowIndices[position] = column[k].first;
+                    columnValues[position] = column[k].second;
+                    position++;
+                }
+            }
+        }
+        columnPointers[ncol] = position;
+        rowIndices.resize(position);
+        columnValues.resize(position);
+        rowIndices.shrink_to_fit();
+        columnValues.shrink_to_fit();
+        values.swap(columnValues);
+        built = true;
+    }
+
+    SparseMatrix FloatSparseMatrix::toDouble() const {
+#ifdef DEBUG
+        assert(built);
+#endif
+        size_t nz = columnPointers[ncol];
+        cholmod_sparse *sparse = cholmod_allocate_sparse(nrow, ncol, max<size_t>(nz, 1), true, true, symmetry, CHOLMOD_REAL,
+                                                         ConfigSingleton::getCommonPtr());
+        memcpy(sparse->p, columnPointers.data(), (ncol+1)*sizeof(int));
+        memcpy(sparse->i, rowIndices.data(), nz*sizeof(int));
+        double *x = (double*)sparse->x;
+        for (size_t k = 0; k < nz; k++){
+            x[k] = values[k];
+        }
+        return SparseMatrix(sparse);
+    }
+
+    FloatDenseMatrix operator*(const FloatSparseMatrix& LHS, const FloatDenseMatrix& RHS){
+#ifdef DEBUG
+        assert(LHS.built);
+        assert(LHS.ncol == (unsigned int)RHS.getRows());
+#endif
+        const int *Ap = LHS.columnPointers.data();
+        const int *Ai = LHS.rowIndices.data();
+        const float *Ax = LHS.values.data();
+        bool symmetric = LHS.symmetry != ASYMMETRIC;
+        long nrow = LHS.nrow, ncol = LHS.ncol;
+        int columns = RHS.getColumns();
+        FloatDenseMatrix res(LHS.nrow, columns, 0.f);
+#ifdef _OPENMP
+        // A single column of an unsymmetric matrix is split in chunks of columns, each scattered into a partial y of
+        // its thread, which are summed in parallel. The partial vectors are only used if they are smaller than A.
+        int threads = omp_get_max_threads();
+        if (!symmetric && columns == 1 && threads > 1 && (long)LHS.values.size() >= threads*nrow){
+            const float *x = RHS.getData();
+            float *y = res.getData();
+            vector<float> partial((size_t)(threads-1)*nrow, 0.f);
+#pragma omp parallel num_threads(threads)
+            {
+                int t = omp_get_thread_num();
+                int count = omp_get_num_threads();
+                float *yt = t == 0 ? y : partial.data() + (size_t)(t-1)*nrow;
+                scatterColumns(Ap, Ai, Ax, x, yt, ncol*t/count, ncol*(t+1)/count);
+#pragma omp barrier
+#pragma omp for schedule(static)
+                for (long i = 0; i < nrow; i++){
+                    float sum = 0;
+                    for (int k = 1; k < count; k++){
+                        sum += partial[(size_t)(k-1)*nrow + i];
+                    }
+                    y[i] += sum;
+                }
+            }
+            return res;
+        }
+#endif
+        // the columns of y are independent
+#pragma omp parallel for schedule(dynamic, 1) if(columns > 1)
+        for (int c = 0; c < columns; c++){
+            const float *x = RHS.getData() + (size_t)c*RHS.getRows();
+            float *y = res.getData() + (size_t)c*nrow;
+            if (!symmetric){
+                scatterColumns(Ap, Ai, Ax, x, y, 0, ncol);
+                continue;
+            }
+            for (long j = 0; j < ncol; j++){
+                float xj = x[j];
+                float sum = 0; // row j of the transposed part of a symmetric matrix
+                for (int p = Ap[j]; p < Ap[j+1]; p++){
+                    int i = Ai[p];
+                    y[i] += Ax[p]*xj;
+                    if (i != (int)j){
+                        sum += Ax[p]*x[i];
+                    }
+                }
+                y[j] += sum;
+            }
+        }
+        return res;
+    }
+
+    size_t FloatSparseMatrix::getNumberOfElements() const {
+        return built ? columnPointers[ncol] : tripletRows.size();
+    }
+
+    bool FloatSparseMatrix::hasElement(unsigned int row, unsigned int column) const {
+        return getIndex(row, column) != -1;
+    }
+
+    void FloatSparseMatrix::zero(){
+        std::fill(values.begin(), values.end(), 0.f);
+    }
+
+    bool FloatSparseMatrix::operator==(const FloatSparseMatrix& RHS) const {
+        for (unsigned int r = 0; r < nrow; r++){
+            for (unsigned int c = 0; c < ncol; c++){
+                if ((*this)(r, c) != RHS(r, c)){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool FloatSparseMatrix::operator!=(const FloatSparseMatrix& RHS) const {
+        return !(*this == RHS);
+    }
+
+    ostream& operator<<(ostream& os, const FloatSparseMatrix& A){
+        os << endl;
+        if (A.getMatrixState() != BUILT){
+            os << "[Sparse matrix not built]" << endl;
+            return os;
+        }
+        os << "[";
+        for (int r = 0; r < A.getRows(); r++){
+            for (int c = 0; c < A.getColumns(); c++){
+                os << A(r, c);
+                if (c < A.getColumns()-1){
+                    os << ", ";
+                }
+            }
+            if (r < A.getRows()-1){
+                os << ";" << endl << " ";
+            }
+        }
+        os << "];" << endl;
+        return os;
+    }
+}
@@ -0,0 +1,135 @@
+//
+//  float_sparse_matrix.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <vector>
+#include <iostream>
+
+#include "sparse_matrix.h"
+#include "float_dense_matrix.h"
+
+namespace oocholmod {
+
+    /// Sparse matrix (CSC with 32 bit indices) storing the values in single precision. It is used like SparseMatrix:
+    /// 1. Fill the matrix elements using the (unsigned int row, unsigned int column) function operator
+    /// 2. Call build()
+    /// 3. Update matrix with elements using the (unsigned int row, unsigned int column) function operator
+    ///
+    /// Assembly and multiplication move half the value bytes of SparseMatrix. CHOLMOD only factorizes double
+    /// precision matrices, so use toDouble() to analyze and factorize.
+    class FloatSparseMatrix {
+    public:
+        FloatSparseMatrix(unsigned int nrow = 0, unsigned int ncol = 1, bool symmetric = false, size_t initialNumberOfElements = 200);
+        /// Copies the pattern of a built matrix and converts the values to float. If the indices of an INDEX_LONG
+        /// matrix do not fit in int, an error is printed and the result is an empty matrix that is not built.
+        explicit FloatSparseMatrix(const SparseMatrix& A);
+        FloatSparseMatrix(FloatSparseMatrix&& move);
+        FloatSparseMatrix& operator=(FloatSparseMatrix&& other);
+
+        MatrixState getMatrixState() const;
+
+        /// Sorts the elements into columns and sums duplicates. Elements in the lower triangular part of a
+        /// symmetric matrix are moved to the upper triangular part.
+        void build();
+
+        /// Converts to a double precision SparseMatrix (for example to analyze and factorize)
+        SparseMatrix toDouble() const;
+
+        friend FloatDenseMatrix operator*(const FloatSparseMatrix& LHS, const FloatDenseMatrix& RHS);
+
+        // in init state return the number of triplets
+        // in built state returns the number of elements
+        size_t getNumberOfElements() const;
+
+        // hasElement only valid on built matrix
+        bool hasElement(unsigned int row, unsigned int column) const;
+
+        void zero();
+
+        Symmetry getSymmetry() const { return symmetry; }
+
+        int getRows() const { return nrow; }
+
+        int getColumns() const { return ncol; }
+
+        inline float operator()(unsigned int row, unsigned int column = 0) const
+        {
+            int index = getIndex(row, column);
+            return index == -1 ? 0 : values[index];
+        }
+
+        inline float& operator()(unsigned int row, unsigned int column = 0)
+        {
+#ifdef DEBUG
+            assert(row < nrow && column < ncol);
+#endif
+            if (!built){
+                tripletRows.push_back(row);
+                tripletColumns.push_back(column);
+                values.push_back(0);
+                return values.back();
+            }
+            int index = getIndex(row, column);
+            if (index == -1){
+                static float zero = 0;
+                zero = 0;
+                return zero;
+            }
+            return values[index];
+        }
+
+        bool operator==(const FloatSparseMatrix& RHS) const;
+        bool operator!=(const FloatSparseMatrix& RHS) const;
+    private:
+        FloatSparseMatrix(const FloatSparseMatrix& that) = delete; // prevent copy constructor
+        FloatSparseMatrix operator=(const FloatSparseMatrix& other) = delete; // prevent copy assignment operator
+
+        inline int getIndex(unsigned int row, unsigned int column) const
+        {
+#ifdef DEBUG
+            assert(built);
+            assert(row < nrow && column < ncol);
+#endif
+            if ((symmetry == SYMMETRIC_UPPER && row > column) || (symmetry == SYMMETRIC_LOWER && row < column)) {
+                std::swap(row, column);
+            }
+            int low = columnPointers[column];
+            int high = columnPointers[column+1]-1;
+            while (low <= high){
+                int midpoint = (((unsigned int)high + (unsigned int)low) >> 1);
+                int midpointValue = rowIndices[midpoint];
+                if ((int)row == midpointValue){
+                    return midpoint;
+                } else if ((int)row < midpointValue){
+                    high = midpoint - 1;
+                } else {
+                    low = midpoint + 1;
+                }
+            }
+            return -1;
+        }
+
+        unsigned int nrow;
+        unsigned int ncol;
+        Symmetry symmetry;
+        bool built;
+        std::vector<int> columnPointers; // built state
+        std::vector<int> rowIndices;
+        std::vector<int> tripletRows;    // init state
+        std::vector<int> tripletColumns;
+        std::vector<float> values;       // triplet values in init state
+    };
+
+    /// Sparse matrix times dense matrix, in parallel over the columns of the result (and for a single column of an
+    /// unsymmetric matrix with many elements per row, over chunks of the columns of LHS) when compiled with OpenMP
+    FloatDenseMatrix operator*(const FloatSparseMatrix& LHS, const FloatDenseMatrix& RHS);
+
+    // Print
+    std::ostream& operator<<(std::ostream& os, const FloatSparseMatrix& A);
+}
@@ -0,0 +1,259 @@
+//
+//  lu_factor.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include "lu_factor.h"
+
+#include <cassert>
+
+#include "solver_stats.h"
+
+using namespace std;
+
+namespace oocholmod {
+
+    namespace {
+        // the klu_* (int) and klu_l_* (SuiteSparse_long) functions
+        template<typename Int>
+        struct KLU;
+
+        template<>
+        struct KLU<int> {
+            typedef klu_common Common;
+            typedef klu_symbolic Symbolic;
+            typedef klu_numeric Numeric;
+            static Symbolic *analyze(int n, int *Ap, int *Ai, Common *c){ return klu_analyze(n, Ap, Ai, c); }
+            static Numeric *factor(int *Ap, int *Ai, double *Ax, Symbolic *S, Common *c){ return klu_factor(Ap, Ai, Ax, S, c); }
+            static int refactor(int *Ap, int *Ai, double *Ax, Symbolic *S, Numeric *N, Common *c){ return klu_refactor(Ap, Ai, Ax, S, N, c); }
+            static int solve(Symbolic *S, Numeric *N, int d, int nrhs, double *B, Common *c){ return klu_solve(S, N, d, nrhs, B, c); }
+            static int tsolve(Symbolic *S, Numeric *N, int d, int nrhs, double *B, Common *c){ return klu_tsolve(S, N, d, nrhs, B, c); }
+            static int rcond(Symbolic *S, Numeric *N, Common *c){ return klu_rcond(S, N, c); }
+            static void freeNumeric(Numeric **N, Common *c){ klu_free_numeric(N, c); }
+            static void freeSymbolic(Symbolic **S, Common *c){ klu_free_symbolic(S, c); }
+        };
+
+        template<>
+        struct KLU<SuiteSparse_long> {
+            typedef SuiteSparse_long Int;
+            typedef klu_l_common Common;
+            typedef klu_l_symbolic Symbolic;
+            typedef klu_l_numeric Numeric;
+            static Symbolic *analyze(Int n, Int *Ap, Int *Ai, Common *c){ return klu_l_analyze(n, Ap, Ai, c); }
+            static Numeric *factor(Int *Ap, Int *Ai, double *Ax, Symbolic *S, Common *c){ return klu_l_factor(Ap, Ai, Ax, S, c); }
+            static int refactor(Int *Ap, Int *Ai, double *Ax, Symbolic *S, Numeric *N, Common *c){ return klu_l_refactor(Ap, Ai, Ax, S, N, c); }
+            static int solve(Symbolic *S, Numeric *N, Int d, Int nrhs, double *B, Common *c){ return klu_l_solve(S, N, d, nrhs, B, c); }
+            static int tsolve(Symbolic *S, Numeric *N, Int d, Int nrhs, double *B, Common *c){ return klu_l_tsolve(S, N, d, nrhs, B, c); }
+            static int rcond(Symbolic *S, Numeric *N, Common *c){ return klu_l_rcond(S, N, c); }
+            static void freeNumeric(Numeric **N, Common *c){ klu_l_free_numeric(N, c); }
+            static void freeSymbolic(Symbolic **S, Common *c){ klu_l_free_symbolic(S, c); }
+        };
+
+        // Refactorizations keep the pivots of the last full factorization. If the estimated reciprocal condition
+        // number drops below this fraction of the one of the full factorization, the pivots are chosen again.
+        const double refactorTolerance = 1e-3;
+
+        template<typename Int>
+        size_t numberOfElements(const cholmod_sparse *A){
+            return ((const Int*)A->p)[A->ncol];
+        }
+
+        template<typename Int>
+        void *analyzeKLU(const cholmod_sparse *A, typename KLU<Int>::Common& common){
+            return KLU<Int>::analyze((Int)A->ncol, (Int*)A->p, (Int*)A->i, &common);
+        }
+
+        // Returns false if A is singular. refactorizations is incremented if the pivots were reused.
+        template<typename Int>
+        bool factorizeKLU(const cholmod_sparse *A, void *symbolic, void *&numeric, typename KLU<Int>::Common& common,
+                          double& rcond, double& pivotRcond, int& refactorizations){
+            typedef KLU<Int> K;
+            auto S = (typename K::Symbolic*)symbolic;
+            auto N = (typename K::Numeric*)numeric;
+            Int *Ap = (Int*)A->p;
+            Int *Ai = (Int*)A->i;
+            double *Ax = (double*)A->x;
+            if (N){
+                if (K::refactor(Ap, Ai, Ax, S, N, &common) && common.status == KLU_OK && K::rcond(S, N, &common)
+                    && common.rcond >= refactorTolerance*pivotRcond){
+                    rcond = common.rcond;
+                    refactorizations++;
+                    return true;
+                }
+                K::freeNumeric(&N, &common);
+            }
+            N = K::factor(Ap, Ai, Ax, S, &common);
+            numeric = N;
+            if (N == nullptr || common.status != KLU_OK){
+                return false;
+            }
+            K::rcond(S, N, &common);
+            rcond = pivotRcond = common.rcond;
+            return true;
+        }
+
+        template<typename Int>
+        void solveKLU(void *symbolic, void *numeric, DenseMatrix& b, bool transpose, typename KLU<Int>::Common& common){
+            typedef KLU<Int> K;
+            auto S = (typename K::Symbolic*)symbolic;
+            auto N = (typename K::Numeric*)numeric;
+            if (transpose){
+                K::tsolve(S, N, b.getLeadingDimension(), b.getColumns(), b.getData(), &common);
+            } else {
+                K::solve(S, N, b.getLeadingDimension(), b.getColumns(), b.getData(), &common);
+            }
+        }
+
+        template<typename Int>
+        void freeKLU(void *&symbolic, void *&numeric, typename KLU<Int>::Common& common){
+            auto S = (typename KLU<Int>::Symbolic*)symbolic;
+            auto N = (typename KLU<Int>::Numeric*)numeric;
+            KLU<Int>::freeNumeric(&N, &common);
+            KLU<Int>::freeSymbolic(&S, &common);
+            symbolic = nullptr;
+            numeric = nullptr;
+        }
+    }
+
+    LUFactor::LUFactor()
+    :indexType{INDEX_INT}, n{0}, elements{0}, symbolic{nullptr}, numeric{nullptr}, rcond{0}, pivotRcond{0},
+    refactorizations{0}
+    {
+        klu_defaults(&common);
+        klu_l_defaults(&longCommon);
+    }
+
+    LUFactor::LUFactor(LUFactor&& move)
+    :indexType{move.indexType}, n{move.n}, elements{move.elements}, symbolic{move.symbolic}, numeric{move.numeric},
+    common(move.common), longCommon(move.longCommon), rcond{move.rcond}, pivotRcond{move.pivotRcond},
+    refactorizations{move.refactorizations}
+    {
+        move.symbolic = nullptr;
+        move.numeric = nullptr;
+    }
+
+    LUFactor& LUFactor::operator=(LUFactor&& other){
+        if (this != &other){
+            release();
+            indexType = other.indexType;
+            n = other.n;
+            elements = other.elements;
+            symbolic = other.symbolic;
+            numeric = other.numeric;
+            common = other.common;
+            longCommon = other.longCommon;
+            rcond = other.rcond;
+            pivotRcond = other.pivotRcond;
+            refactorizations = other.refactorizations;
+
+            // clean up
+            other.symbolic = nullptr;
+            other.numeric = nullptr;
+        }
+        return *this;
+    }
+
+    LUFactor::~LUFactor(){
+        release();
+    }
+
+    void LUFactor::release(){
+        if (indexType == INDEX_LONG){
+            freeKLU<SuiteSparse_long>(symbolic, numeric, longCommon);
+        } else {
+            freeKLU<int>(symbolic, numeric, common);
+        }
+    }
+
+    bool LUFactor::isInitialized() const {
+        return numeric != nullptr;
+    }
+
+    bool LUFactor::analyze(const SparseMatrix& A){
+#ifdef DEBUG
+        assert(A.sparse);
+        assert(A.nrow == A.ncol);
+#endif
+        ScopedTimer timer("lu analyze");
+        release();
+        SparseMatrix full;
+        const SparseMatrix *M = &A;
+        if (A.symmetry != ASYMMETRIC){
+            full = A.copy();
+            full.expand();
+            M = &full;
+        }
+        indexType = A.indexType;
+        n = A.nrow;
+        refactorizations = 0;
+        if (indexType == INDEX_LONG){
+            elements = numberOfElements<SuiteSparse_long>(M->sparse);
+            symbolic = analyzeKLU<SuiteSparse_long>(M->sparse, longCommon);
+        } else {
+            elements = numberOfElements<int>(M->sparse);
+            symbolic = analyzeKLU<int>(M->sparse, common);
+        }
+        timer.setSuccess(symbolic != nullptr);
+        return symbolic != nullptr;
+    }
+
+    bool LUFactor::factorize(const SparseMatrix& A){
+#ifdef DEBUG
+        assert(symbolic);
+        assert(A.sparse && A.sparse->packed);
+        assert(A.indexType == indexType);
+        assert((size_t)A.nrow == n);
+#endif
+        ScopedTimer timer("lu factorize");
+        SparseMatrix full;
+        const SparseMatrix *M = &A;
+        if (A.symmetry != ASYMMETRIC){
+            full = A.copy();
+            full.expand();
+            M = &full;
+        }
+#ifdef DEBUG
+        assert((indexType == INDEX_LONG ? numberOfElements<SuiteSparse_long>(M->sparse)
+                                        : numberOfElements<int>(M->sparse)) == elements);
+#endif
+        bool success;
+        if (indexType == INDEX_LONG){
+            success = factorizeKLU<SuiteSparse_long>(M->sparse, symbolic, numeric, longCommon, rcond, pivotRcond,
+                                                     refactorizations);
+        } else {
+            success = factorizeKLU<int>(M->sparse, symbolic, numeric, common, rcond, pivotRcond, refactorizations);
+        }
+        timer.setSuccess(success);
+        return success;
+    }
+
+    void LUFactor::solveInPlace(DenseMatrix& b, bool transpose) const {
+#ifdef DEBUG
+        assert(numeric);
+        assert((size_t)b.getRows() == n);
+#endif
+        ScopedTimer timer("lu solve");
+        if (indexType == INDEX_LONG){
+            solveKLU<SuiteSparse_long>(symbolic, numeric, b, transpose, longCommon);
+        } else {
+            solveKLU<int>(symbolic, numeric, b, transpose, common);
+        }
+    }
+
+    DenseMatrix solve(const LUFactor& F, const DenseMatrix& b){
+        DenseMatrix x = b.copy();
+        F.solveInPlace(x);
+        return x;
+    }
+
+    DenseMatrix&& solve(const LUFactor& F, DenseMatrix&& b){
+        if (b.isView()){
+            b = b.copy(); // the data of a view belongs to another matrix
+        }
+        F.solveInPlace(b);
+        return move(b);
+    }
+}
@@ -0,0 +1,66 @@
+//
+//  lu_factor.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <klu.h>
+
+#include "sparse_matrix.h"
+#include "dense_matrix.h"
+
+namespace oocholmod {
+
+    /// Sparse LU factorization (KLU from SuiteSparse) of a square unsymmetric SparseMatrix, such as circuit and
+    /// convection matrices. A symmetric matrix is expanded to both triangular parts first.
+    ///
+    /// analyze computes the ordering once. The first factorize chooses the pivots; later factorizations of a matrix
+    /// with the same pattern reuse them (a refactorization without searching for pivots), unless the pivots have
+    /// become too small, in which case the matrix is factorized again with new pivots.
+    class LUFactor {
+    public:
+        LUFactor();
+        LUFactor(LUFactor&& move);
+        LUFactor& operator=(LUFactor&& other);
+        virtual ~LUFactor();
+
+        // Return false if the analysis failed
+        bool analyze(const SparseMatrix& A);
+        // returns true if factorization is done
+        // Return false if matrix is singular. A must have the pattern given to analyze.
+        bool factorize(const SparseMatrix& A);
+
+        // overwrites b with the solution of Ax=b (or A'x=b) (b may contain multiple right hand sides)
+        void solveInPlace(DenseMatrix& b, bool transpose = false) const;
+
+        friend DenseMatrix solve(const LUFactor& F, const DenseMatrix& b);
+        friend DenseMatrix&& solve(const LUFactor& F, DenseMatrix&& b);
+
+        /// Cheap estimate of the reciprocal condition number, min|U(k,k)|/max|U(k,k)|, of the last factorization
+        double getReciprocalCondition() const { return rcond; }
+        /// Number of factorizations that reused the pivots of a previous factorization
+        int getNumberOfRefactorizations() const { return refactorizations; }
+
+        bool isInitialized() const;
+    private:
+        LUFactor(const LUFactor& that) = delete; // prevent copy constructor
+        void release();
+        IndexType indexType;
+        size_t n;
+        size_t elements;
+        void *symbolic;     // klu_symbolic or klu_l_symbolic
+        void *numeric;      // klu_numeric or klu_l_numeric
+        mutable klu_common common;
+        mutable klu_l_common longCommon;
+        double rcond;
+        double pivotRcond;  // rcond of the last factorization that chose the pivots
+        int refactorizations;
+    };
+
+    DenseMatrix solve(const LUFactor& F, const DenseMatrix& b);
+    DenseMatrix&& solve(const LUFactor& F, DenseMatrix&& b);
+}
@@ -0,0 +1,74 @@
+//
+//  mapped_file.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+namespace oocholmod {
+    
+    MappedFile::MappedFile(const char *name, bool writable)
+    :fileData{nullptr}, fileSize{0}, mapped{false}, open{false}
+    {
+#ifdef _WIN32
+        ifstream in(name, ios::binary);
+        if (in){
+            buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+            fileData = buffer.data();
+            fileSize = buffer.size();
+            open = true;
+        }
+#else
+        int fd = ::open(name, O_RDONLY);
+        struct stat info;
+        if (fd >= 0 && fstat(fd, &info) == 0){
+            fileSize = info.st_size;
+            if (fileSize == 0){
+                open = true;
+            } else {
+                int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+                void *address = mmap(nullptr, fileSize, protection, MAP_PRIVATE, fd, 0);
+                if (address != MAP_FAILED){
+                    fileData = (char*)address;
+                    mapped = true;
+                    open = true;
+                }
+            }
+        }
+        if (fd >= 0){
+            close(fd);
+        }
+#endif
+    }
+    
+    MappedFile::~MappedFile(){
+#ifndef _WIN32
+        if (mapped){
+            munmap(fileData, fileSize);
+        }
+#endif
+    }
+    
+    void MappedFile::adviseSequential(){
+#ifndef _WIN32
+        if (mapped){
+            madvise(fileData, fileSize, MADV_SEQUENTIAL);
+        }
+#endif
+    }
+}
@@ -0,0 +1,40 @@
+//
+//  mapped_file.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace oocholmod {
+    
+    /// A whole file mapped into memory. Pages are only read from disk when they are accessed.
+    /// A writable mapping is private (copy-on-write): changes are never written back to the file.
+    /// On platforms without mmap the file is read into memory.
+    class MappedFile {
+    public:
+        MappedFile(const char *name, bool writable = false);
+        ~MappedFile();
+        
+        bool isOpen() const { return open; }
+        char *begin() const { return fileData; }
+        char *end() const { return fileData + fileSize; }
+        size_t size() const { return fileSize; }
+        
+        /// Hint that the file will be read from beginning to end (enables aggressive read-ahead)
+        void adviseSequential();
+    private:
+        MappedFile(const MappedFile& that) = delete;
+        MappedFile& operator=(const MappedFile& other) = delete;
+        char *fileData;
+        size_t fileSize;
+        bool mapped;
+        bool open;
+        std::vector<char> buffer;
+    };
+}
@@ -7,50 +7,558 @@
 //
 
 #include "oo_blas.h"
+#include "oo_blas_kernels.h"
 
 #include <cassert>
 #include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <vector>
 #include <iostream>
 
-#ifdef NO_BLAS
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OO_BLAS_AVX2_DISPATCH
+#include <immintrin.h>
+#define OO_BLAS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
 
 using namespace std;
 
+namespace oocholmod {
+    namespace kernels {
+
+        namespace {
+            // block sizes of the packed dgemm (MR x NR is the register tile of the micro kernel)
+            const int MR = 8;
+            const int NR = 6;
+            const int MC = 128;
+            const int KC = 256;
+            const int NC = 3072;
+
+            // vectors shorter than this are not split between threads
+            const int PARALLEL_LENGTH = 1 << 16;
+
+            bool detectAVX2(){
+#ifdef OO_BLAS_AVX2_DISPATCH
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+                return false;
+#endif
+            }
+
+            inline int startIndex(int n, int inc){
+                return inc < 0 ? (1-n)*inc : 0;
+            }
+
+            double ddotScalar(int n, const double *x, const double *y){
+                double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+                int i = 0;
+                for (; i+4 <= n; i += 4){
+                    s0 += x[i]*y[i];
+                    s1 += x[i+1]*y[i+1];
+                    s2 += x[i+2]*y[i+2];
+                    s3 += x[i+3]*y[i+3];
+                }
+                for (; i < n; i++){
+                    s0 += x[i]*y[i];
+                }
+                return (s0+s1)+(s2+s3);
+            }
+
+            void daxpyScalar(int n, double alpha, const double *x, double *y){
+                for (int i = 0; i < n; i++){
+                    y[i] += alpha*x[i];
+                }
+            }
+
+            void dscalScalar(int n, double alpha, double *x){
+                for (int i = 0; i < n; i++){
+                    x[i] *= alpha;
+                }
+            }
+
+            // y += A(:, 0:3) * a for four columns at a time
+            void gemvColumnsScalar(int m, const double *A0, const double *A1, const double *A2, const double *A3,
+                                   const double *a, double *y){
+                for (int i = 0; i < m; i++){
+                    y[i] += A0[i]*a[0] + A1[i]*a[1] + A2[i]*a[2] + A3[i]*a[3];
+                }
+            }
+
+            void microKernelScalar(int kc, const double *a, const double *b, double alpha, double *C, int ldc, int mr, int nr){
+                double acc[MR*NR] = {0};
+                for (int p = 0; p < kc; p++){
+                    for (int j = 0; j < NR; j++){
+                        double bj = b[j];
+                        for (int i = 0; i < MR; i++){
+                            acc[j*MR + i] += a[i]*bj;
+                        }
+                    }
+                    a += MR;
+                    b += NR;
+                }
+                for (int j = 0; j < nr; j++){
+                    for (int i = 0; i < mr; i++){
+                        C[j*ldc + i] += alpha*acc[j*MR + i];
+                    }
+                }
+            }
+
+#ifdef OO_BLAS_AVX2_DISPATCH
+            OO_BLAS_TARGET_AVX2 double ddotAVX2(int n, const double *x, const double *y){
+                __m256d s0 = _mm256_setzero_pd();
+                __m256d s1 = _mm256_setzero_pd();
+                __m256d s2 = _mm256_setzero_pd();
+                __m256d s3 = _mm256_setzero_pd();
+                int i = 0;
+                for (; i+16 <= n; i += 16){
+                    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i), s0);
+                    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i+4), _mm256_loadu_pd(y+i+4), s1);
+                    s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i+8), _mm256_loadu_pd(y+i+8), s2);
+                    s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i+12), _mm256_loadu_pd(y+i+12), s3);
+                }
+                for (; i+4 <= n; i += 4){
+                    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i), s0);
+                }
+                s0 = _mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3));
+                double lanes[4];
+                _mm256_storeu_pd(lanes, s0);
+                double sum = (lanes[0]+lanes[1])+(lanes[2]+lanes[3]);
+                for (; i < n; i++){
+                    sum += x[i]*y[i];
+                }
+                return sum;
+            }
+
+            OO_BLAS_TARGET_AVX2 void daxpyAVX2(int n, double alpha, const double *x, double *y){
+                __m256d a = _mm256_set1_pd(alpha);
+                int i = 0;
+                for (; i+8 <= n; i += 8){
+                    _mm256_storeu_pd(y+i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i)));
+                    _mm256_storeu_pd(y+i+4, _mm256_fmadd_pd(a, _mm256_loadu_pd(x+i+4), _mm256_loadu_pd(y+i+4)));
+                }
+                for (; i < n; i++){
+                    y[i] += alpha*x[i];
+                }
+            }
+
+            OO_BLAS_TARGET_AVX2 void dscalAVX2(int n, double alpha, double *x){
+                __m256d a = _mm256_set1_pd(alpha);
+                int i = 0;
+                for (; i+8 <= n; i += 8){
+                    _mm256_storeu_pd(x+i, _mm256_mul_pd(a, _mm256_loadu_pd(x+i)));
+                    _mm256_storeu_pd(x+i+4, _mm256_mul_pd(a, _mm256_loadu_pd(x+i+4)));
+                }
+                for (; i < n; i++){
+                    x[i] *= alpha;
+                }
+            }
+
+            OO_BLAS_TARGET_AVX2 void gemvColumnsAVX2(int m, const double *A0, const double *A1, const double *A2, const double *A3,
+                                                     const double *a, double *y){
+                __m256d a0 = _mm256_set1_pd(a[0]);
+                __m256d a1 = _mm256_set1_pd(a[1]);
+                __m256d a2 = _mm256_set1_pd(a[2]);
+                __m256d a3 = _mm256_set1_pd(a[3]);
+                int i = 0;
+                for (; i+4 <= m; i += 4){
+                    __m256d yi = _mm256_loadu_pd(y+i);
+                    yi = _mm256_fmadd_pd(_mm256_loadu_pd(A0+i), a0, yi);
+                    yi = _mm256_fmadd_pd(_mm256_loadu_pd(A1+i), a1, yi);
+                    yi = _mm256_fmadd_pd(_mm256_loadu_pd(A2+i), a2, yi);
+                    yi = _mm256_fmadd_pd(_mm256_loadu_pd(A3+i), a3, yi);
+                    _mm256_storeu_pd(y+i, yi);
+                }
+                for (; i < m; i++){
+                    y[i] += A0[i]*a[0] + A1[i]*a[1] + A2[i]*a[2] + A3[i]*a[3];
+                }
+            }
+
+            OO_BLAS_TARGET_AVX2 void microKernelAVX2(int kc, const double *a, const double *b, double alpha, double *C, int ldc, int mr, int nr){
+                __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+                __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+                __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+                __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+                __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+                __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+                for (int p = 0; p < kc; p++){
+                    __m256d a0 = _mm256_loadu_pd(a);
+                    __m256d a1 = _mm256_loadu_pd(a+4);
+                    __m256d bj = _mm256_broadcast_sd(b);
+                    c00 = _mm256_fmadd_pd(a0, bj, c00); c01 = _mm256_fmadd_pd(a1, bj, c01);
+                    bj = _mm256_broadcast_sd(b+1);
+                    c10 = _mm256_fmadd_pd(a0, bj, c10); c11 = _mm256_fmadd_pd(a1, bj, c11);
+                    bj = _mm256_broadcast_sd(b+2);
+                    c20 = _mm256_fmadd_pd(a0, bj, c20); c21 = _mm256_fmadd_pd(a1, bj, c21);
+                    bj = _mm256_broadcast_sd(b+3);
+                    c30 = _mm256_fmadd_pd(a0, bj, c30); c31 = _mm256_fmadd_pd(a1, bj, c31);
+                    bj = _mm256_broadcast_sd(b+4);
+                    c40 = _mm256_fmadd_pd(a0, bj, c40); c41 = _mm256_fmadd_pd(a1, bj, c41);
+                    bj = _mm256_broadcast_sd(b+5);
+                    c50 = _mm256_fmadd_pd(a0, bj, c50); c51 = _mm256_fmadd_pd(a1, bj, c51);
+                    a += MR;
+                    b += NR;
+                }
+                __m256d acc[NR*2] = {c00, c01, c10, c11, c20, c21, c30, c31, c40, c41, c50, c51};
+                if (mr == MR && nr == NR){
+                    __m256d alphaV = _mm256_set1_pd(alpha);
+                    for (int j = 0; j < NR; j++){
+                        double *Cj = C + j*ldc;
+                        _mm256_storeu_pd(Cj, _mm256_fmadd_pd(alphaV, acc[2*j], _mm256_loadu_pd(Cj)));
+                        _mm256_storeu_pd(Cj+4, _mm256_fmadd_pd(alphaV, acc[2*j+1], _mm256_loadu_pd(Cj+4)));
+                    }
+                } else {
+                    double tile[MR*NR];
+                    for (int j = 0; j < NR; j++){
+                        _mm256_storeu_pd(tile + j*MR, acc[2*j]);
+                        _mm256_storeu_pd(tile + j*MR + 4, acc[2*j+1]);
+                    }
+                    for (int j = 0; j < nr; j++){
+                        for (int i = 0; i < mr; i++){
+                            C[j*ldc + i] += alpha*tile[j*MR + i];
+                        }
+                    }
+                }
+            }
+#endif
+
+            double ddotContiguous(int n, const double *x, const double *y){
+#ifdef OO_BLAS_AVX2_DISPATCH
+                if (usesAVX2()){
+                    return ddotAVX2(n, x, y);
+                }
+#endif
+                return ddotScalar(n, x, y);
+            }
+
+            void daxpyContiguous(int n, double alpha, const double *x, double *y){
+#ifdef OO_BLAS_AVX2_DISPATCH
+                if (usesAVX2()){
+                    daxpyAVX2(n, alpha, x, y);
+                    return;
+                }
+#endif
+                daxpyScalar(n, alpha, x, y);
+            }
+
+            void dscalContiguous(int n, double alpha, double *x){
+#ifdef OO_BLAS_AVX2_DISPATCH
+                if (usesAVX2()){
+                    dscalAVX2(n, alpha, x);
+                    return;
+                }
+#endif
+                dscalScalar(n, alpha, x);
+            }
+
+            void gemvColumns(int m, const double *A0, const double *A1, const double *A2, const double *A3,
+                             const double *a, double *y){
+#ifdef OO_BLAS_AVX2_DISPATCH
+                if (usesAVX2()){
+                    gemvColumnsAVX2(m, A0, A1, A2, A3, a, y);
+                    return;
+                }
+#endif
+                gemvColumnsScalar(m, A0, A1, A2, A3, a, y);
+            }
+
+            void microKernel(int kc, const double *a, const double *b, double alpha, double *C, int ldc, int mr, int nr){
+#ifdef OO_BLAS_AVX2_DISPATCH
+                if (usesAVX2()){
+                    microKernelAVX2(kc, a, b, alpha, C, ldc, mr, nr);
+                    return;
+                }
+#endif
+                microKernelScalar(kc, a, b, alpha, C, ldc, mr, nr);
+            }
+
+            // Packs the mc x kc block of op(A) starting at (i0, p0) into row panels of height MR (zero padded)
+            void packA(bool transA, const double *A, int lda, int i0, int p0, int mc, int kc, double *buffer){
+                for (int ir = 0; ir < mc; ir += MR){
+                    int mr = min(MR, mc-ir);
+                    for (int p = 0; p < kc; p++){
+                        const double *src = transA ? A + (i0+ir)*(long)lda + p0+p : A + (p0+p)*(long)lda + i0+ir;
+                        long stride = transA ? lda : 1;
+                        for (int i = 0; i < mr; i++){
+                            buffer[i] = src[i*stride];
+                        }
+                        for (int i = mr; i < MR; i++){
+                            buffer[i] = 0;
+                        }
+                        buffer += MR;
+                    }
+                }
+            }
+
+            // Packs the kc x nc block of op(B) starting at (p0, j0) into column panels of width NR (zero padded)
+            void packB(bool transB, const double *B, int ldb, int p0, int j0, int kc, int nc, double *buffer){
+                for (int jr = 0; jr < nc; jr += NR){
+                    int nr = min(NR, nc-jr);
+                    for (int p = 0; p < kc; p++){
+                        const double *src = transB ? B + (p0+p)*(long)ldb + j0+jr : B + (j0+jr)*(long)ldb + p0+p;
+                        long stride = transB ? 1 : ldb;
+                        for (int j = 0; j < nr; j++){
+                            buffer[j] = src[j*stride];
+                        }
+                        for (int j = nr; j < NR; j++){
+                            buffer[j] = 0;
+                        }
+                        buffer += NR;
+                    }
+                }
+            }
+        }
+
+        bool usesAVX2(){
+            static const bool avx2 = detectAVX2();
+            return avx2;
+        }
+
+        double ddot(int n, const double *x, int incX, const double *y, int incY){
+            if (n <= 0){
+                return 0;
+            }
+            if (incX == 1 && incY == 1){
+                if (n < PARALLEL_LENGTH){
+                    return ddotContiguous(n, x, y);
+                }
+                const int chunk = 4096;
+                double sum = 0;
+#pragma omp parallel for reduction(+:sum) schedule(static)
+                for (int i = 0; i < n; i += chunk){
+                    sum += ddotContiguous(min(chunk, n-i), x+i, y+i);
+                }
+                return sum;
+            }
+            double sum = 0;
+            int ix = startIndex(n, incX);
+            int iy = startIndex(n, incY);
+            for (int i = 0; i < n; i++, ix += incX, iy += incY){
+                sum += x[ix]*y[iy];
+            }
+            return sum;
+        }
+
+        double dnrm2(int n, const double *x, int incX){
+            if (n <= 0 || incX <= 0){
+                return 0;
+            }
+            double sumOfSquares = incX == 1 ? ddot(n, x, 1, x, 1) : 0;
+            if (incX != 1){
+                for (int i = 0; i < n; i++){
+                    sumOfSquares += x[i*incX]*x[i*incX];
+                }
+            }
+            if (std::isfinite(sumOfSquares) && (sumOfSquares == 0 || sumOfSquares > DBL_MIN/DBL_EPSILON)){
+                return sqrt(sumOfSquares);
+            }
+            // overflow or underflow: rescale by the largest element
+            double scale = 0;
+            for (int i = 0; i < n; i++){
+                scale = max(scale, fabs(x[i*incX]));
+            }
+            if (scale == 0 || !std::isfinite(scale)){
+                return scale;
+            }
+            double sum = 0;
+            for (int i = 0; i < n; i++){
+                double v = x[i*incX]/scale;
+                sum += v*v;
+            }
+            return scale*sqrt(sum);
+        }
+
+        void daxpy(int n, double alpha, const double *x, int incX, double *y, int incY){
+            if (n <= 0 || alpha == 0){
+                return;
+            }
+            if (incX == 1 && incY == 1){
+                if (n < PARALLEL_LENGTH){
+                    daxpyContiguous(n, alpha, x, y);
+                    return;
+                }
+                const int chunk = 4096;
+#pragma omp parallel for schedule(static)
+                for (int i = 0; i < n; i += chunk){
+                    daxpyContiguous(min(chunk, n-i), alpha, x+i, y+i);
+                }
+                return;
+            }
+            int ix = startIndex(n, incX);
+            int iy = startIndex(n, incY);
+            for (int i = 0; i < n; i++, ix += incX, iy += incY){
+                y[iy] += alpha*x[ix];
+            }
+        }
+
+        void dscal(int n, double alpha, double *x, int incX){
+            if (n <= 0 || incX <= 0){
+                return;
+            }
+            if (incX == 1){
+                if (n < PARALLEL_LENGTH){
+                    dscalContiguous(n, alpha, x);
+                    return;
+                }
+                const int chunk = 4096;
+#pragma omp parallel for schedule(static)
+                for (int i = 0; i < n; i += chunk){
+                    dscalContiguous(min(chunk, n-i), alpha, x+i);
+                }
+                return;
+            }
+            for (int i = 0; i < n; i++){
+                x[i*incX] *= alpha;
+            }
+        }
+
+        void dgemv(bool transA, int m, int n, double alpha, const double *A, int lda,
+                   const double *x, int incX, double beta, double *y, int incY){
+            if (m <= 0 || n <= 0){
+                return;
+            }
+            int lengthX = transA ? m : n;
+            int lengthY = transA ? n : m;
+            // work on contiguous copies of strided vectors
+            vector<double> xBuffer, yBuffer;
+            const double *xc = x;
+            double *yc = y;
+            if (incX != 1){
+                xBuffer.resize(lengthX);
+                for (int i = 0, ix = startIndex(lengthX, incX); i < lengthX; i++, ix += incX){
+                    xBuffer[i] = x[ix];
+                }
+                xc = xBuffer.data();
+            }
+            if (incY != 1){
+                yBuffer.resize(lengthY);
+                for (int i = 0, iy = startIndex(lengthY, incY); i < lengthY; i++, iy += incY){
+                    yBuffer[i] = y[iy];
+                }
+                yc = yBuffer.data();
+            }
+
+            if (beta == 0){
+                fill(yc, yc+lengthY, 0.0);
+            } else if (beta != 1){
+                dscal(lengthY, beta, yc, 1);
+            }
+
+            if (alpha != 0){
+                if (transA){
+                    // y(j) += alpha * A(:,j)' x
+#pragma omp parallel for schedule(static) if ((long)m*n > PARALLEL_LENGTH)
+                    for (int j = 0; j < n; j++){
+                        yc[j] += alpha*ddotContiguous(m, A + j*(long)lda, xc);
+                    }
+                } else {
+                    // y += alpha * A x, processing four columns at a time over blocks of rows
+                    const int rowBlock = 2048;
+#pragma omp parallel for schedule(static) if ((long)m*n > PARALLEL_LENGTH)
+                    for (int i0 = 0; i0 < m; i0 += rowBlock){
+                        int rows = min(rowBlock, m-i0);
+                        int j = 0;
+                        for (; j+4 <= n; j += 4){
+                            double a[4] = {alpha*xc[j], alpha*xc[j+1], alpha*xc[j+2], alpha*xc[j+3]};
+                            gemvColumns(rows, A + j*(long)lda + i0, A + (j+1)*(long)lda + i0,
+                                        A + (j+2)*(long)lda + i0, A + (j+3)*(long)lda + i0, a, yc + i0);
+                        }
+                        for (; j < n; j++){
+                            daxpyContiguous(rows, alpha*xc[j], A + j*(long)lda + i0, yc + i0);
+                        }
+                    }
+                }
+            }
+
+            if (incY != 1){
+                for (int i = 0, iy = startIndex(lengthY, incY); i < lengthY; i++, iy += incY){
+                    y[iy] = yc[i];
+                }
+            }
+        }
+
+        void dgemm(bool transA, bool transB, int m, int n, int k, double alpha, const double *A, int lda,
+                   const double *B, int ldb, double beta, double *C, int ldc){
+            if (m <= 0 || n <= 0){
+                return;
+            }
+            if (beta != 1){
+                for (int j = 0; j < n; j++){
+                    double *Cj = C + j*(long)ldc;
+                    if (beta == 0){
+                        fill(Cj, Cj+m, 0.0);
+                    } else {
+                        dscalContiguous(m, beta, Cj);
+                    }
+                }
+            }
+            if (alpha == 0 || k <= 0){
+                return;
+            }
+
+            if ((long)m*n*k < 16*16*16){
+                // too small to benefit from packing
+                for (int j = 0; j < n; j++){
+                    for (int p = 0; p < k; p++){
+                        double b = alpha*(transB ? B[p*(long)ldb + j] : B[j*(long)ldb + p]);
+                        if (b == 0){
+                            continue;
+                        }
+                        for (int i = 0; i < m; i++){
+                            C[j*(long)ldc + i] += b*(transA ? A[i*(long)lda + p] : A[p*(long)lda + i]);
+                        }
+                    }
+                }
+                return;
+            }
+
+            vector<double> packedA(MC*KC);
+            vector<double> packedB(KC*((min(NC, n)+NR-1)/NR)*NR);
+            for (int jc = 0; jc < n; jc += NC){
+                int nc = min(NC, n-jc);
+                for (int pc = 0; pc < k; pc += KC){
+                    int kc = min(KC, k-pc);
+                    packB(transB, B, ldb, pc, jc, kc, nc, packedB.data());
+                    for (int ic = 0; ic < m; ic += MC){
+                        int mc = min(MC, m-ic);
+                        packA(transA, A, lda, ic, pc, mc, kc, packedA.data());
+                        const double *a = packedA.data();
+                        const double *b = packedB.data();
+#pragma omp parallel for schedule(static) if ((long)mc*nc*kc > PARALLEL_LENGTH)
+                        for (int jr = 0; jr < nc; jr += NR){
+                            for (int ir = 0; ir < mc; ir += MR){
+                                microKernel(kc, a + ir*kc, b + jr*kc, alpha, C + (jc+jr)*(long)ldc + ic+ir, ldc,
+                                            min(MR, mc-ir), min(NR, nc-jr));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+#ifdef NO_BLAS
+
+using namespace oocholmod;
+
 double cblas_ddot(const int N, const double *X, const int incX,
                   const double *Y, const int incY){
-    assert(incX == 1);
-    assert(incY == 1);
-    double dotProduct = 0;
-    for (int i=0;i<N;i++){
-        dotProduct += X[i]*Y[i];
-    }
-    return dotProduct;
+    return kernels::ddot(N, X, incX, Y, incY);
 }
 
 double cblas_dnrm2(const int N, const double *X, const int incX){
-    assert(incX == 1);
-    double sqSum = 0;
-    for (int i=0;i<N;i++){
-        sqSum += X[i]*X[i];
-    }
-    return sqrt(sqSum);
+    return kernels::dnrm2(N, X, incX);
 }
 
 void cblas_daxpy(const int N, const double alpha, const double *X,
                  const int incX, double *Y, const int incY){
-    assert(alpha == 1);
-    assert(incX == 1);
-    assert(incY == 1);
-    for (int i=0;i<N;i++){
-        Y[i] += X[i];
-    }
+    kernels::daxpy(N, alpha, X, incX, Y, incY);
 }
 
 void cblas_dscal(const int N, const double alpha, double *X, const int incX){
-    assert(incX == 1);
-    for (int i=0;i<N;i++){
-        X[i] *= alpha;
-    }
+    kernels::dscal(N, alpha, X, incX);
 }
 
 void cblas_dgemv(const enum CBLAS_ORDER Order,
@@ -58,18 +566,12 @@ void cblas_dgemv(const enum CBLAS_ORDER Order,
                  const double alpha, const double *A, const int lda,
                  const double *X, const int incX, const double beta,
                  double *Y, const int incY){
-    assert(Order == CblasColMajor);
-    assert(TransA == CblasNoTrans);
-    assert(alpha == 1);
-    assert(beta == 0);
-    for (int row=0;row<M;row++){
-        double sum = 0;
-        for (int column=0;column<N;column++){
-            cout << A[row*M + column]<<" x "<<X[column]<<endl;
-            sum += A[row*M + column] * X[column];
-        }
-        cout << " set row " << row << " to " << sum << endl;
-        Y[row] = sum;
+    bool trans = TransA != CblasNoTrans;
+    if (Order == CblasColMajor){
+        kernels::dgemv(trans, M, N, alpha, A, lda, X, incX, beta, Y, incY);
+    } else {
+        // a row major M x N matrix is a column major N x M matrix
+        kernels::dgemv(!trans, N, M, alpha, A, lda, X, incX, beta, Y, incY);
     }
 }
 
@@ -78,18 +580,13 @@ void cblas_dgemm(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE TransA
                  const int K, const double alpha, const double *A,
                  const int lda, const double *B, const int ldb,
                  const double beta, double *C, const int ldc){
-    assert(Order == CblasColMajor);
-    assert(TransA == CblasNoTrans);
-    assert(alpha == 1);
-    assert(beta == 0);
-    for (int row=0;row<M;row++){
-        for (int column=0;column<N;column++){
-            double sum = 0;
-            for (int j=0;j<K;j++){
-                sum += A[row+M*j]*B[j+K*column];
-            }
-            C[row+column*M] = sum;
-        }
+    bool transA = TransA != CblasNoTrans;
+    bool transB = TransB != CblasNoTrans;
+    if (Order == CblasColMajor){
+        kernels::dgemm(transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    } else {
+        // row major C = op(A) op(B) is column major C^T = op(B)^T op(A)^T
+        kernels::dgemm(transB, transA, N, M, K, alpha, B, ldb, A, lda, beta, C, ldc);
     }
 }
 #endif
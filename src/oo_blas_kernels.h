@@ -0,0 +1,42 @@
+//
+//  oo_blas_kernels.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 Morten Nobel-Joergensen. All rights reserved.
+//
+
+#ifndef __OOCholmod__blas_kernels__
+#define __OOCholmod__blas_kernels__
+
+// Built-in BLAS kernels (column major). They are always compiled, and are used through the
+// cblas_* functions in oo_blas.h when the library is built with NO_BLAS.
+// AVX2/FMA code paths are selected at runtime when the CPU supports them. The kernels are
+// multithreaded when compiled with OpenMP.
+namespace oocholmod {
+    namespace kernels {
+
+        double ddot(int n, const double *x, int incX, const double *y, int incY);
+
+        double dnrm2(int n, const double *x, int incX);
+
+        // y = alpha*x + y
+        void daxpy(int n, double alpha, const double *x, int incX, double *y, int incY);
+
+        // x = alpha*x
+        void dscal(int n, double alpha, double *x, int incX);
+
+        // y = alpha*op(A)*x + beta*y where A is m x n
+        void dgemv(bool transA, int m, int n, double alpha, const double *A, int lda,
+                   const double *x, int incX, double beta, double *y, int incY);
+
+        // C = alpha*op(A)*op(B) + beta*C where op(A) is m x k and op(B) is k x n
+        void dgemm(bool transA, bool transB, int m, int n, int k, double alpha, const double *A, int lda,
+                   const double *B, int ldb, double beta, double *C, int ldc);
+
+        // true if the AVX2/FMA code paths are used
+        bool usesAVX2();
+    }
+}
+
+#endif /* defined(__OOCholmod__blas_kernels__) */
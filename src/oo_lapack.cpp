@@ -7,13 +7,236 @@
 //
 
 #include "oo_lapack.h"
+#ifdef NO_BLAS
+#include "oo_blas.h"
+#else
+#include <cblas.h>
+#endif
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 
 #ifdef NO_LAPACK
 
+namespace {
+    // panel width of the blocked LU factorization
+    const __CLPK_integer LU_BLOCK_SIZE = 64;
+
+    // Unblocked LU factorization with partial pivoting (row interchanges) of an m x n panel
+    void dgetf2(__CLPK_integer M, __CLPK_integer N, __CLPK_doublereal *a, __CLPK_integer LDA,
+                __CLPK_integer *ipiv, __CLPK_integer *info){
+        *info = 0;
+        for (__CLPK_integer j = 0; j < std::min(M, N); j++){
+            __CLPK_doublereal *colJ = a + j*LDA;
+            __CLPK_integer pivot = j;
+            for (__CLPK_integer i = j+1; i < M; i++){
+                if (fabs(colJ[i]) > fabs(colJ[pivot])){
+                    pivot = i;
+                }
+            }
+            ipiv[j] = pivot+1;
+            if (colJ[pivot] == 0){
+                if (*info == 0){
+                    *info = j+1;
+                }
+                continue;
+            }
+            if (pivot != j){
+                for (__CLPK_integer c = 0; c < N; c++){
+                    std::swap(a[c*LDA + j], a[c*LDA + pivot]);
+                }
+            }
+            __CLPK_doublereal inv = 1.0/colJ[j];
+            for (__CLPK_integer i = j+1; i < M; i++){
+                colJ[i] *= inv;
+            }
+            for (__CLPK_integer c = j+1; c < N; c++){
+                __CLPK_doublereal *colC = a + c*LDA;
+                __CLPK_doublereal ajc = colC[j];
+                if (ajc != 0){
+                    for (__CLPK_integer i = j+1; i < M; i++){
+                        colC[i] -= colJ[i]*ajc;
+                    }
+                }
+            }
+        }
+    }
+}
+
 int dgesv_(__CLPK_integer *n, __CLPK_integer *nrhs, __CLPK_doublereal *a, __CLPK_integer
            *lda, __CLPK_integer *ipiv, __CLPK_doublereal *b, __CLPK_integer *ldb, __CLPK_integer *info){
-    assert(false); // not implemented
+    dgetrf_(n, n, a, lda, ipiv, info);
+    if (*info == 0){
+        char trans = 'N';
+        dgetrs_(&trans, n, nrhs, a, lda, ipiv, b, ldb, info);
+    }
+    return 0;
+}
+
+// Right-looking blocked LU factorization with partial pivoting. Each panel is factorized unblocked,
+// and the trailing submatrix is updated with a single dgemm.
+int dgetrf_(__CLPK_integer *m, __CLPK_integer *n, __CLPK_doublereal *a, __CLPK_integer *lda,
+            __CLPK_integer *ipiv, __CLPK_integer *info){
+    const __CLPK_integer M = *m, N = *n, LDA = *lda;
+    const __CLPK_integer K = std::min(M, N);
+    *info = 0;
+    if (K <= LU_BLOCK_SIZE){
+        dgetf2(M, N, a, LDA, ipiv, info);
+        return 0;
+    }
+    for (__CLPK_integer j = 0; j < K; j += LU_BLOCK_SIZE){
+        const __CLPK_integer jb = std::min(LU_BLOCK_SIZE, K-j);
+        __CLPK_integer panelInfo;
+        dgetf2(M-j, jb, a + j*LDA + j, LDA, ipiv + j, &panelInfo);
+        if (panelInfo != 0 && *info == 0){
+            *info = panelInfo + j;
+        }
+        for (__CLPK_integer i = j; i < j+jb; i++){
+            ipiv[i] += j;
+        }
+        // apply the panel's row interchanges to the columns left and right of it
+        for (__CLPK_integer c = 0; c < N; c++){
+            if (c >= j && c < j+jb){
+                continue;
+            }
+            __CLPK_doublereal *colC = a + c*LDA;
+            for (__CLPK_integer i = j; i < j+jb; i++){
+                if (ipiv[i]-1 != i){
+                    std::swap(colC[i], colC[ipiv[i]-1]);
+                }
+            }
+        }
+        if (j+jb < N){
+            // A12 = L11^-1 A12
+            for (__CLPK_integer c = j+jb; c < N; c++){
+                __CLPK_doublereal *colC = a + c*LDA;
+                for (__CLPK_integer k = j; k < j+jb; k++){
+                    const __CLPK_doublereal *colK = a + k*LDA;
+                    __CLPK_doublereal x = colC[k];
+                    if (x != 0){
+                        for (__CLPK_integer i = k+1; i < j+jb; i++){
+                            colC[i] -= colK[i]*x;
+                        }
+                    }
+                }
+            }
+            // A22 = A22 - A21 A12
+            if (j+jb < M){
+                cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M-j-jb, N-j-jb, jb,
+                            -1.0, a + j*LDA + j+jb, LDA, a + (j+jb)*LDA + j, LDA,
+                            1.0, a + (j+jb)*LDA + j+jb, LDA);
+            }
+        }
+    }
+    return 0;
+}
+
+int dgetrs_(char *trans, __CLPK_integer *n, __CLPK_integer *nrhs, __CLPK_doublereal *a, __CLPK_integer
+            *lda, __CLPK_integer *ipiv, __CLPK_doublereal *b, __CLPK_integer *ldb, __CLPK_integer *info){
+    const __CLPK_integer N = *n, LDA = *lda;
+    const bool transposed = *trans == 'T' || *trans == 't' || *trans == 'C' || *trans == 'c';
+    *info = 0;
+    for (__CLPK_integer k = 0; k < *nrhs; k++){
+        __CLPK_doublereal *x = b + k*(*ldb);
+        if (!transposed){
+            // P A = L U: x = U^-1 L^-1 P b
+            for (__CLPK_integer i = 0; i < N; i++){
+                std::swap(x[i], x[ipiv[i]-1]);
+            }
+            for (__CLPK_integer j = 0; j < N; j++){
+                const __CLPK_doublereal *colJ = a + j*LDA;
+                for (__CLPK_integer i = j+1; i < N; i++){
+                    x[i] -= colJ[i]*x[j];
+                }
+            }
+            for (__CLPK_integer j = N-1; j >= 0; j--){
+                const __CLPK_doublereal *colJ = a + j*LDA;
+                x[j] /= colJ[j];
+                for (__CLPK_integer i = 0; i < j; i++){
+                    x[i] -= colJ[i]*x[j];
+                }
+            }
+        } else {
+            // A^T = U^T L^T P: x = P^T L^-T U^-T b
+            for (__CLPK_integer j = 0; j < N; j++){
+                const __CLPK_doublereal *colJ = a + j*LDA;
+                __CLPK_doublereal sum = x[j];
+                for (__CLPK_integer i = 0; i < j; i++){
+                    sum -= colJ[i]*x[i];
+                }
+                x[j] = sum/colJ[j];
+            }
+            for (__CLPK_integer j = N-1; j >= 0; j--){
+                const __CLPK_doublereal *colJ = a + j*LDA;
+                __CLPK_doublereal sum = x[j];
+                for (__CLPK_integer i = j+1; i < N; i++){
+                    sum -= colJ[i]*x[i];
+                }
+                x[j] = sum;
+            }
+            for (__CLPK_integer i = N-1; i >= 0; i--){
+                std::swap(x[i], x[ipiv[i]-1]);
+            }
+        }
+    }
+    return 0;
+}
+
+// Unblocked Cholesky factorization. Only the triangle given by uplo is referenced and overwritten.
+int dpotrf_(char *uplo, __CLPK_integer *n, __CLPK_doublereal *a, __CLPK_integer *lda, __CLPK_integer *info){
+    const __CLPK_integer N = *n, LDA = *lda;
+    const bool upper = *uplo == 'U' || *uplo == 'u';
+    *info = 0;
+    for (__CLPK_integer j = 0; j < N; j++){
+        // A = L L^T (lower) or A = U^T U (upper), where U = L^T is accessed as a(j,i) = a[i*LDA + j]
+        __CLPK_doublereal diagonal = a[j*LDA + j];
+        for (__CLPK_integer k = 0; k < j; k++){
+            __CLPK_doublereal ljk = upper ? a[j*LDA + k] : a[k*LDA + j];
+            diagonal -= ljk*ljk;
+        }
+        if (!(diagonal > 0)){
+            *info = j+1;
+            return 0;
+        }
+        diagonal = sqrt(diagonal);
+        a[j*LDA + j] = diagonal;
+        for (__CLPK_integer i = j+1; i < N; i++){
+            __CLPK_doublereal &lij = upper ? a[i*LDA + j] : a[j*LDA + i];
+            __CLPK_doublereal sum = lij;
+            for (__CLPK_integer k = 0; k < j; k++){
+                sum -= (upper ? a[i*LDA + k] : a[k*LDA + i]) * (upper ? a[j*LDA + k] : a[k*LDA + j]);
+            }
+            lij = sum/diagonal;
+        }
+    }
+    return 0;
+}
+
+int dpotrs_(char *uplo, __CLPK_integer *n, __CLPK_integer *nrhs, __CLPK_doublereal *a, __CLPK_integer *
+            lda, __CLPK_doublereal *b, __CLPK_integer *ldb, __CLPK_integer *info){
+    const __CLPK_integer N = *n, LDA = *lda;
+    const bool upper = *uplo == 'U' || *uplo == 'u';
+    *info = 0;
+    for (__CLPK_integer k = 0; k < *nrhs; k++){
+        __CLPK_doublereal *x = b + k*(*ldb);
+        // solve L y = b
+        for (__CLPK_integer j = 0; j < N; j++){
+            __CLPK_doublereal sum = x[j];
+            for (__CLPK_integer i = 0; i < j; i++){
+                sum -= (upper ? a[j*LDA + i] : a[i*LDA + j]) * x[i];
+            }
+            x[j] = sum/a[j*LDA + j];
+        }
+        // solve L^T x = y
+        for (__CLPK_integer j = N-1; j >= 0; j--){
+            __CLPK_doublereal sum = x[j];
+            for (__CLPK_integer i = j+1; i < N; i++){
+                sum -= (upper ? a[i*LDA + j] : a[j*LDA + i]) * x[i];
+            }
+            x[j] = sum/a[j*LDA + j];
+        }
+    }
+    return 0;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,207 @@
+//
+//  solver_stats.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include "solver_stats.h"
+#include "config_singleton.h"
+
+#include <map>
+#include <sstream>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+namespace oocholmod {
+
+    using namespace std;
+    using namespace std::chrono;
+
+    namespace {
+        struct Total {
+            int count;
+            double time;
+        };
+
+        // ScopedTimers may run on several threads at once (for example solves in a parallel loop), so the records,
+        // the totals and the memory statistics of the commons are only accessed while holding recordMutex
+        mutex recordMutex;
+        atomic<bool> enabled{true};
+        size_t maxRecords = 10000;
+        deque<PhaseStats> records;
+        map<string, Total> totals;
+        steady_clock::time_point epoch = steady_clock::now();
+
+        const char *orderingName(int ordering){
+            switch (ordering){
+                case CHOLMOD_NATURAL: return "natural";
+                case CHOLMOD_GIVEN: return "given";
+                case CHOLMOD_AMD: return "amd";
+                case CHOLMOD_METIS: return "metis";
+                case CHOLMOD_NESDIS: return "nesdis";
+                case CHOLMOD_COLAMD: return "colamd";
+                default: return "none";
+            }
+        }
+
+        void writeArgs(ostream& out, const PhaseStats& s){
+            out << "\"n\": " << s.n << ", \"lnz\": " << s.lnz << ", \"flops\": " << s.flops
+                << ", \"memory_usage\": " << s.memoryUsage << ", \"memory_inuse\": " << s.memoryInUse
+                << ", \"ordering\": \"" << orderingName(s.ordering) << "\""
+                << ", \"supernodal\": " << (s.supernodal ? "true" : "false")
+                << ", \"success\": " << (s.success ? "true" : "false");
+        }
+
+        void addRecord(const PhaseStats& stats){
+            Total& total = totals[stats.name];
+            total.count++;
+            total.time += stats.duration;
+            if (maxRecords == 0){
+                return;
+            }
+            if (records.size() == maxRecords){
+                records.pop_front();
+            }
+            records.push_back(stats);
+        }
+    }
+
+    void SolverStats::setEnabled(bool enable){
+        enabled = enable;
+    }
+
+    bool SolverStats::isEnabled(){
+        return enabled;
+    }
+
+    void SolverStats::setMaxRecords(size_t max){
+        lock_guard<mutex> lock(recordMutex);
+        maxRecords = max;
+        while (records.size() > maxRecords){
+            records.pop_front();
+        }
+    }
+
+    void SolverStats::reset(){
+        lock_guard<mutex> lock(recordMutex);
+        records.clear();
+        totals.clear();
+        epoch = steady_clock::now();
+    }
+
+    const deque<PhaseStats>& SolverStats::getRecords(){
+        return records;
+    }
+
+    const PhaseStats* SolverStats::last(const string& name){
+        lock_guard<mutex> lock(recordMutex);
+        for (auto it = records.rbegin(); it != records.rend(); it++){
+            if (it->name == name){
+                return &(*it);
+            }
+        }
+        return nullptr;
+    }
+
+    int SolverStats::count(const string& name){
+        lock_guard<mutex> lock(recordMutex);
+        auto it = totals.find(name);
+        return it == totals.end() ? 0 : it->second.count;
+    }
+
+    double SolverStats::totalTime(const string& name){
+        lock_guard<mutex> lock(recordMutex);
+        auto it = totals.find(name);
+        return it == totals.end() ? 0 : it->second.time;
+    }
+
+    void SolverStats::add(const PhaseStats& stats){
+        lock_guard<mutex> lock(recordMutex);
+        addRecord(stats);
+    }
+
+    string SolverStats::toJSON(){
+        lock_guard<mutex> lock(recordMutex);
+        stringstream out;
+        out.precision(12);
+        out << "{\"records\": [";
+        for (size_t i = 0; i < records.size(); i++){
+            const PhaseStats& s = records[i];
+            out << (i ? ",\n" : "\n") << "  {\"name\": \"" << s.name << "\", \"start\": " << s.start
+                << ", \"duration\": " << s.duration << ", ";
+            writeArgs(out, s);
+            out << "}";
+        }
+        out << "\n], \"totals\": {";
+        bool first = true;
+        for (auto& total : totals){
+            out << (first ? "\n" : ",\n") << "  \"" << total.first << "\": {\"count\": " << total.second.count
+                << ", \"time\": " << total.second.time << "}";
+            first = false;
+        }
+        out << "\n}}\n";
+        return out.str();
+    }
+
+    string SolverStats::toChromeTrace(){
+        lock_guard<mutex> lock(recordMutex);
+        stringstream out;
+        out.precision(12);
+        out << "{\"traceEvents\": [";
+        for (size_t i = 0; i < records.size(); i++){
+            const PhaseStats& s = records[i];
+            // complete events with timestamps in microseconds
+            out << (i ? ",\n" : "\n") << "  {\"name\": \"" << s.name << "\", \"cat\": \"oocholmod\", \"ph\": \"X\""
+                << ", \"ts\": " << s.start*1e6 << ", \"dur\": " << s.duration*1e6
+                << ", \"pid\": 1, \"tid\": 1, \"args\": {";
+            writeArgs(out, s);
+            out << "}}";
+        }
+        out << "\n]}\n";
+        return out.str();
+    }
+
+    ScopedTimer::ScopedTimer(const char *name, int itype)
+    :enabled{SolverStats::isEnabled()}, itype{itype}, outerPeak{0}, stats{name, 0, 0, 0, 0, 0, 0, 0, -1, false, true}
+    {
+        if (enabled){
+            // CHOLMOD never lowers memory_usage, so restart the peak from the memory in use (timers on other
+            // threads also update the common)
+            lock_guard<mutex> lock(recordMutex);
+            cholmod_common *Common = ConfigSingleton::getCommonPtr(itype);
+            outerPeak = Common->memory_usage;
+            Common->memory_usage = Common->memory_inuse;
+            startTime = steady_clock::now();
+        }
+    }
+
+    ScopedTimer::~ScopedTimer(){
+        if (!enabled){
+            return;
+        }
+        steady_clock::time_point endTime = steady_clock::now();
+        stats.duration = duration<double>(endTime - startTime).count();
+        lock_guard<mutex> lock(recordMutex);
+        cholmod_common *Common = ConfigSingleton::getCommonPtr(itype);
+        stats.memoryUsage = Common->memory_usage;
+        stats.memoryInUse = Common->memory_inuse;
+        // an enclosing timer sees the larger of its own peak so far and the peak of this call
+        Common->memory_usage = max(outerPeak, Common->memory_usage);
+        stats.start = duration<double>(startTime - epoch).count();
+        addRecord(stats);
+    }
+
+    void ScopedTimer::setFactor(const cholmod_factor *factor, double lnz, double flops){
+        if (!enabled || factor == nullptr){
+            return;
+        }
+        stats.n = factor->n;
+        stats.lnz = lnz;
+        stats.flops = flops;
+        stats.ordering = factor->ordering;
+        stats.supernodal = factor->is_super != 0;
+    }
+}
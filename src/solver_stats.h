@@ -0,0 +1,88 @@
+//
+//  solver_stats.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <string>
+#include <deque>
+#include <chrono>
+#include <cholmod.h>
+
+namespace oocholmod {
+
+    /// Statistics of a single analyze, factorize or solve call (or of a user defined ScopedTimer)
+    struct PhaseStats {
+        std::string name;       // "analyze", "factorize", "solve" or the name given to ScopedTimer
+        double start;           // seconds since the statistics were reset
+        double duration;        // wall time in seconds
+        size_t n;               // dimension of the factor (0 if no factor is involved)
+        double lnz;             // number of nonzeros in L
+        double flops;           // floating point operations (estimated by the analysis)
+        size_t memoryUsage;     // peak memory used by CHOLMOD during the call in bytes
+        size_t memoryInUse;     // memory used by CHOLMOD after the call in bytes
+        int ordering;           // fill reducing ordering used (CHOLMOD_NATURAL, CHOLMOD_AMD, CHOLMOD_METIS, ...)
+        bool supernodal;        // true if the factor is supernodal, false if simplicial
+        bool success;
+    };
+
+    /// Collects PhaseStats of every analyze, factorize and solve call. Recording only reads the clock and a few
+    /// fields of cholmod_common, so it is enabled by default. The number of kept records is bounded (the oldest
+    /// records are dropped), but the per-phase totals include every call since the last reset.
+    class SolverStats {
+    public:
+        static void setEnabled(bool enabled);
+        static bool isEnabled();
+
+        /// Maximum number of records kept (default 10000)
+        static void setMaxRecords(size_t maxRecords);
+
+        /// Removes all records and totals, and restarts the clock
+        static void reset();
+
+        /// The records and the record returned by last() are not protected against timers finishing on other
+        /// threads, so only read them when no other thread is running library calls. The other functions are
+        /// thread safe.
+        static const std::deque<PhaseStats>& getRecords();
+
+        /// Returns the most recent record with the given name or nullptr
+        static const PhaseStats* last(const std::string& name);
+
+        /// Number of calls and total wall time (in seconds) of a phase since the last reset
+        static int count(const std::string& name);
+        static double totalTime(const std::string& name);
+
+        /// Records and totals as a JSON object
+        static std::string toJSON();
+
+        /// Records as Chrome trace events (load the file in chrome://tracing or Perfetto)
+        static std::string toChromeTrace();
+
+        static void add(const PhaseStats& stats);
+    };
+
+    /// Measures the wall time from construction to destruction and adds it to SolverStats. Used for the library
+    /// phases, but can also be used to time application phases (such as assembly) in the same trace.
+    class ScopedTimer {
+    public:
+        /// itype selects the common whose peak memory is measured (the index type of the matrices involved)
+        ScopedTimer(const char *name, int itype = CHOLMOD_INT);
+        ~ScopedTimer();
+
+        /// Reads the size, ordering and type of the factor (which must have the index type given to the constructor)
+        void setFactor(const cholmod_factor *factor, double lnz, double flops);
+        void setSuccess(bool success) { stats.success = success; }
+    private:
+        ScopedTimer(const ScopedTimer& that) = delete;
+        ScopedTimer& operator=(const ScopedTimer& other) = delete;
+        bool enabled;
+        int itype; // selects the common the memory statistics are read from
+        size_t outerPeak; // memory_usage of the common when the timer started
+        std::chrono::steady_clock::time_point startTime;
+        PhaseStats stats;
+    };
+}
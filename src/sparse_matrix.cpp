@@ -11,13 +11,242 @@
 #include "sparse_matrix.h"
 #include "dense_matrix.h"
 #include "factor.h"
+#include "lu_factor.h"
+#include "solver_stats.h"
+#include "mapped_file.h"
 
 using namespace std;
 
 namespace oocholmod {
     
-    SparseMatrix::SparseMatrix(unsigned int nrow, unsigned int ncol, bool symmetric, int maxSize)
-    :sparse{nullptr}, triplet{nullptr}, nrow{nrow}, ncol{ncol}
+    namespace {
+        template<typename Int>
+        void sumColumns(const cholmod_sparse *sparse, DenseMatrix& x){
+            const Int *Ap = (const Int*)sparse->p;
+            const Int *Ai = (const Int*)sparse->i;
+            const double *Ax = (const double*)sparse->x;
+            for (size_t j = 0; j < sparse->ncol; j++){
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    Int row = Ai[k];
+                    x(row) += Ax[k];
+                    if (sparse->stype == SYMMETRIC_UPPER && row != (Int)j){
+                        x(j) += Ax[k];
+                    }
+#ifdef DEBUG
+                    printf("A[%ld,%ld]=%f \n", (long)row, (long)j, Ax[k]);
+#endif
+                }
+            }
+        }
+        
+        // A = diag(r)*A*diag(c) in one pass over the values (in parallel over the columns). Column j with c[j] == 0
+        // gets the value diagonal in its diagonal slot (if it has one) as well.
+        template<typename Int>
+        void scaleRowsColumns(cholmod_sparse *sparse, const double *r, const double *c, const std::vector<long> *diagonalSlots,
+                              double diagonal){
+            const Int *Ap = (const Int*)sparse->p;
+            const Int *Ai = (const Int*)sparse->i;
+            double *Ax = (double*)sparse->x;
+            long ncol = sparse->ncol;
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long j = 0; j < ncol; j++){
+                double cj = c[j];
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    Ax[k] *= r[Ai[k]]*cj;
+                }
+                if (diagonalSlots && cj == 0 && j < (long)diagonalSlots->size() && (*diagonalSlots)[j] != -1){
+                    Ax[(*diagonalSlots)[j]] = diagonal;
+                }
+            }
+        }
+        
+        // Zeros the rows and columns of the constrained indices (constrained[i] != 0) and moves their contribution
+        // A(i,k)*g(k) to the right hand side. A stored entry of a symmetric matrix represents both A(i,j) and A(j,i).
+        template<typename Int>
+        void eliminate(cholmod_sparse *sparse, const std::vector<char>& constrained, const std::vector<double>& g,
+                       double *rhs, double diagonal){
+            const Int *Ap = (const Int*)sparse->p;
+            const Int *Ai = (const Int*)sparse->i;
+            double *Ax = (double*)sparse->x;
+            long ncol = sparse->ncol;
+            bool symmetric = sparse->stype != 0;
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long j = 0; j < ncol; j++){
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    Int i = Ai[k];
+                    if (i == j){
+                        if (constrained[j]){
+                            Ax[k] = diagonal;
+                        }
+                        continue;
+                    }
+                    if (constrained[j]){
+                        if (!constrained[i]){
+#pragma omp atomic
+                            rhs[i] -= Ax[k]*g[j];
+                        }
+                        Ax[k] = 0;
+                    } else if (constrained[i]){
+                        if (symmetric){
+#pragma omp atomic
+                            rhs[j] -= Ax[k]*g[i];
+                        }
+                        Ax[k] = 0;
+                    }
+                }
+            }
+        }
+        
+        // the index of the diagonal entry of each column (-1 if it is not stored)
+        template<typename Int>
+        void findDiagonal(const cholmod_sparse *sparse, std::vector<long>& slots){
+            const Int *Ap = (const Int*)sparse->p;
+            const Int *Ai = (const Int*)sparse->i;
+            long n = min(sparse->nrow, sparse->ncol);
+            slots.resize(n);
+#pragma omp parallel for schedule(static)
+            for (long j = 0; j < n; j++){
+                const Int *slot = lower_bound(Ai + Ap[j], Ai + Ap[j+1], (Int)j);
+                slots[j] = slot != Ai + Ap[j+1] && *slot == j ? slot - Ai : -1;
+            }
+        }
+        
+        // Writes A' to T (which has room for the entries of A) by a counting sort on the rows, which keeps the rows of
+        // T sorted. slots[k] is the entry of A holding the value of entry k of T.
+        template<typename Int>
+        void transposeTo(const cholmod_sparse *A, cholmod_sparse *T, std::vector<long>& slots){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            Int *Tp = (Int*)T->p;
+            Int *Ti = (Int*)T->i;
+            double *Tx = (double*)T->x;
+            size_t nrow = A->nrow, ncol = A->ncol;
+            fill(Tp, Tp + nrow + 1, 0);
+            for (Int k = 0; k < Ap[ncol]; k++){
+                Tp[Ai[k]+1]++;
+            }
+            for (size_t i = 0; i < nrow; i++){
+                Tp[i+1] += Tp[i];
+            }
+            std::vector<Int> next(Tp, Tp + nrow);
+            slots.resize(Ap[ncol]);
+            for (size_t j = 0; j < ncol; j++){
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    Int index = next[Ai[k]]++;
+                    Ti[index] = (Int)j;
+                    Tx[index] = Ax[k];
+                    slots[index] = k;
+                }
+            }
+            T->nrow = ncol;
+            T->ncol = nrow;
+            T->stype = 0;
+            T->packed = true;
+            T->sorted = true;
+        }
+        
+        // Gathers the values of A' into T, where slots[k] is the entry of A that entry k of T was copied from by the
+        // last transpose into T. Returns false (with the values of T partly written) if T does not have the pattern
+        // of A'. Each entry is checked: slots is a permutation, so if every entry of T comes from the transposed
+        // position in A and both have the same number of entries, the patterns are equal.
+        template<typename Int>
+        bool gatherTranspose(const cholmod_sparse *A, const std::vector<long>& slots, cholmod_sparse *T){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            const Int *Tp = (const Int*)T->p;
+            const Int *Ti = (const Int*)T->i;
+            double *Tx = (double*)T->x;
+            long ncol = T->ncol;
+            if (Tp[ncol] != Ap[A->ncol] || slots.size() != (size_t)Tp[ncol]){
+                return false;
+            }
+            const long *slot = slots.data();
+            bool same = true;
+#pragma omp parallel for schedule(static) reduction(&&:same)
+            for (long j = 0; j < ncol; j++){
+                for (Int k = Tp[j]; k < Tp[j+1]; k++){
+                    long s = slot[k];
+                    Int column = Ti[k];
+                    if (Ai[s] != (Int)j || s < Ap[column] || s >= Ap[column+1]){
+                        same = false;
+                        break;
+                    }
+                    Tx[k] = Ax[s];
+                }
+            }
+            return same;
+        }
+        
+        // the largest absolute value of each row and column (using both triangular parts of symmetric matrices)
+        template<typename Int>
+        void absoluteMaxima(const cholmod_sparse *sparse, std::vector<double>& rowMax, std::vector<double>& columnMax){
+            const Int *Ap = (const Int*)sparse->p;
+            const Int *Ai = (const Int*)sparse->i;
+            const double *Ax = (const double*)sparse->x;
+            rowMax.assign(sparse->nrow, 0);
+            columnMax.assign(sparse->ncol, 0);
+            for (size_t j = 0; j < sparse->ncol; j++){
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    Int row = Ai[k];
+                    double value = fabs(Ax[k]);
+                    rowMax[row] = max(rowMax[row], value);
+                    columnMax[j] = max(columnMax[j], value);
+                    if (sparse->stype != 0 && row != (Int)j){
+                        rowMax[j] = max(rowMax[j], value);
+                        columnMax[row] = max(columnMax[row], value);
+                    }
+                }
+            }
+        }
+        
+        // y = alpha*A'*x + beta*y. Entry j of y is the dot product of column j of A and x, so the columns are independent
+        template<typename Int>
+        void transposedProduct(const cholmod_sparse *A, const cholmod_dense *X, cholmod_dense *Y, double alpha, double beta){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            long ncol = A->ncol;
+            for (size_t c = 0; c < X->ncol; c++){
+                const double *x = (const double*)X->x + c*X->d;
+                double *y = (double*)Y->x + c*Y->d;
+#pragma omp parallel for schedule(dynamic, 256)
+                for (long j = 0; j < ncol; j++){
+                    double sum = 0;
+                    for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                        sum += Ax[k]*x[Ai[k]];
+                    }
+                    y[j] = beta == 0 ? alpha*sum : alpha*sum + beta*y[j];
+                }
+            }
+        }
+        
+        // cholmod_l_sparse_to_dense would allocate the result with the long common, while DenseMatrix frees with the int common
+        template<typename Int>
+        void scatter(const cholmod_sparse *sparse, DenseMatrix& dense){
+            const Int *Ap = (const Int*)sparse->p;
+            const Int *Ai = (const Int*)sparse->i;
+            const double *Ax = (const double*)sparse->x;
+            for (size_t j = 0; j < sparse->ncol; j++){
+                for (Int k = Ap[j]; k < Ap[j+1]; k++){
+                    Int row = Ai[k];
+                    // entries in the ignored triangle of a symmetric matrix are skipped (as in cholmod_sparse_to_dense)
+                    if ((sparse->stype > 0 && row > (Int)j) || (sparse->stype < 0 && row < (Int)j)){
+                        continue;
+                    }
+                    dense(row, j) = Ax[k];
+                    if (sparse->stype != 0){
+                        dense(j, row) = Ax[k];
+                    }
+                }
+            }
+        }
+    }
+    
+    SparseMatrix::SparseMatrix(unsigned int nrow, unsigned int ncol, bool symmetric, size_t maxSize, IndexType indexType)
+    :sparse{nullptr}, triplet{nullptr}, nrow{nrow}, ncol{ncol}, values{nullptr}, iRow{nullptr}, jColumn{nullptr},
+    iRowLong{nullptr}, jColumnLong{nullptr}, indexType{indexType}, mappedFile{nullptr}
     {
         if (symmetric && nrow == ncol) {
             symmetry = SYMMETRIC_UPPER;
@@ -27,10 +256,10 @@ namespace oocholmod {
         }
         
         if (maxSize == 0 && symmetric) {
-            maxTripletElements = min<int>(100000,(nrow*(ncol+1))/2); // triangular number
+            maxTripletElements = min<size_t>(100000,((size_t)nrow*(ncol+1))/2); // triangular number
         }
         else if (maxSize == 0 && !symmetric) {
-            maxTripletElements = min<int>(100000,nrow*ncol); // triangular number
+            maxTripletElements = min<size_t>(100000,(size_t)nrow*ncol);
         }
         else {
             maxTripletElements = maxSize;
@@ -38,23 +267,26 @@ namespace oocholmod {
     }
     
     SparseMatrix::SparseMatrix(cholmod_sparse *sparse)
-    :sparse{sparse}, triplet{nullptr}, nrow{static_cast<unsigned int>(sparse->nrow)},
-    ncol{static_cast<unsigned int>(sparse->ncol)},
-    values{(double*)sparse->x}, iRow{(int*)sparse->i}, jColumn{(int*)sparse->p}, symmetry{static_cast<Symmetry>(sparse->stype)}, maxTripletElements{0}
+    :sparse{nullptr}, triplet{nullptr}, nrow{static_cast<unsigned int>(sparse->nrow)},
+    ncol{static_cast<unsigned int>(sparse->ncol)}, symmetry{static_cast<Symmetry>(sparse->stype)}, maxTripletElements{0}, mappedFile{nullptr}
     {
-#ifdef DEBUG
-        assert(sparse->itype == CHOLMOD_INT);
-#endif
+        setSparse(sparse);
     }
     
     SparseMatrix::SparseMatrix(SparseMatrix&& other)
-    :sparse{other.sparse}, triplet{other.triplet}, nrow{other.nrow}, ncol{other.ncol}, values{other.values}, iRow{other.iRow}, jColumn{other.jColumn}, symmetry{other.symmetry}, maxTripletElements{other.maxTripletElements}
+    :sparse{other.sparse}, triplet{other.triplet}, nrow{other.nrow}, ncol{other.ncol}, values{other.values}, iRow{other.iRow}, jColumn{other.jColumn},
+    iRowLong{other.iRowLong}, jColumnLong{other.jColumnLong}, symmetry{other.symmetry}, indexType{other.indexType},
+    maxTripletElements{other.maxTripletElements}, mappedFile{other.mappedFile}, diagonalSlots{std::move(other.diagonalSlots)},
+    transposeSlots{std::move(other.transposeSlots)}
     {
         other.sparse = nullptr;
+        other.mappedFile = nullptr;
         other.triplet = nullptr;
         other.values = nullptr;
         other.iRow = nullptr;
         other.jColumn = nullptr;
+        other.iRowLong = nullptr;
+        other.jColumnLong = nullptr;
         other.nrow = 0;
         other.ncol = 0;
     }
@@ -62,10 +294,10 @@ namespace oocholmod {
     SparseMatrix& SparseMatrix::operator=(SparseMatrix&& other){
         if (this != &other){
             if (sparse != nullptr){
-                cholmod_free_sparse(&sparse, ConfigSingleton::getCommonPtr());
+                releaseSparse();
             }
             if (triplet != nullptr){
-                cholmod_free_triplet(&triplet, ConfigSingleton::getCommonPtr());
+                OOCHOLMOD_CALL(itype(), free_triplet, &triplet);
             }
             
             sparse = other.sparse;
@@ -75,14 +307,23 @@ namespace oocholmod {
             values = other.values;
             iRow = other.iRow;
             jColumn = other.jColumn;
+            iRowLong = other.iRowLong;
+            jColumnLong = other.jColumnLong;
             symmetry = other.symmetry;
+            indexType = other.indexType;
             maxTripletElements = other.maxTripletElements;
+            mappedFile = other.mappedFile;
+            diagonalSlots = std::move(other.diagonalSlots);
+            transposeSlots = std::move(other.transposeSlots);
 
             other.sparse = nullptr;
+            other.mappedFile = nullptr;
             other.triplet = nullptr;
             other.values = nullptr;
             other.iRow = nullptr;
             other.jColumn = nullptr;
+            other.iRowLong = nullptr;
+            other.jColumnLong = nullptr;
             other.nrow = 0;
             other.ncol = 0;
         }
@@ -94,11 +335,10 @@ namespace oocholmod {
         if (sparse != nullptr || triplet != nullptr){
 
             if (sparse != nullptr){
-                cholmod_free_sparse(&sparse, ConfigSingleton::getCommonPtr());
-                sparse = nullptr;
+                releaseSparse();
             }
             if (triplet != nullptr){
-                cholmod_free_triplet(&triplet, ConfigSingleton::getCommonPtr());
+                OOCHOLMOD_CALL(itype(), free_triplet, &triplet);
                 triplet = nullptr;
             }
         }
@@ -109,7 +349,7 @@ namespace oocholmod {
             case INIT:
                 return triplet->nnz;
             case BUILT:
-                return jColumn[getColumns()];
+                return indexType == INDEX_LONG ? jColumnLong[getColumns()] : jColumn[getColumns()];
             default:
                 return 0;
         }
@@ -120,6 +360,11 @@ namespace oocholmod {
 #ifdef DEBUG
         assert(sparse);
 #endif
+        if (indexType == INDEX_LONG){
+            DenseMatrix dense(nrow, ncol, 0.);
+            scatter<SuiteSparse_long>(sparse, dense);
+            return dense;
+        }
         cholmod_dense *dense = cholmod_sparse_to_dense(sparse, ConfigSingleton::getCommonPtr());
         return DenseMatrix(dense);
     }
@@ -128,6 +373,7 @@ namespace oocholmod {
 #ifdef DEBUG
         assert(sparse == nullptr);
         assert(m.triplet);
+        assert(indexType == m.indexType);
 #endif
         if (!triplet){
             createTriplet();
@@ -137,8 +383,8 @@ namespace oocholmod {
             increaseTripletCapacity();
         }
         memcpy(values+triplet->nnz, m.values, sizeof(double)*m.triplet->nnz);
-        memcpy(jColumn+triplet->nnz, m.jColumn, sizeof(int)*m.triplet->nnz);
-        memcpy(iRow+triplet->nnz, m.iRow, sizeof(int)*m.triplet->nnz);
+        memcpy((char*)triplet->j+triplet->nnz*indexSize(), m.triplet->j, indexSize()*m.triplet->nnz);
+        memcpy((char*)triplet->i+triplet->nnz*indexSize(), m.triplet->i, indexSize()*m.triplet->nnz);
         triplet->nnz += m.triplet->nnz;
     }
     
@@ -153,10 +399,14 @@ namespace oocholmod {
 #ifdef DEBUG
         assert(getMatrixState() == BUILT);
 #endif
-        cholmod_drop(tol, sparse, ConfigSingleton::getCommonPtr());
-        values = ((double*)sparse->x);
-        iRow = ((int*)sparse->i);
-        jColumn = ((int*)sparse->p);
+        if (mappedFile){
+            // cholmod_drop reallocates the arrays, which belong to the mapping
+            cholmod_sparse *copy = OOCHOLMOD_CALL(itype(), copy_sparse, sparse);
+            releaseSparse();
+            setSparse(copy);
+        }
+        OOCHOLMOD_CALL(itype(), drop, tol, sparse);
+        setSparse(sparse);
     }
     
     MatrixState SparseMatrix::getMatrixState() const {
@@ -185,60 +435,126 @@ namespace oocholmod {
         assert(triplet != nullptr);
         assert(sparse == nullptr);
 #endif
-        sparse = cholmod_triplet_to_sparse(triplet, triplet->nnz, ConfigSingleton::getCommonPtr());
-        cholmod_free_triplet(&triplet, ConfigSingleton::getCommonPtr());
+        setSparse(OOCHOLMOD_CALL(itype(), triplet_to_sparse, triplet, triplet->nnz));
+        OOCHOLMOD_CALL(itype(), free_triplet, &triplet);
         triplet = nullptr;
-        values = ((double*)sparse->x);
-        iRow = ((int*)sparse->i);
-        jColumn = ((int*)sparse->p);
-
         
 #ifdef DEBUG
-        assert(sparse->itype == CHOLMOD_INT);
+        assert(sparse->itype == itype());
         assert(sparse->stype == symmetry);
         assert(sparse->packed);
 #endif
     }
    
     void SparseMatrix::sumRows(DenseMatrix& x){
-        int idx = 0;
-        for (int j=0;j<ncol;j++){
-                int iFrom = ((int*)sparse->p)[j];
-                int iTo = ((int*)sparse->p)[j+1]-1;
-                for (int i=iFrom;i<=iTo;i++){
-                        int row = ((int*)sparse->i)[i];
-                        x(row)+=((double*)sparse->x)[idx];
-                        if (symmetry == SYMMETRIC_UPPER){
-                                if (row!=j){
-                                        x(j)+=((double*)sparse->x)[idx];
-                                }
-                        }
-#ifdef DEBUG
-                        printf("A[%d,%d]=%f \n",row,j,((double*)sparse->x)[idx]);
-#endif
-                        idx++;
-                }
+        if (indexType == INDEX_LONG){
+            sumColumns<SuiteSparse_long>(sparse, x);
+        } else {
+            sumColumns<int>(sparse, x);
         }
-
     }
 
 
-    void SparseMatrix::setNullSpace(DenseMatrix& v){
-        int idx = 0;
-        for (int j=0;j<ncol;j++){
-                int iFrom = ((int*)sparse->p)[j];
-                int iTo = ((int*)sparse->p)[j+1]-1;
-                for (int i=iFrom;i<=iTo;i++){
-                        int row = ((int*)sparse->i)[i];
-                        ((double*)sparse->x)[idx] *= v(row)*v(j);
-                        idx++;
-                }
+    void SparseMatrix::setNullSpace(const DenseMatrix& v, double diagonal){
+#ifdef DEBUG
+        assertHasSparse();
+        assert(nrow == ncol && v.getRows() == nrow && v.getColumns() == 1);
+#endif
+        const double *d = v.getData();
+        if (indexType == INDEX_LONG){
+            scaleRowsColumns<SuiteSparse_long>(sparse, d, d, &getDiagonalSlots(), diagonal);
+        } else {
+            scaleRowsColumns<int>(sparse, d, d, &getDiagonalSlots(), diagonal);
+        }
+    }
+    
+    void SparseMatrix::scale(const DenseMatrix& rowScale, const DenseMatrix& columnScale){
+#ifdef DEBUG
+        assertHasSparse();
+        assert(rowScale.getRows() == nrow && rowScale.getColumns() == 1);
+        assert(columnScale.getRows() == ncol && columnScale.getColumns() == 1);
+        assert(symmetry == ASYMMETRIC || rowScale == columnScale);
+#endif
+        if (indexType == INDEX_LONG){
+            scaleRowsColumns<SuiteSparse_long>(sparse, rowScale.getData(), columnScale.getData(), nullptr, 0);
+        } else {
+            scaleRowsColumns<int>(sparse, rowScale.getData(), columnScale.getData(), nullptr, 0);
+        }
+    }
+    
+    void SparseMatrix::scale(const DenseMatrix& d){
+        scale(d, d);
+    }
+    
+    void SparseMatrix::equilibrate(DenseMatrix& rowScale, DenseMatrix& columnScale, int iterations){
+#ifdef DEBUG
+        assertHasSparse();
+#endif
+        rowScale = DenseMatrix(nrow, 1, 1.);
+        columnScale = DenseMatrix(ncol, 1, 1.);
+        DenseMatrix r(nrow), c(ncol);
+        std::vector<double> rowMax, columnMax;
+        for (int iteration = 0; iteration < iterations; iteration++){
+            if (indexType == INDEX_LONG){
+                absoluteMaxima<SuiteSparse_long>(sparse, rowMax, columnMax);
+            } else {
+                absoluteMaxima<int>(sparse, rowMax, columnMax);
+            }
+            double deviation = 0;
+            for (unsigned int i = 0; i < nrow; i++){
+                r(i) = rowMax[i] > 0 ? 1/sqrt(rowMax[i]) : 1;
+                deviation = max(deviation, fabs(1-rowMax[i]));
+            }
+            for (unsigned int j = 0; j < ncol; j++){
+                c(j) = columnMax[j] > 0 ? 1/sqrt(columnMax[j]) : 1;
+                deviation = max(deviation, fabs(1-columnMax[j]));
+            }
+            if (deviation < 1e-3){
+                break;
+            }
+            scale(r, c);
+            rowScale.elemMultiply(r);
+            columnScale.elemMultiply(c);
+        }
+    }
+    
+    void SparseMatrix::applyDirichlet(const std::vector<int>& dofs, const std::vector<double>& values, DenseMatrix& rhs,
+                                      double diagonal){
+#ifdef DEBUG
+        assertHasSparse();
+        assert(nrow == ncol && dofs.size() == values.size());
+        assert(rhs.getRows() == nrow && rhs.getColumns() == 1);
+#endif
+        std::vector<char> constrained(nrow, 0);
+        std::vector<double> g(nrow, 0);
+        for (size_t k = 0; k < dofs.size(); k++){
+#ifdef DEBUG
+            assert(dofs[k] >= 0 && dofs[k] < nrow);
+            assert(getDiagonalSlots()[dofs[k]] != -1); // the diagonal entry must be stored
+#endif
+            constrained[dofs[k]] = 1;
+            g[dofs[k]] = values[k];
+        }
+        double *b = rhs.getData();
+        if (indexType == INDEX_LONG){
+            eliminate<SuiteSparse_long>(sparse, constrained, g, b, diagonal);
+        } else {
+            eliminate<int>(sparse, constrained, g, b, diagonal);
+        }
+        for (size_t k = 0; k < dofs.size(); k++){
+            b[dofs[k]] = diagonal*values[k];
         }
-        for (int i=0;i<ncol;i++){
-                if (v(i) == 0){
-                        (*this)(i,i)=1.0;
-                }
     }
+    
+    const std::vector<long>& SparseMatrix::getDiagonalSlots(){
+        if (diagonalSlots.empty() && nrow > 0 && ncol > 0){
+            if (indexType == INDEX_LONG){
+                findDiagonal<SuiteSparse_long>(sparse, diagonalSlots);
+            } else {
+                findDiagonal<int>(sparse, diagonalSlots);
+            }
+        }
+        return diagonalSlots;
     }
  
     bool SparseMatrix::operator==(const SparseMatrix& RHS) const
@@ -268,8 +584,14 @@ namespace oocholmod {
         std::swap(values, other.values);
         std::swap(iRow, other.iRow);
         std::swap(jColumn, other.jColumn);
+        std::swap(iRowLong, other.iRowLong);
+        std::swap(jColumnLong, other.jColumnLong);
         std::swap(symmetry, other.symmetry);
+        std::swap(indexType, other.indexType);
         std::swap(maxTripletElements, other.maxTripletElements);
+        std::swap(mappedFile, other.mappedFile);
+        std::swap(diagonalSlots, other.diagonalSlots);
+        std::swap(transposeSlots, other.transposeSlots);
     }
     
     void swap(SparseMatrix& v1, SparseMatrix& v2) {
@@ -277,19 +599,29 @@ namespace oocholmod {
     }
    
     
-    Factor SparseMatrix::analyze() const
+    Factor SparseMatrix::analyze(FactorMode mode) const
     {
 #ifdef DEBUG
         assertHasSparse();
 #endif
-        cholmod_factor *L = cholmod_analyze(sparse, ConfigSingleton::getCommonPtr());
-        return Factor(L);
+        ScopedTimer timer("analyze", itype());
+        auto Common = ConfigSingleton::getCommonPtr(itype());
+        int supernodal = Common->supernodal;
+        if (mode == LDLT){
+            Common->supernodal = CHOLMOD_SIMPLICIAL;
+        }
+        cholmod_factor *L = OOCHOLMOD_CALL(itype(), analyze, sparse);
+        Common->supernodal = supernodal;
+        Factor F(L, mode);
+        timer.setFactor(L, F.lnz, F.flops);
+        timer.setSuccess(L != nullptr);
+        return F;
     }
    
     void SparseMatrix::write(const char* name) const {
         FILE *outstr = fopen(name, "w");
         if (sparse){
-            cholmod_write_sparse(outstr, sparse, 0, 0, ConfigSingleton::getCommonPtr());
+            OOCHOLMOD_CALL(itype(), write_sparse, outstr, sparse, nullptr, nullptr);
         }
         else {
             std::cout<<"No sparse matrix to write - have not been build !\n";
@@ -317,22 +649,16 @@ namespace oocholmod {
 #ifdef DEBUG
         assertHasSparse();
 #endif
-       return cholmod_norm_sparse(sparse, norm, ConfigSingleton::getCommonPtr());
+       return OOCHOLMOD_CALL(itype(), norm_sparse, sparse, norm);
     }
     
     SparseMatrix SparseMatrix::copy() const{
-        SparseMatrix res;
+        SparseMatrix res(0, 1, false, 200, indexType);
         if (sparse){
-            res.sparse = cholmod_copy_sparse(sparse, ConfigSingleton::getCommonPtr());
-            res.values = ((double*)res.sparse->x);
-            res.iRow = ((int*)res.sparse->i);
-            res.jColumn = ((int*)res.sparse->p);
+            res.setSparse(OOCHOLMOD_CALL(itype(), copy_sparse, sparse));
         }
         if (triplet){
-            res.triplet = cholmod_copy_triplet(triplet, ConfigSingleton::getCommonPtr());
-            res.values = (double *)res.triplet->x;
-            res.iRow = (int *)res.triplet->i;
-            res.jColumn = (int *)res.triplet->j;
+            res.setTriplet(OOCHOLMOD_CALL(itype(), copy_triplet, triplet));
         }
         res.nrow = nrow;
         res.ncol = ncol;
@@ -341,6 +667,59 @@ namespace oocholmod {
         return move(res);
     }
     
+    void SparseMatrix::releaseSparse(){
+        if (mappedFile){
+            // the header was allocated by the mapping constructor and the arrays belong to the mapping
+            delete sparse;
+            delete mappedFile;
+            mappedFile = nullptr;
+        } else {
+            OOCHOLMOD_CALL(itype(), free_sparse, &sparse);
+        }
+        sparse = nullptr;
+        diagonalSlots.clear();
+        transposeSlots.clear();
+    }
+    
+    void SparseMatrix::setSparse(cholmod_sparse *sparse){
+#ifdef DEBUG
+        assert(sparse->itype == CHOLMOD_INT || sparse->itype == CHOLMOD_LONG);
+#endif
+        this->sparse = sparse;
+        diagonalSlots.clear();
+        transposeSlots.clear();
+        indexType = sparse->itype == CHOLMOD_LONG ? INDEX_LONG : INDEX_INT;
+        values = (double*)sparse->x;
+        if (indexType == INDEX_LONG){
+            iRowLong = (SuiteSparse_long*)sparse->i;
+            jColumnLong = (SuiteSparse_long*)sparse->p;
+            iRow = nullptr;
+            jColumn = nullptr;
+        } else {
+            iRow = (int*)sparse->i;
+            jColumn = (int*)sparse->p;
+            iRowLong = nullptr;
+            jColumnLong = nullptr;
+        }
+    }
+    
+    void SparseMatrix::setTriplet(cholmod_triplet *triplet){
+        this->triplet = triplet;
+        indexType = triplet->itype == CHOLMOD_LONG ? INDEX_LONG : INDEX_INT;
+        values = (double*)triplet->x;
+        if (indexType == INDEX_LONG){
+            iRowLong = (SuiteSparse_long*)triplet->i;
+            jColumnLong = (SuiteSparse_long*)triplet->j;
+            iRow = nullptr;
+            jColumn = nullptr;
+        } else {
+            iRow = (int*)triplet->i;
+            jColumn = (int*)triplet->j;
+            iRowLong = nullptr;
+            jColumnLong = nullptr;
+        }
+    }
+    
     void SparseMatrix::assertHasSparse() const
     {
 #ifdef DEBUG
@@ -350,17 +729,14 @@ namespace oocholmod {
     
     void SparseMatrix::increaseTripletCapacity(){
         // grow size with factor 1.5
-        maxTripletElements = (int)ceil(1.5f*maxTripletElements);
-        auto newTriplet = cholmod_allocate_triplet(nrow, ncol, maxTripletElements, symmetry, CHOLMOD_REAL, ConfigSingleton::getCommonPtr());
+        maxTripletElements = (size_t)ceil(1.5*maxTripletElements);
+        auto newTriplet = OOCHOLMOD_CALL(itype(), allocate_triplet, nrow, ncol, maxTripletElements, symmetry, CHOLMOD_REAL);
         memcpy(newTriplet->x, triplet->x, triplet->nzmax*sizeof(double));
-        memcpy(newTriplet->i, triplet->i, triplet->nzmax*sizeof(int));
-        memcpy(newTriplet->j, triplet->j, triplet->nzmax*sizeof(int));
+        memcpy(newTriplet->i, triplet->i, triplet->nzmax*indexSize());
+        memcpy(newTriplet->j, triplet->j, triplet->nzmax*indexSize());
         newTriplet->nnz = triplet->nnz;
-        cholmod_free_triplet(&triplet, ConfigSingleton::getCommonPtr());
-        triplet = newTriplet;
-        values = (double *)triplet->x;
-        iRow = (int *)triplet->i;
-        jColumn = (int *)triplet->j;
+        OOCHOLMOD_CALL(itype(), free_triplet, &triplet);
+        setTriplet(newTriplet);
     }
     
     void SparseMatrix::assertValidInitAddValue(unsigned int row, unsigned int column) const {
@@ -376,8 +752,9 @@ namespace oocholmod {
     {
         assert(LHS.sparse && RHS.sparse);
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
+        assert(LHS.indexType == RHS.indexType);
         double scale[2] = {1.,1.};
-        cholmod_sparse *sparse = cholmod_add(LHS.sparse, RHS.sparse, scale, scale, true, true, ConfigSingleton::getCommonPtr());
+        cholmod_sparse *sparse = OOCHOLMOD_CALL(LHS.itype(), add, LHS.sparse, RHS.sparse, scale, scale, true, true);
         return SparseMatrix(sparse);
     }
     
@@ -385,13 +762,11 @@ namespace oocholmod {
     {
         assert(LHS.sparse && RHS.sparse);
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
+        assert(LHS.indexType == RHS.indexType);
         double scale[2] = {1.,1.};
-        cholmod_sparse *sparse = cholmod_add(LHS.sparse, RHS.sparse, scale, scale, true, true, ConfigSingleton::getCommonPtr());
-        cholmod_free_sparse(&LHS.sparse, ConfigSingleton::getCommonPtr());
-        LHS.sparse = sparse;
-        LHS.values = ((double*)sparse->x);
-        LHS.iRow = ((int*)sparse->i);
-        LHS.jColumn = ((int*)sparse->p);
+        cholmod_sparse *sparse = OOCHOLMOD_CALL(LHS.itype(), add, LHS.sparse, RHS.sparse, scale, scale, true, true);
+        LHS.releaseSparse();
+        LHS.setSparse(sparse);
         return move(LHS);
     }
     
@@ -419,9 +794,10 @@ namespace oocholmod {
     {
         assert(LHS.sparse && RHS.sparse);
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
+        assert(LHS.indexType == RHS.indexType);
         double alpha[2] = {1.,1.};
         double beta[2] = {-1.,-1.};
-        cholmod_sparse *sparse = cholmod_add(LHS.sparse, RHS.sparse, alpha, beta, true, true, ConfigSingleton::getCommonPtr());
+        cholmod_sparse *sparse = OOCHOLMOD_CALL(LHS.itype(), add, LHS.sparse, RHS.sparse, alpha, beta, true, true);
         return SparseMatrix(sparse);
     }
     
@@ -429,14 +805,12 @@ namespace oocholmod {
     {
         assert(LHS.sparse && RHS.sparse);
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
+        assert(LHS.indexType == RHS.indexType);
         double alpha[2] = {1.,1.};
         double beta[2] = {-1.,-1.};
-        cholmod_sparse *sparse = cholmod_add(LHS.sparse, RHS.sparse, alpha, beta, true, true, ConfigSingleton::getCommonPtr());
-        cholmod_free_sparse(&LHS.sparse, ConfigSingleton::getCommonPtr());
-        LHS.sparse = sparse;
-        LHS.values = ((double*)sparse->x);
-        LHS.iRow = ((int*)sparse->i);
-        LHS.jColumn = ((int*)sparse->p);
+        cholmod_sparse *sparse = OOCHOLMOD_CALL(LHS.itype(), add, LHS.sparse, RHS.sparse, alpha, beta, true, true);
+        LHS.releaseSparse();
+        LHS.setSparse(sparse);
         return move(LHS);
     }
     
@@ -444,14 +818,12 @@ namespace oocholmod {
     {
         assert(LHS.sparse && RHS.sparse);
         assert(LHS.nrow == RHS.nrow && LHS.ncol == RHS.ncol);
+        assert(LHS.indexType == RHS.indexType);
         double alpha[2] = {1.,1.};
         double beta[2] = {-1.,-1.};
-        cholmod_sparse *sparse = cholmod_add(LHS.sparse, RHS.sparse, alpha, beta, true, true, ConfigSingleton::getCommonPtr());
-        cholmod_free_sparse(&RHS.sparse, ConfigSingleton::getCommonPtr());
-        RHS.sparse = sparse;
-        RHS.values = ((double*)sparse->x);
-        RHS.iRow = ((int*)sparse->i);
-        RHS.jColumn = ((int*)sparse->p);
+        cholmod_sparse *sparse = OOCHOLMOD_CALL(LHS.itype(), add, LHS.sparse, RHS.sparse, alpha, beta, true, true);
+        RHS.releaseSparse();
+        RHS.setSparse(sparse);
         return move(RHS);
     }
     
@@ -464,7 +836,8 @@ namespace oocholmod {
     {
         assert(LHS.sparse && RHS.sparse);
         assert(LHS.ncol == RHS.nrow);
-        cholmod_sparse *sparse = cholmod_ssmult(LHS.sparse, RHS.sparse, ASYMMETRIC, true, true, ConfigSingleton::getCommonPtr());
+        assert(LHS.indexType == RHS.indexType);
+        cholmod_sparse *sparse = OOCHOLMOD_CALL(LHS.itype(), ssmult, LHS.sparse, RHS.sparse, ASYMMETRIC, true, true);
         return SparseMatrix(sparse);
     }
     
@@ -473,8 +846,8 @@ namespace oocholmod {
         assert(LHS.sparse);
         cholmod_dense *dense = cholmod_zeros(1, 1, CHOLMOD_REAL, ConfigSingleton::getCommonPtr());
         ((double*)dense->x)[0] = RHS;
-        cholmod_sparse *sparse = cholmod_copy_sparse(LHS.sparse, ConfigSingleton::getCommonPtr());
-        cholmod_scale(dense, CHOLMOD_SCALAR, sparse, ConfigSingleton::getCommonPtr());
+        cholmod_sparse *sparse = OOCHOLMOD_CALL(LHS.itype(), copy_sparse, LHS.sparse);
+        OOCHOLMOD_CALL(LHS.itype(), scale, dense, CHOLMOD_SCALAR, sparse);
         cholmod_free_dense(&dense, ConfigSingleton::getCommonPtr());
         return SparseMatrix(sparse);
     }
@@ -484,7 +857,7 @@ namespace oocholmod {
         assert(LHS.sparse);
         cholmod_dense *dense = cholmod_zeros(1, 1, CHOLMOD_REAL, ConfigSingleton::getCommonPtr());
         ((double*)dense->x)[0] = RHS;
-        cholmod_scale(dense, CHOLMOD_SCALAR, LHS.sparse, ConfigSingleton::getCommonPtr());
+        OOCHOLMOD_CALL(LHS.itype(), scale, dense, CHOLMOD_SCALAR, LHS.sparse);
         cholmod_free_dense(&dense, ConfigSingleton::getCommonPtr());
         return move(LHS);
     }
@@ -509,7 +882,7 @@ namespace oocholmod {
         double alpha[2] = {1.,1.};
         double beta[2] = {0.,0.};
         DenseMatrix res(RHS.ncol, LHS.nrow);
-        cholmod_sdmult(RHS.sparse, true, alpha, beta, transposed(LHS).dense, res.dense, ConfigSingleton::getCommonPtr());
+        OOCHOLMOD_CALL(RHS.itype(), sdmult, RHS.sparse, true, alpha, beta, transposed(LHS).dense, res.dense);
         return transposed(res);
     }
     
@@ -522,84 +895,105 @@ namespace oocholmod {
         double alpha[2] = {1.,1.};
         double beta[2] = {0.,0.};
         DenseMatrix res(LHS.nrow, RHS.ncol);
-        cholmod_sdmult(LHS.sparse, false, alpha, beta, RHS.dense, res.dense, ConfigSingleton::getCommonPtr());
+        OOCHOLMOD_CALL(LHS.itype(), sdmult, LHS.sparse, false, alpha, beta, RHS.dense, res.dense);
         return res;
     }
     
+    void multiply(const SparseMatrix& A, const DenseMatrix& x, DenseMatrix& y, double alpha, double beta, bool transA)
+    {
+#ifdef DEBUG
+        assert(A.sparse && x.dense && y.dense);
+        assert(A.sparse->packed);
+        assert((transA ? A.nrow : A.ncol) == x.nrow && (transA ? A.ncol : A.nrow) == y.nrow && x.ncol == y.ncol);
+        assert(x.getData() != y.getData());
+#endif
+        if (transA && A.symmetry == ASYMMETRIC){
+            if (A.indexType == INDEX_LONG){
+                transposedProduct<SuiteSparse_long>(A.sparse, x.dense, y.dense, alpha, beta);
+            } else {
+                transposedProduct<int>(A.sparse, x.dense, y.dense, alpha, beta);
+            }
+            return;
+        }
+        // A' = A for symmetric matrices
+        double alphas[2] = {alpha, 0.};
+        double betas[2] = {beta, 0.};
+        OOCHOLMOD_CALL(A.itype(), sdmult, A.sparse, false, alphas, betas, x.dense, y.dense);
+    }
+    
     void SparseMatrix::transpose()
     {
+#ifdef DEBUG
+        assertHasSparse();
         assert(symmetry == ASYMMETRIC);
-        sparse = cholmod_transpose(sparse, 1, ConfigSingleton::getCommonPtr());
-        nrow = static_cast<int>(sparse->nrow);
-        ncol = static_cast<int>(sparse->ncol);
-        values = ((double*)sparse->x);
-        iRow = ((int*)sparse->i);
-        jColumn = ((int*)sparse->p);
+        assert(sparse->packed);
+#endif
+        size_t nz = indexType == INDEX_LONG ? ((SuiteSparse_long*)sparse->p)[ncol] : ((int*)sparse->p)[ncol];
+        cholmod_sparse *T = OOCHOLMOD_CALL(itype(), allocate_sparse, ncol, nrow, max<size_t>(nz, 1), true, true, 0, CHOLMOD_REAL);
+        std::vector<long> slots;
+        if (indexType == INDEX_LONG){
+            transposeTo<SuiteSparse_long>(sparse, T, slots);
+        } else {
+            transposeTo<int>(sparse, T, slots);
+        }
+        releaseSparse();
+        setSparse(T);
+        transposeSlots.swap(slots);
+        std::swap(nrow, ncol);
     }
     
     SparseMatrix transposed(const SparseMatrix& M)
     {
-        assert(M.symmetry == ASYMMETRIC);
-        cholmod_sparse *sparse = cholmod_transpose(M.sparse, 1, ConfigSingleton::getCommonPtr());
-        return SparseMatrix(sparse);
+        SparseMatrix res;
+        transposed(M, res);
+        return res;
     }
     
     SparseMatrix&& transposed(SparseMatrix&& M)
     {
-        assert(M.symmetry == ASYMMETRIC);
-        cholmod_sparse *sparse = cholmod_transpose(M.sparse, 1, ConfigSingleton::getCommonPtr());
-        cholmod_free_sparse(&M.sparse, ConfigSingleton::getCommonPtr());
-        M.sparse = sparse;
-        M.nrow = static_cast<int>(sparse->nrow);
-        M.ncol = static_cast<int>(sparse->ncol);
-        M.values = ((double*)sparse->x);
-        M.iRow = ((int*)sparse->i);
-        M.jColumn = ((int*)sparse->p);
+        M.transpose();
         return move(M);
     }
-   
-    void SparseMatrix::symmetrize(){
-
-	// The original must be asymmetric
-	assert(symmetry == ASYMMETRIC);
-	
-	// allocate a new SYMMETRIX UPPER triplet matrix !
-	cholmod_triplet *triplet_symm = cholmod_allocate_triplet(static_cast<int>(sparse->nrow),static_cast<int>(sparse->ncol),
-					  	(int)cholmod_nnz(sparse,ConfigSingleton::getCommonPtr()),SYMMETRIC_UPPER,CHOLMOD_REAL, ConfigSingleton::getCommonPtr());
-
-	// Insert the upper part of sparse into the new triplet
-	int idx=0;	
-	for (int col=0;col<ncol;col++){
-                int iFrom = ((int*)sparse->p)[col];
-                int iTo = ((int*)sparse->p)[col+1]-1;
-                for (int i=iFrom;i<=iTo;i++){
-                        int row = ((int*)sparse->i)[i];
-			if (col >= row){ // Upper half
-				((int*)triplet_symm->i)[triplet_symm->nnz] = row;
-				((int*)triplet_symm->j)[triplet_symm->nnz] = col;
-				((double*)triplet_symm->x)[triplet_symm->nnz] = ((double*)sparse->x)[idx];
-				triplet_symm->nnz++;
-			}
-                        idx++;
-                }
-        }	
-
-	// Make sure not to leak
-	cholmod_free_sparse(&sparse, ConfigSingleton::getCommonPtr());
-	
-	// build the new sparse matrix
-        sparse = cholmod_triplet_to_sparse(triplet_symm, triplet_symm->nnz, ConfigSingleton::getCommonPtr());
-	// deallocate the triplet
-        cholmod_free_triplet(&triplet_symm, ConfigSingleton::getCommonPtr());
-        triplet_symm = nullptr;
-	// Set pointers to the sparse data
-        values = ((double*)sparse->x);
-        iRow = ((int*)sparse->i);
-        jColumn = ((int*)sparse->p);
-
-	
-
+    
+    void transposed(const SparseMatrix& M, SparseMatrix& result)
+    {
+#ifdef DEBUG
+        M.assertHasSparse();
+        assert(M.symmetry == ASYMMETRIC);
+        assert(M.sparse->packed);
+        assert(&M != &result);
+#endif
+        size_t nz = M.indexType == INDEX_LONG ? ((SuiteSparse_long*)M.sparse->p)[M.ncol] : ((int*)M.sparse->p)[M.ncol];
+        bool reusable = result.sparse && !result.mappedFile && result.indexType == M.indexType && result.nrow == M.ncol &&
+            result.ncol == M.nrow;
+        if (reusable && result.transposeSlots.size() == nz){
+            // the pattern of the last transpose into result (checked while the values are gathered)
+            bool gathered = M.indexType == INDEX_LONG ? gatherTranspose<SuiteSparse_long>(M.sparse, result.transposeSlots, result.sparse)
+                                                      : gatherTranspose<int>(M.sparse, result.transposeSlots, result.sparse);
+            if (gathered){
+                return;
+            }
+        }
+        if (!reusable || result.sparse->nzmax < nz || !result.sparse->packed){
+            if (result.sparse){
+                result.releaseSparse();
+            }
+            result.setSparse(OOCHOLMOD_CALL(M.itype(), allocate_sparse, M.ncol, M.nrow, max<size_t>(nz, 1), true, true, 0, CHOLMOD_REAL));
+        }
+        if (result.triplet){
+            OOCHOLMOD_CALL(result.itype(), free_triplet, &result.triplet);
+        }
+        result.diagonalSlots.clear();
+        if (M.indexType == INDEX_LONG){
+            transposeTo<SuiteSparse_long>(M.sparse, result.sparse, result.transposeSlots);
+        } else {
+            transposeTo<int>(M.sparse, result.sparse, result.transposeSlots);
+        }
+        result.nrow = M.ncol;
+        result.ncol = M.nrow;
+        result.symmetry = ASYMMETRIC;
     }
+   
  
     DenseMatrix solve(const SparseMatrix& A, const DenseMatrix& b)
     {
@@ -607,6 +1001,12 @@ namespace oocholmod {
         assert(A.sparse && b.dense);
         assert(A.nrow == b.nrow);
 #endif
+        if (A.symmetry == ASYMMETRIC){
+            LUFactor F;
+            F.analyze(A);
+            F.factorize(A);
+            return solve(F, b);
+        }
         Factor F = A.analyze();
         F.factorize(A);
         return solve(F, b);
@@ -618,6 +1018,9 @@ namespace oocholmod {
         assert(A.sparse && b.sparse);
         assert(A.nrow == b.nrow);
 #endif
+        if (A.symmetry == ASYMMETRIC){
+            return solve(A, b.toDense()).toSparse();
+        }
         Factor F = A.analyze();
         F.factorize(A);
         return solve(F, b);
@@ -627,7 +1030,7 @@ namespace oocholmod {
     {
         os << endl;
         if (A.sparse){
-            cholmod_print_sparse(A.sparse, "", ConfigSingleton::getCommonPtr());
+            OOCHOLMOD_CALL(A.itype(), print_sparse, A.sparse, "");
             DenseMatrix Dense = A.toDense();
             os << "[";
             for (int r = 0; r < Dense.getRows(); r++)
@@ -647,9 +1050,14 @@ namespace oocholmod {
             os << "];" << endl;
         }
         else if (A.triplet){
-            cholmod_print_triplet(A.triplet, "", ConfigSingleton::getCommonPtr());
-            for (int i = 0; i < A.triplet->nnz; i++){
-                os << "( " << ((int*)A.triplet->i)[i] << ", " << ((int*)A.triplet->j)[i]<<" ) =\t"<< ((double*)A.triplet->x)[i] << endl;
+            OOCHOLMOD_CALL(A.itype(), print_triplet, A.triplet, "");
+            for (size_t i = 0; i < A.triplet->nnz; i++){
+                if (A.indexType == INDEX_LONG){
+                    os << "( " << A.iRowLong[i] << ", " << A.jColumnLong[i];
+                } else {
+                    os << "( " << A.iRow[i] << ", " << A.jColumn[i];
+                }
+                os << " ) =\t" << A.values[i] << endl;
             }
         } else {
             os << "[Empty sparse matrix]" << endl;
@@ -10,15 +10,18 @@
 
 #include <map>
 #include <string> 
+#include <vector>
 #include <cholmod.h>
 
 #include "config_singleton.h"
+#include "factor.h"
 
 namespace oocholmod {
     
     // forward declaration
     class DenseMatrix;
     class Factor;
+    class MappedFile;
     
     enum Symmetry {
         SYMMETRIC_LOWER = -1, // Lower triangular part stored
@@ -26,6 +29,16 @@ namespace oocholmod {
         SYMMETRIC_UPPER = 1, // Upper triangular part stored
     };
     
+    enum IndexType {
+        INDEX_INT, // 32 bit indices (cholmod_* functions). Uses half the index memory and bandwidth.
+        INDEX_LONG // 64 bit indices (cholmod_l_* functions). Needed when A or its factor has more than 2^31-1 nonzeros
+    };
+    
+    enum MapMode {
+        MAP_READ_ONLY, // values cannot be changed
+        MAP_COPY_ON_WRITE // values can be changed, but changes are not written to the file
+    };
+    
     enum MatrixState {
         UNINITIALIZED,
         INIT,
@@ -40,12 +53,24 @@ namespace oocholmod {
     ///
     class SparseMatrix {
         friend class Factor;
+        friend class FloatSparseMatrix;
+        friend class SpGEMMPlan;
+        friend class AMG;
+        friend class LUFactor;
     public:
         /// nrow # of rows of A
         /// ncol # of columns of A
         /// initialNumberOfElements. If exceeded (during initialization of the matrix) the number of elements will automatically grow with a factor of 1.5
-        SparseMatrix(unsigned int nrow = 0, unsigned int ncol = 1, bool symmetric = false, int initialNumberOfElements = 200);
+        /// indexType. Matrices created from this matrix (sums, products, factors, solutions) use the same index type
+        SparseMatrix(unsigned int nrow = 0, unsigned int ncol = 1, bool symmetric = false, size_t initialNumberOfElements = 200,
+                     IndexType indexType = INDEX_INT);
         SparseMatrix(cholmod_sparse *sparse);
+        /// Memory maps a file written by writeBinary(). Pages of the file are only loaded when they are accessed,
+        /// so opening is fast regardless of the size. The matrix is uninitialized if the file cannot be mapped.
+        /// The header, column pointers and row indices are validated when the file is mapped (the values are not
+        /// read, use verifyBinary() to also check them against the checksum).
+        /// Operations that create a new matrix (transpose, add, ...) allocate it as usual.
+        SparseMatrix(const std::string& name, MapMode mode);
         SparseMatrix(SparseMatrix&& move);
         SparseMatrix& operator=(SparseMatrix&& other);
         
@@ -80,13 +105,32 @@ namespace oocholmod {
         
         friend DenseMatrix operator*(const DenseMatrix& LHS, const SparseMatrix& RHS);
         friend DenseMatrix operator*(const SparseMatrix& LHS, const DenseMatrix& RHS);
+        friend void multiply(const SparseMatrix& A, const DenseMatrix& x, DenseMatrix& y, double alpha, double beta, bool transA);
  
+        // Concatenation
+        friend SparseMatrix horzcat(const SparseMatrix& A, const SparseMatrix& B);
+        friend SparseMatrix vertcat(const SparseMatrix& A, const SparseMatrix& B);
+        friend SparseMatrix blockDiag(const SparseMatrix& A, const SparseMatrix& B);
+        friend SparseMatrix saddlePoint(const SparseMatrix& K, const SparseMatrix& B);
+        
         // Print
         friend std::ostream& operator<<(std::ostream& os, const SparseMatrix& A);
 
 	// write to matrix market format
 	void write(const char* name = "") const;
         
+        /// Reads a matrix market file (real, integer or pattern coordinate format). The file is memory mapped and
+        /// parsed in parallel when compiled with OpenMP. Symmetric files give a SYMMETRIC_UPPER matrix and
+        /// duplicate entries are summed. Returns an uninitialized matrix if the file cannot be read.
+        static SparseMatrix read(const char* name);
+        
+        /// Writes the matrix in a binary CSC format (header, column pointers, row indices, values and a checksum)
+        /// which can be memory mapped by the SparseMatrix(name, mode) constructor
+        void writeBinary(const char* name) const;
+        
+        /// Returns true if name is a binary matrix file with a valid checksum (reads the entire file)
+        static bool verifyBinary(const char* name);
+        
         // hasElement only valid on built matrix
         bool hasElement(unsigned int row, unsigned int column) const;
 
@@ -101,6 +145,7 @@ namespace oocholmod {
         ///
         /// Drop small entries from A, and entries in the ignored part of A if A is symmetric.
         /// keep entries with absolute values > tol
+        /// A memory mapped matrix is copied to memory first.
         void dropSmallEntries(double tol = 1e-7f);
         
         // in init state return the number of triplets
@@ -111,6 +156,7 @@ namespace oocholmod {
         void transpose();
         friend SparseMatrix transposed(const SparseMatrix& M);
         friend SparseMatrix&& transposed(SparseMatrix&& M);
+        friend void transposed(const SparseMatrix& M, SparseMatrix& result);
         
         // Solve
         friend DenseMatrix solve(const SparseMatrix& A, const DenseMatrix& b);
@@ -120,22 +166,64 @@ namespace oocholmod {
 	// Sum the rows and return a vector
         void sumRows(DenseMatrix& b);
 
-	// Hard coded method to perform: sparse = spdiags(N)^T * sparse * spdiags(N) - (spdiags(N) - speye())
-	void setNullSpace( DenseMatrix& N);       
+        /// Scales the matrix in place to diag(v)*A*diag(v) and sets the diagonal entries of the rows/columns where v is
+        /// zero to diagonal (if they are stored). With v in {0,1} and diagonal 1 this is
+        /// spdiags(v)^T * A * spdiags(v) - (spdiags(v) - speye()). Single pass over the values.
+        void setNullSpace(const DenseMatrix& v, double diagonal = 1.0);
+        
+        /// A = diag(rowScale)*A*diag(columnScale) in place in one pass over the values (in parallel when compiled with
+        /// OpenMP). Symmetric matrices must be scaled symmetrically (rowScale equals columnScale).
+        void scale(const DenseMatrix& rowScale, const DenseMatrix& columnScale);
+        /// A = diag(d)*A*diag(d)
+        void scale(const DenseMatrix& d);
+        
+        /// Equilibrates the matrix in place (Ruiz scaling in the infinity norm), such that the largest absolute value of
+        /// every row and column approaches 1. The matrix is replaced by diag(rowScale)*A*diag(columnScale), so Ax=b is
+        /// solved by y = (scaled A)^-1 diag(rowScale) b and x = diag(columnScale) y. Symmetric matrices stay symmetric
+        /// (rowScale equals columnScale).
+        void equilibrate(DenseMatrix& rowScale, DenseMatrix& columnScale, int iterations = 20);
+        
+        /// Applies the Dirichlet boundary conditions x(dofs[k]) = values[k] to the system Ax = rhs in a single pass over
+        /// the values: the rows and columns of the dofs are zeroed, their diagonal entries set to diagonal and
+        /// rhs is lifted (rhs -= A(:,dofs)*values, rhs(dofs) = diagonal*values). Symmetric matrices stay symmetric.
+        /// Entries are set to zero rather than removed, so the pattern (and a previous analyze()) is unchanged.
+        /// The diagonal entries of the dofs must be stored.
+        void applyDirichlet(const std::vector<int>& dofs, const std::vector<double>& values, DenseMatrix& rhs,
+                            double diagonal = 1.0);
  
         void build();
         
         SparseMatrix copy() const;
         
-        Factor analyze() const;
-       
-	void symmetrize();
+        /// Returns A(rows, columns) in O(nnz) without going through triplets. The indices must be unique, but need
+        /// not be sorted. The result is symmetric if the matrix is symmetric and rows equals columns.
+        SparseMatrix submatrix(const std::vector<int>& rows, const std::vector<int>& columns) const;
+        
+        /// Splits a square matrix into parts x parts blocks in a single pass over the columns (in parallel when
+        /// compiled with OpenMP). part[i] is the block (0 <= part[i] < parts) of row and column i, and the indices
+        /// keep their order within a block. Returns the blocks in row major order (block (p,q) at p*parts+q).
+        /// For a symmetric matrix the diagonal blocks are symmetric and the off-diagonal blocks are unsymmetric.
+        std::vector<SparseMatrix> partition(const std::vector<int>& part, int parts) const;
+        
+        /// Symbolic analysis (fill reducing ordering) for factorize. LDLT always gives a simplicial factor, which
+        /// factorize computes as LDL' without pivoting (symmetric indefinite matrices with nonzero pivots).
+        Factor analyze(FactorMode mode = CHOLESKY) const;
+        
+        /// Converts to symmetric storage by keeping the upper (SYMMETRIC_UPPER) or lower (SYMMETRIC_LOWER) triangular part.
+        /// The triangle of each column is copied directly (one allocation, no sorting, in parallel over the columns).
+        void symmetrize(Symmetry storage = SYMMETRIC_UPPER);
+        
+        /// Converts symmetric storage to unsymmetric storage of both triangular parts (the inverse of symmetrize).
+        /// One allocation and no sorting, in parallel over chunks of columns.
+        void expand();
  
         void zero();
         
         void setSymmetry(Symmetry symmetry);
         Symmetry getSymmetry() const { return symmetry; }
         
+        IndexType getIndexType() const { return indexType; }
+        
         int getRows() const { return nrow; }
         
         int getColumns() const { return ncol; }
@@ -156,6 +244,35 @@ namespace oocholmod {
             }
         }
         
+        /// A(row, column) += value of a built matrix. Elements outside the pattern are ignored, so unlike operator()
+        /// threads updating different entries never write to the same memory (see assembleColored).
+        inline void add(unsigned int row, unsigned int column, double value)
+        {
+#ifdef DEBUG
+            assertHasSparse();
+#endif
+            long index = getIndex(row, column);
+            if (index != -1){
+                values[index] += value;
+            }
+        }
+        
+        /// A(row, column) += value of a built matrix, which is safe when called from several threads at once (an atomic
+        /// update when compiled with OpenMP), for instance in a parallel reassembly into the pattern. Elements outside
+        /// the pattern are ignored. See also assembleColored, which avoids the atomic updates.
+        inline void atomicAdd(unsigned int row, unsigned int column, double value)
+        {
+#ifdef DEBUG
+            assertHasSparse();
+#endif
+            long index = getIndex(row, column);
+            if (index != -1){
+                double& entry = values[index];
+#pragma omp atomic
+                entry += value;
+            }
+        }
+        
         bool operator==(const SparseMatrix& RHS) const;
         bool operator!=(const SparseMatrix& RHS) const;
     private:
@@ -165,20 +282,29 @@ namespace oocholmod {
             int shiftBits = sizeof(long)*8/2; // shift half of the bits of a long
             return (((long)row)<<shiftBits)+column;
         }
+        void releaseSparse();
+        // takes ownership of sparse (the previous matrix must have been released) and updates the array pointers
+        void setSparse(cholmod_sparse *sparse);
+        void setTriplet(cholmod_triplet *triplet);
+        int itype() const { return indexType == INDEX_LONG ? CHOLMOD_LONG : CHOLMOD_INT; }
+        size_t indexSize() const { return indexType == INDEX_LONG ? sizeof(SuiteSparse_long) : sizeof(int); }
         void assertValidIndex(unsigned int row, unsigned int column) const;
         void assertHasSparse() const;
         void increaseTripletCapacity();
         void assertValidInitAddValue(unsigned int row, unsigned int column) const;
+        // index of the diagonal entry in each column (-1 if not stored). Computed once per pattern
+        const std::vector<long>& getDiagonalSlots();
         
-        inline int binarySearch(int *array, int low, int high, unsigned int value) const {
+        template<typename Int>
+        inline long binarySearch(const Int *array, long low, long high, unsigned int value) const {
             while (low <= high)
             {
                 // http://googleresearch.blogspot.dk/2006/06/extra-extra-read-all-about-it-nearly.html
-                int midpoint = (((unsigned int)high + (unsigned int)low) >> 1);
-                int midpointValue = array[midpoint];
-                if (value == midpointValue) {
+                long midpoint = (((unsigned long)high + (unsigned long)low) >> 1);
+                Int midpointValue = array[midpoint];
+                if ((Int)value == midpointValue) {
                     return midpoint;
-                } else if (value < midpointValue) {
+                } else if ((Int)value < midpointValue) {
                     high = midpoint - 1;
                 } else {
                     low = midpoint + 1;
@@ -187,7 +313,7 @@ namespace oocholmod {
             return -1;
         }
         
-        inline int getIndex(unsigned int row, unsigned int column) const
+        inline long getIndex(unsigned int row, unsigned int column) const
         {
 #if DEBUG
             assertValidIndex(row, column);
@@ -196,17 +322,14 @@ namespace oocholmod {
                 std::swap(row, column);
             }
             
-            int iFrom = jColumn[column];
-            int iTo = jColumn[column+1]-1;
-            
-            return binarySearch(iRow, iFrom, iTo, row);
+            if (indexType == INDEX_LONG){
+                return binarySearch(iRowLong, jColumnLong[column], jColumnLong[column+1]-1, row);
+            }
+            return binarySearch(iRow, jColumn[column], jColumn[column+1]-1, row);
         }
         
         inline void createTriplet(){
-            triplet = cholmod_allocate_triplet(nrow, ncol, maxTripletElements, symmetry, CHOLMOD_REAL, ConfigSingleton::getCommonPtr());
-            values = (double *)triplet->x;
-            iRow = (int *)triplet->i;
-            jColumn = (int *)triplet->j;
+            setTriplet(OOCHOLMOD_CALL(itype(), allocate_triplet, nrow, ncol, maxTripletElements, symmetry, CHOLMOD_REAL));
         }
         
         inline double& initAddValue(unsigned int row, unsigned int column)
@@ -217,8 +340,13 @@ namespace oocholmod {
                 increaseTripletCapacity();
             }
             assertValidInitAddValue(row, column);
-            iRow[triplet->nnz] = row;
-            jColumn[triplet->nnz] = column;
+            if (indexType == INDEX_LONG){
+                iRowLong[triplet->nnz] = row;
+                jColumnLong[triplet->nnz] = column;
+            } else {
+                iRow[triplet->nnz] = row;
+                jColumn[triplet->nnz] = column;
+            }
             values[triplet->nnz] = 0;
             
             triplet->nnz++;
@@ -230,7 +358,7 @@ namespace oocholmod {
 #ifdef DEBUG
             assertHasSparse();
 #endif
-            int index = getIndex(row, column);
+            long index = getIndex(row, column);
             if (index == -1){
                 static double zero = 0;
                 zero = 0;
@@ -244,7 +372,7 @@ namespace oocholmod {
 #ifdef DEBUG
             assertHasSparse();
 #endif
-            int index = getIndex(row, column);
+            long index = getIndex(row, column);
             if (index == -1){
                 return 0;
             }
@@ -256,10 +384,16 @@ namespace oocholmod {
         unsigned int nrow;
         unsigned int ncol;
         double *values;
-        int *iRow;
+        int *iRow;    // indices of INDEX_INT matrices (nullptr for INDEX_LONG)
         int *jColumn;
+        SuiteSparse_long *iRowLong; // indices of INDEX_LONG matrices (nullptr for INDEX_INT)
+        SuiteSparse_long *jColumnLong;
         Symmetry symmetry;
-        int maxTripletElements;
+        IndexType indexType;
+        size_t maxTripletElements;
+        MappedFile *mappedFile; // set when sparse points into a memory mapped file
+        std::vector<long> diagonalSlots; // cache of getDiagonalSlots() (cleared when the sparse matrix is replaced)
+        std::vector<long> transposeSlots; // entry of the transposed matrix each value was copied from (set when transposing)
     };
     
     // Addition
@@ -288,15 +422,33 @@ namespace oocholmod {
     // DenseMatrix times SparseMatrix (Note that SparseMatrix times DenseMatrix may be faster).
     DenseMatrix operator*(const DenseMatrix& LHS, const SparseMatrix& RHS);
     DenseMatrix operator*(const SparseMatrix& LHS, const DenseMatrix& RHS);
+    /// y = alpha*A*x + beta*y, or y = alpha*A'*x + beta*y if transA, into an existing y (which may be a view) without
+    /// allocating. y is not read if beta is 0. A'*x of an unsymmetric A is computed column by column in parallel.
+    void multiply(const SparseMatrix& A, const DenseMatrix& x, DenseMatrix& y, double alpha = 1, double beta = 0,
+                  bool transA = false);
+    
+    // Concatenation of built matrices. The CSC arrays are copied with offsets into a single allocation (no triplets
+    // or sorting). Symmetric arguments are expanded to both triangular parts unless the result is symmetric.
+    SparseMatrix horzcat(const SparseMatrix& A, const SparseMatrix& B); // [A B]
+    SparseMatrix vertcat(const SparseMatrix& A, const SparseMatrix& B); // [A; B]
+    SparseMatrix blockDiag(const SparseMatrix& A, const SparseMatrix& B); // [A 0; 0 B], symmetric if A and B have the same symmetry
+    // The saddle point matrix [K B'; B 0] with the symmetry of K (for instance SYMMETRIC_UPPER to factorize it)
+    SparseMatrix saddlePoint(const SparseMatrix& K, const SparseMatrix& B);
     
     // Transpose
     SparseMatrix transposed(const SparseMatrix& M);
     SparseMatrix&& transposed(SparseMatrix&& M);
+    /// Transposes M into result, reusing the buffers of result when they are large enough. result remembers which entry
+    /// of M each of its values came from, so transposing a matrix with the pattern of M into result again (for instance
+    /// M after its values changed) is a single gather pass over the values. The gather checks each entry against the
+    /// pattern of the matrix given, and falls back to a full transpose if it differs (another matrix of the same size,
+    /// or result changed by transpose() since).
+    void transposed(const SparseMatrix& M, SparseMatrix& result);
     
     // Swap
     void swap(SparseMatrix& v1, SparseMatrix& v2);
     
-    // Solve
+    // Solve (with a Factor, or an LUFactor if A is ASYMMETRIC)
     DenseMatrix solve(const SparseMatrix& A, const DenseMatrix& b);
     SparseMatrix solve(const SparseMatrix& A, const SparseMatrix& b);
     
@@ -0,0 +1,542 @@
+//
+//  sparse_matrix_blocks.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include "sparse_matrix.h"
+
+using namespace std;
+
+namespace oocholmod {
+
+    namespace {
+        template<typename Int>
+        int indexType(){
+            return sizeof(Int) == sizeof(int) ? CHOLMOD_INT : CHOLMOD_LONG;
+        }
+
+        // Returns the upper (stype > 0) or lower (stype < 0) triangular part of an unsymmetric matrix with sorted rows.
+        // The triangular part of each column is a contiguous range, so the columns are copied in parallel.
+        template<typename Int>
+        cholmod_sparse *toTriangle(const cholmod_sparse *A, int stype){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            long ncol = A->ncol;
+            vector<Int> from(ncol), count(ncol+1, 0);
+#pragma omp parallel for schedule(static)
+            for (long j = 0; j < ncol; j++){
+                const Int *begin = Ai + Ap[j], *end = Ai + Ap[j+1];
+                if (stype > 0){
+                    from[j] = Ap[j];
+                    count[j+1] = (Int)(upper_bound(begin, end, (Int)j) - begin);
+                } else {
+                    from[j] = (Int)(lower_bound(begin, end, (Int)j) - Ai);
+                    count[j+1] = Ap[j+1] - from[j];
+                }
+            }
+            for (long j = 0; j < ncol; j++){
+                count[j+1] += count[j];
+            }
+            cholmod_sparse *T = OOCHOLMOD_CALL(indexType<Int>(), allocate_sparse, A->nrow, ncol, max<size_t>(count[ncol], 1),
+                                               true, true, stype, CHOLMOD_REAL);
+            copy(count.begin(), count.end(), (Int*)T->p);
+            Int *Ti = (Int*)T->i;
+            double *Tx = (double*)T->x;
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long j = 0; j < ncol; j++){
+                Int size = count[j+1] - count[j];
+                copy(Ai + from[j], Ai + from[j] + size, Ti + count[j]);
+                copy(Ax + from[j], Ax + from[j] + size, Tx + count[j]);
+            }
+            return T;
+        }
+
+        // Returns both triangular parts of a symmetric matrix as an unsymmetric matrix (with sorted rows).
+        // Column j is the stored column followed (upper storage) or preceded (lower storage) by the transposed entries,
+        // which come from the later (earlier) columns. The transposed entries are counted and placed in parallel with
+        // atomic counters, so only O(n) extra memory is used. Their order within a column then depends on the thread
+        // scheduling, so a column is sorted if needed (never with a single thread).
+        template<typename Int>
+        cholmod_sparse *toFull(const cholmod_sparse *A){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            long n = A->ncol;
+            bool upper = A->stype > 0;
+            // next[i] is the number of transposed entries of column i (later the next position)
+            vector<Int> next(n, 0);
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long j = 0; j < n; j++){
+                for (Int p = Ap[j]; p < Ap[j+1]; p++){
+                    Int i = Ai[p];
+                    if (i != j){
+#pragma omp atomic
+                        next[i]++;
+                    }
+                }
+            }
+            vector<Int> own(n); // position of the stored column in the result
+            Int position = 0;
+            vector<Int> Fp(n+1);
+            for (long j = 0; j < n; j++){
+                Fp[j] = position;
+                if (upper){
+                    own[j] = position;
+                    position += Ap[j+1] - Ap[j];
+                }
+                Int count = next[j];
+                next[j] = position;
+                position += count;
+                if (!upper){
+                    own[j] = position;
+                    position += Ap[j+1] - Ap[j];
+                }
+            }
+            Fp[n] = position;
+            cholmod_sparse *full = OOCHOLMOD_CALL(indexType<Int>(), allocate_sparse, n, n, max<size_t>(position, 1), true, true,
+                                                  0, CHOLMOD_REAL);
+            copy(Fp.begin(), Fp.end(), (Int*)full->p);
+            Int *Fi = (Int*)full->i;
+            double *Fx = (double*)full->x;
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long j = 0; j < n; j++){
+                copy(Ai + Ap[j], Ai + Ap[j+1], Fi + own[j]);
+                copy(Ax + Ap[j], Ax + Ap[j+1], Fx + own[j]);
+                for (Int p = Ap[j]; p < Ap[j+1]; p++){
+                    Int i = Ai[p];
+                    if (i != j){
+                        Int index;
+#pragma omp atomic capture
+                        index = next[i]++;
+                        Fi[index] = (Int)j;
+                        Fx[index] = Ax[p];
+                    }
+                }
+            }
+#pragma omp parallel
+            {
+                vector<pair<Int, double>> entries;
+#pragma omp for schedule(dynamic, 256)
+                for (long j = 0; j < n; j++){
+                    Int from = upper ? own[j] + (Ap[j+1] - Ap[j]) : Fp[j];
+                    Int to = next[j];
+                    if (is_sorted(Fi + from, Fi + to)){
+                        continue;
+                    }
+                    entries.clear();
+                    for (Int k = from; k < to; k++){
+                        entries.push_back(make_pair(Fi[k], Fx[k]));
+                    }
+                    sort(entries.begin(), entries.end());
+                    for (Int k = from; k < to; k++){
+                        Fi[k] = entries[k-from].first;
+                        Fx[k] = entries[k-from].second;
+                    }
+                }
+            }
+            return full;
+        }
+
+        // Selects A(rows, columns) from an unsymmetric matrix, where rowMap[i] is the position of row i in the result
+        // (-1 if not selected). stype > 0 (stype < 0) keeps only the upper (lower) triangular part of the result.
+        template<typename Int>
+        cholmod_sparse *slice(const cholmod_sparse *A, const vector<Int> &rowMap, const vector<int> &columns, long nrow,
+                              int stype, bool sortedRows){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            long ncol = columns.size();
+            auto keep = [stype](Int row, long column){
+                return row >= 0 && (stype == 0 || (stype > 0 ? row <= column : row >= column));
+            };
+            vector<Int> count(ncol+1, 0);
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long k = 0; k < ncol; k++){
+                int j = columns[k];
+                for (Int p = Ap[j]; p < Ap[j+1]; p++){
+                    if (keep(rowMap[Ai[p]], k)){
+                        count[k+1]++;
+                    }
+                }
+            }
+            for (long k = 0; k < ncol; k++){
+                count[k+1] += count[k];
+            }
+            cholmod_sparse *S = OOCHOLMOD_CALL(indexType<Int>(), allocate_sparse, nrow, ncol, max<size_t>(count[ncol], 1), true,
+                                               true, stype, CHOLMOD_REAL);
+            Int *Sp = (Int*)S->p;
+            Int *Si = (Int*)S->i;
+            double *Sx = (double*)S->x;
+            copy(count.begin(), count.end(), Sp);
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long k = 0; k < ncol; k++){
+                int j = columns[k];
+                Int index = Sp[k];
+                for (Int p = Ap[j]; p < Ap[j+1]; p++){
+                    Int row = rowMap[Ai[p]];
+                    if (keep(row, k)){
+                        Si[index] = row;
+                        Sx[index] = Ax[p];
+                        index++;
+                    }
+                }
+                if (!sortedRows){
+                    vector<pair<Int, double>> column;
+                    for (Int q = Sp[k]; q < Sp[k+1]; q++){
+                        column.push_back(make_pair(Si[q], Sx[q]));
+                    }
+                    sort(column.begin(), column.end(),
+                         [](const pair<Int, double> &a, const pair<Int, double> &b){ return a.first < b.first; });
+                    for (size_t q = 0; q < column.size(); q++){
+                        Si[Sp[k]+q] = column[q].first;
+                        Sx[Sp[k]+q] = column[q].second;
+                    }
+                }
+            }
+            return S;
+        }
+
+        // Splits an unsymmetric square matrix into parts x parts blocks in one pass over the columns (see
+        // SparseMatrix::partition). Diagonal blocks keep only the triangular part given by stype.
+        template<typename Int>
+        vector<cholmod_sparse*> split(const cholmod_sparse *A, const vector<int> &part, int parts, int stype){
+            const Int *Ap = (const Int*)A->p;
+            const Int *Ai = (const Int*)A->i;
+            const double *Ax = (const double*)A->x;
+            long n = A->ncol;
+            // local[i] is the position of index i in its block
+            vector<Int> local(n);
+            vector<long> size(parts, 0);
+            for (long i = 0; i < n; i++){
+#ifdef DEBUG
+                assert(part[i] >= 0 && part[i] < parts);
+#endif
+                local[i] = size[part[i]]++;
+            }
+            auto keep = [&](Int i, long j){
+                return part[i] != part[j] || stype == 0 || (stype > 0 ? local[i] <= local[j] : local[i] >= local[j]);
+            };
+            // count[p*parts+q][k+1] is the number of entries in column k of block (p,q). Each column of A is the
+            // only writer of its column in the blocks, so the columns can be processed in parallel.
+            vector<vector<Int>> count(parts*parts);
+            for (int p = 0; p < parts; p++){
+                for (int q = 0; q < parts; q++){
+                    count[p*parts+q].assign(size[q]+1, 0);
+                }
+            }
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long j = 0; j < n; j++){
+                int q = part[j];
+                for (Int p = Ap[j]; p < Ap[j+1]; p++){
+                    Int i = Ai[p];
+                    if (keep(i, j)){
+                        count[part[i]*parts+q][local[j]+1]++;
+                    }
+                }
+            }
+            vector<cholmod_sparse*> blocks(parts*parts);
+            for (int p = 0; p < parts; p++){
+                for (int q = 0; q < parts; q++){
+                    vector<Int> &columnPointers = count[p*parts+q];
+                    for (long k = 0; k < size[q]; k++){
+                        columnPointers[k+1] += columnPointers[k];
+                    }
+                    blocks[p*parts+q] = OOCHOLMOD_CALL(indexType<Int>(), allocate_sparse, size[p], size[q],
+                                                       max<size_t>(columnPointers[size[q]], 1), true, true,
+                                                       p == q ? stype : 0, CHOLMOD_REAL);
+                    copy(columnPointers.begin(), columnPointers.end(), (Int*)blocks[p*parts+q]->p);
+                }
+            }
+            // the rows are sorted, since the local positions keep the order of the indices
+#pragma omp parallel for schedule(dynamic, 256)
+            for (long j = 0; j < n; j++){
+                int q = part[j];
+                Int k = local[j];
+                for (Int p = Ap[j]; p < Ap[j+1]; p++){
+                    Int i = Ai[p];
+                    if (keep(i, j)){
+                        vector<Int> &next = count[part[i]*parts+q];
+                        cholmod_sparse *block = blocks[part[i]*parts+q];
+                        Int index = next[k]++;
+                        ((Int*)block->i)[index] = local[i];
+                        ((double*)block->x)[index] = Ax[p];
+                    }
+                }
+            }
+            return blocks;
+        }
+
+        // A block of a concatenation, placed at (row, column) of the result
+        struct Placement {
+            const cholmod_sparse *A;
+            long row;
+            long column;
+        };
+
+        // Copies the blocks (which must not overlap) into a single CSC matrix. The blocks of each column are copied
+        // in the order of their row offsets, so the rows of the result are sorted without sorting.
+        template<typename Int>
+        cholmod_sparse *concatenate(vector<Placement> blocks, long nrow, long ncol, int stype){
+            stable_sort(blocks.begin(), blocks.end(), [](const Placement &a, const Placement &b){ return a.row < b.row; });
+            vector<Int> next(ncol+1, 0);
+            for (const Placement &block : blocks){
+                const Int *Ap = (const Int*)block.A->p;
+#ifdef DEBUG
+                assert(block.A->packed && block.A->sorted);
+                assert(block.row + (long)block.A->nrow <= nrow && block.column + (long)block.A->ncol <= ncol);
+#endif
+                for (long j = 0; j < (long)block.A->ncol; j++){
+                    next[block.column+j+1] += Ap[j+1]-Ap[j];
+                }
+            }
+            for (long j = 0; j < ncol; j++){
+                next[j+1] += next[j];
+            }
+            cholmod_sparse *C = OOCHOLMOD_CALL(indexType<Int>(), allocate_sparse, nrow, ncol, max<size_t>(next[ncol], 1), true,
+                                               true, stype, CHOLMOD_REAL);
+            copy(next.begin(), next.end(), (Int*)C->p);
+            Int *Ci = (Int*)C->i;
+            double *Cx = (double*)C->x;
+            for (const Placement &block : blocks){
+                const Int *Ap = (const Int*)block.A->p;
+                const Int *Ai = (const Int*)block.A->i;
+                const double *Ax = (const double*)block.A->x;
+                Int rowOffset = (Int)block.row;
+#pragma omp parallel for schedule(dynamic, 256)
+                for (long j = 0; j < (long)block.A->ncol; j++){
+                    Int index = next[block.column+j];
+                    for (Int p = Ap[j]; p < Ap[j+1]; p++, index++){
+                        Ci[index] = Ai[p] + rowOffset;
+                        Cx[index] = Ax[p];
+                    }
+                    next[block.column+j] = index;
+                }
+            }
+            return C;
+        }
+
+        // Returns A if it is unsymmetric and otherwise an expanded copy (which is added to temporaries)
+        template<typename Int>
+        const cholmod_sparse *unsymmetric(const cholmod_sparse *A, vector<cholmod_sparse*> &temporaries){
+            if (A->stype == 0){
+                return A;
+            }
+            temporaries.push_back(toFull<Int>(A));
+            return temporaries.back();
+        }
+
+        enum Concatenation {
+            HORIZONTAL,
+            VERTICAL,
+            BLOCK_DIAGONAL
+        };
+
+        template<typename Int>
+        cholmod_sparse *concatenate(const cholmod_sparse *A, const cholmod_sparse *B, Concatenation concatenation){
+            vector<cholmod_sparse*> temporaries;
+            int stype = 0;
+            if (concatenation == BLOCK_DIAGONAL && A->stype == B->stype){
+                stype = A->stype;
+            } else {
+                A = unsymmetric<Int>(A, temporaries);
+                B = unsymmetric<Int>(B, temporaries);
+            }
+            cholmod_sparse *C;
+            if (concatenation == HORIZONTAL){
+#ifdef DEBUG
+                assert(A->nrow == B->nrow);
+#endif
+                C = concatenate<Int>({{A, 0, 0}, {B, 0, (long)A->ncol}}, A->nrow, A->ncol + B->ncol, stype);
+            } else if (concatenation == VERTICAL){
+#ifdef DEBUG
+                assert(A->ncol == B->ncol);
+#endif
+                C = concatenate<Int>({{A, 0, 0}, {B, (long)A->nrow, 0}}, A->nrow + B->nrow, A->ncol, stype);
+            } else {
+                C = concatenate<Int>({{A, 0, 0}, {B, (long)A->nrow, (long)A->ncol}}, A->nrow + B->nrow, A->ncol + B->ncol,
+                                     stype);
+            }
+            for (cholmod_sparse *temporary : temporaries){
+                OOCHOLMOD_CALL(indexType<Int>(), free_sparse, &temporary);
+            }
+            return C;
+        }
+
+        template<typename Int>
+        cholmod_sparse *saddlePoint(const cholmod_sparse *K, const cholmod_sparse *B){
+#ifdef DEBUG
+            assert(K->nrow == K->ncol && B->ncol == K->ncol);
+            assert(B->stype == 0);
+#endif
+            long n = K->ncol, m = B->nrow;
+            cholmod_sparse *Bt = OOCHOLMOD_CALL(indexType<Int>(), transpose, const_cast<cholmod_sparse*>(B), 1);
+            cholmod_sparse *C;
+            if (K->stype > 0){
+                C = concatenate<Int>({{K, 0, 0}, {Bt, 0, n}}, n+m, n+m, K->stype);
+            } else if (K->stype < 0){
+                C = concatenate<Int>({{K, 0, 0}, {B, n, 0}}, n+m, n+m, K->stype);
+            } else {
+                C = concatenate<Int>({{K, 0, 0}, {Bt, 0, n}, {B, n, 0}}, n+m, n+m, 0);
+            }
+            OOCHOLMOD_CALL(indexType<Int>(), free_sparse, &Bt);
+            return C;
+        }
+
+        template<typename Int>
+        cholmod_sparse *submatrix(const cholmod_sparse *A, const vector<int> &rows, const vector<int> &columns){
+            bool symmetric = A->stype != 0;
+            bool sortedRows = true;
+            vector<Int> rowMap(A->nrow, -1);
+            for (size_t k = 0; k < rows.size(); k++){
+#ifdef DEBUG
+                assert(rows[k] >= 0 && rows[k] < (long)A->nrow);
+                assert(rowMap[rows[k]] == -1); // the rows must be unique
+#endif
+                rowMap[rows[k]] = (Int)k;
+                sortedRows = sortedRows && (k == 0 || rows[k-1] < rows[k]);
+            }
+#ifdef DEBUG
+            for (int column : columns){
+                assert(column >= 0 && column < (long)A->ncol);
+            }
+#endif
+            int stype = symmetric && rows == columns ? A->stype : 0;
+            if (!symmetric){
+                return slice<Int>(A, rowMap, columns, rows.size(), stype, sortedRows);
+            }
+            cholmod_sparse *full = toFull<Int>(A);
+            cholmod_sparse *S = slice<Int>(full, rowMap, columns, rows.size(), stype, sortedRows);
+            OOCHOLMOD_CALL(indexType<Int>(), free_sparse, &full);
+            return S;
+        }
+
+        template<typename Int>
+        vector<cholmod_sparse*> partition(const cholmod_sparse *A, const vector<int> &part, int parts){
+            if (A->stype == 0){
+                return split<Int>(A, part, parts, 0);
+            }
+            cholmod_sparse *full = toFull<Int>(A);
+            vector<cholmod_sparse*> blocks = split<Int>(full, part, parts, A->stype);
+            OOCHOLMOD_CALL(indexType<Int>(), free_sparse, &full);
+            return blocks;
+        }
+    }
+
+    SparseMatrix SparseMatrix::submatrix(const std::vector<int>& rows, const std::vector<int>& columns) const {
+#ifdef DEBUG
+        assertHasSparse();
+        assert(sparse->packed && sparse->sorted);
+#endif
+        if (indexType == INDEX_LONG){
+            return SparseMatrix(oocholmod::submatrix<SuiteSparse_long>(sparse, rows, columns));
+        }
+        return SparseMatrix(oocholmod::submatrix<int>(sparse, rows, columns));
+    }
+
+    std::vector<SparseMatrix> SparseMatrix::partition(const std::vector<int>& part, int parts) const {
+#ifdef DEBUG
+        assertHasSparse();
+        assert(sparse->packed && sparse->sorted);
+        assert(nrow == ncol && part.size() == nrow);
+#endif
+        vector<cholmod_sparse*> blocks = indexType == INDEX_LONG ?
+            oocholmod::partition<SuiteSparse_long>(sparse, part, parts) :
+            oocholmod::partition<int>(sparse, part, parts);
+        vector<SparseMatrix> res;
+        res.reserve(blocks.size());
+        for (cholmod_sparse *block : blocks){
+            res.push_back(SparseMatrix(block));
+        }
+        return res;
+    }
+
+    namespace {
+        cholmod_sparse *concatenate(const cholmod_sparse *A, const cholmod_sparse *B, IndexType indexType,
+                                    Concatenation concatenation){
+            if (indexType == INDEX_LONG){
+                return concatenate<SuiteSparse_long>(A, B, concatenation);
+            }
+            return concatenate<int>(A, B, concatenation);
+        }
+    }
+
+    SparseMatrix horzcat(const SparseMatrix& A, const SparseMatrix& B){
+#ifdef DEBUG
+        assert(A.getMatrixState() == BUILT && B.getMatrixState() == BUILT);
+        assert(A.getIndexType() == B.getIndexType());
+#endif
+        return SparseMatrix(concatenate(A.sparse, B.sparse, A.getIndexType(), HORIZONTAL));
+    }
+
+    SparseMatrix vertcat(const SparseMatrix& A, const SparseMatrix& B){
+#ifdef DEBUG
+        assert(A.getMatrixState() == BUILT && B.getMatrixState() == BUILT);
+        assert(A.getIndexType() == B.getIndexType());
+#endif
+        return SparseMatrix(concatenate(A.sparse, B.sparse, A.getIndexType(), VERTICAL));
+    }
+
+    SparseMatrix blockDiag(const SparseMatrix& A, const SparseMatrix& B){
+#ifdef DEBUG
+        assert(A.getMatrixState() == BUILT && B.getMatrixState() == BUILT);
+        assert(A.getIndexType() == B.getIndexType());
+#endif
+        return SparseMatrix(concatenate(A.sparse, B.sparse, A.getIndexType(), BLOCK_DIAGONAL));
+    }
+
+    SparseMatrix saddlePoint(const SparseMatrix& K, const SparseMatrix& B){
+#ifdef DEBUG
+        assert(K.getMatrixState() == BUILT && B.getMatrixState() == BUILT);
+        assert(K.getIndexType() == B.getIndexType());
+#endif
+        if (K.getIndexType() == INDEX_LONG){
+            return SparseMatrix(saddlePoint<SuiteSparse_long>(K.sparse, B.sparse));
+        }
+        return SparseMatrix(saddlePoint<int>(K.sparse, B.sparse));
+    }
+
+    void SparseMatrix::symmetrize(Symmetry storage){
+#ifdef DEBUG
+        assertHasSparse();
+        assert(nrow == ncol && storage != ASYMMETRIC);
+        assert(sparse->packed && sparse->sorted);
+#endif
+        if (symmetry == storage){
+            return;
+        }
+        cholmod_sparse *full = nullptr;
+        if (symmetry != ASYMMETRIC){
+            full = indexType == INDEX_LONG ? toFull<SuiteSparse_long>(sparse) : toFull<int>(sparse);
+        }
+        const cholmod_sparse *A = full ? full : sparse;
+        cholmod_sparse *triangle = indexType == INDEX_LONG ? toTriangle<SuiteSparse_long>(A, storage) : toTriangle<int>(A, storage);
+        if (full){
+            OOCHOLMOD_CALL(itype(), free_sparse, &full);
+        }
+        releaseSparse();
+        setSparse(triangle);
+        symmetry = storage;
+    }
+
+    void SparseMatrix::expand(){
+#ifdef DEBUG
+        assertHasSparse();
+        assert(sparse->packed && sparse->sorted);
+#endif
+        if (symmetry == ASYMMETRIC){
+            return;
+        }
+        cholmod_sparse *full = indexType == INDEX_LONG ? toFull<SuiteSparse_long>(sparse) : toFull<int>(sparse);
+        releaseSparse();
+        setSparse(full);
+        symmetry = ASYMMETRIC;
+    }
+}
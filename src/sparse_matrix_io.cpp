@@ -0,0 +1,614 @@
+//
+//  sparse_matrix_io.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "sparse_matrix.h"
+#include "mapped_file.h"
+
+using namespace std;
+
+namespace oocholmod {
+
+    namespace {
+
+        inline const char *skipBlanks(const char *p, const char *end){
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')){
+                p++;
+            }
+            return p;
+        }
+
+        inline const char *nextLine(const char *p, const char *end){
+            if (p >= end){
+                return end;
+            }
+            const char *newline = (const char*)memchr(p, '\n', size_t(end-p));
+            return newline ? newline+1 : end;
+        }
+
+        inline bool parseIndex(const char *&p, const char *end, long &value){
+            p = skipBlanks(p, end);
+            if (p == end || !isdigit((unsigned char)*p)){
+                return false;
+            }
+            value = 0;
+            while (p < end && isdigit((unsigned char)*p)){
+                value = value*10 + (*p - '0');
+                p++;
+            }
+            return true;
+        }
+
+        // Parses a decimal floating point number. Numbers with at most 19 significant digits and a small decimal
+        // exponent are converted with a single correctly rounded multiplication or division of exact operands:
+        // in double precision if the mantissa fits in 53 bits, otherwise in 64 bit extended precision (when
+        // long double has it) where the second rounding to double is exact unless the extended result is a
+        // halfway point. Everything else (long mantissas, huge exponents, halfway cases, inf, nan) is
+        // delegated to strtod, so the result always equals strtod's.
+        bool parseDouble(const char *&p, const char *end, double &value){
+            static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+            p = skipBlanks(p, end);
+            const char *start = p;
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')){
+                negative = *p == '-';
+                p++;
+            }
+            uint64_t mantissa = 0;
+            int significantDigits = 0;
+            int exponent = 0;
+            bool hasDigits = false;
+            bool truncated = false;
+            while (p < end && isdigit((unsigned char)*p)){
+                hasDigits = true;
+                if (significantDigits < 19){
+                    mantissa = mantissa*10 + (*p - '0');
+                    significantDigits += mantissa != 0;
+                } else {
+                    truncated |= *p != '0';
+                    exponent++;
+                }
+                p++;
+            }
+            if (p < end && *p == '.'){
+                p++;
+                while (p < end && isdigit((unsigned char)*p)){
+                    hasDigits = true;
+                    if (significantDigits < 19){
+                        mantissa = mantissa*10 + (*p - '0');
+                        significantDigits += mantissa != 0;
+                        exponent--;
+                    } else {
+                        truncated |= *p != '0';
+                    }
+                    p++;
+                }
+            }
+            if (hasDigits && p < end && (*p == 'e' || *p == 'E' || *p == 'd' || *p == 'D')){
+                const char *exponentStart = p;
+                p++;
+                bool negativeExponent = false;
+                if (p < end && (*p == '-' || *p == '+')){
+                    negativeExponent = *p == '-';
+                    p++;
+                }
+                if (p < end && isdigit((unsigned char)*p)){
+                    int e = 0;
+                    while (p < end && isdigit((unsigned char)*p)){
+                        if (e < 100000){
+                            e = e*10 + (*p - '0');
+                        }
+                        p++;
+                    }
+                    exponent += negativeExponent ? -e : e;
+                } else {
+                    p = exponentStart;
+                }
+            }
+            if (hasDigits && !truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22){
+                value = exponent < 0 ? mantissa / powersOf10[-exponent] : mantissa * powersOf10[exponent];
+                if (negative){
+                    value = -value;
+                }
+                return true;
+            }
+#if LDBL_MANT_DIG == 64
+            static const long double extendedPowersOf10[] = {1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L,
+                1e9L, 1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L,
+                1e23L, 1e24L, 1e25L, 1e26L, 1e27L};
+            if (hasDigits && !truncated && exponent >= -27 && exponent <= 27){
+                long double extended = exponent < 0 ? mantissa / extendedPowersOf10[-exponent] :
+                    mantissa * extendedPowersOf10[exponent];
+                int binaryExponent;
+                uint64_t bits = (uint64_t)ldexpl(frexpl(extended, &binaryExponent), 64);
+                if ((bits & 0x7ff) != 0x400){
+                    value = (double)(negative ? -extended : extended);
+                    return true;
+                }
+            }
+#endif
+            // slow path: strtod needs a zero terminated string
+            char token[128];
+            size_t length = 0;
+            p = start;
+            while (p < end && length < sizeof(token)-1 && !isspace((unsigned char)*p)){
+                token[length++] = *p++;
+            }
+            token[length] = 0;
+            char *tokenEnd;
+            value = strtod(token, &tokenEnd);
+            return tokenEnd != token && tokenEnd == token + length;
+        }
+
+        const char binaryMagic[8] = {'O', 'O', 'C', 'H', 'C', 'S', 'C', 0};
+        const uint32_t binaryVersion = 1;
+        const uint32_t binaryByteOrder = 0x01020304;
+        const uint64_t binaryAlignment = 64;
+
+        // Layout of the binary CSC format. The header is followed by the column pointers, row indices and values,
+        // each starting at an offset aligned to binaryAlignment. Integers are stored in native byte order.
+        struct BinaryHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            int32_t stype;
+            uint32_t indexSize; // bytes per column pointer and row index (4 for INDEX_INT, 8 for INDEX_LONG)
+            uint64_t nrow;
+            uint64_t ncol;
+            uint64_t nnz;
+            uint64_t pOffset;
+            uint64_t iOffset;
+            uint64_t xOffset;
+            uint64_t checksum; // of the p, i and x arrays
+        };
+
+        inline uint64_t alignOffset(uint64_t offset){
+            return (offset + binaryAlignment - 1) / binaryAlignment * binaryAlignment;
+        }
+
+        inline uint64_t rotateLeft(uint64_t x, int bits){
+            return (x << bits) | (x >> (64 - bits));
+        }
+
+        // Fast non-cryptographic checksum processing four independent 64 bit lanes
+        uint64_t checksum(const void *data, size_t bytes, uint64_t seed){
+            const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+            const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+            uint64_t lanes[4] = {seed + prime1, seed + prime2, seed, seed - prime1};
+            const char *p = (const char*)data;
+            size_t words = bytes / 8;
+            size_t k = 0;
+            for (; k+4 <= words; k += 4){
+                for (int l = 0; l < 4; l++){
+                    uint64_t word;
+                    memcpy(&word, p + (k+l)*8, 8);
+                    lanes[l] = rotateLeft(lanes[l] + word*prime2, 31) * prime1;
+                }
+            }
+            uint64_t h = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+            for (; k < words; k++){
+                uint64_t word;
+                memcpy(&word, p + k*8, 8);
+                h = rotateLeft(h ^ (word*prime2), 27) * prime1;
+            }
+            for (size_t b = words*8; b < bytes; b++){
+                h = rotateLeft(h ^ ((unsigned char)p[b]*prime1), 11) * prime2;
+            }
+            return h ^ (h >> 29) ^ bytes;
+        }
+
+        uint64_t checksum(const void *p, size_t pBytes, const void *i, size_t iBytes, const void *x, size_t xBytes){
+            return checksum(x, xBytes, checksum(i, iBytes, checksum(p, pBytes, 0)));
+        }
+
+        // true if count elements of elementSize bytes starting at offset lie inside the file (without overflow,
+        // since the header may contain anything)
+        inline bool fitsInFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size){
+            return offset <= size && count <= (size - offset) / elementSize;
+        }
+
+        // Returns the header if the mapped file is a valid binary matrix file (the arrays are not read)
+        const BinaryHeader *binaryHeader(const MappedFile &file){
+            if (!file.isOpen() || file.size() < sizeof(BinaryHeader)){
+                return nullptr;
+            }
+            const BinaryHeader *header = (const BinaryHeader*)file.begin();
+            bool longIndex = header->indexSize == sizeof(SuiteSparse_long);
+            if (memcmp(header->magic, binaryMagic, sizeof(binaryMagic)) != 0 || header->version != binaryVersion ||
+                header->byteOrder != binaryByteOrder || (header->indexSize != sizeof(int) && !longIndex) ||
+                header->nrow > INT32_MAX || header->ncol > INT32_MAX || (!longIndex && header->nnz > INT32_MAX) ||
+                header->pOffset % sizeof(double) != 0 || header->iOffset % sizeof(double) != 0 ||
+                header->xOffset % sizeof(double) != 0 || header->stype < -1 || header->stype > 1 ||
+                (header->stype != 0 && header->nrow != header->ncol) ||
+                !fitsInFile(header->pOffset, header->ncol+1, header->indexSize, file.size()) ||
+                !fitsInFile(header->iOffset, header->nnz, header->indexSize, file.size()) ||
+                !fitsInFile(header->xOffset, header->nnz, sizeof(double), file.size())){
+                return nullptr;
+            }
+            const char *p = file.begin() + header->pOffset;
+            uint64_t first = longIndex ? ((const SuiteSparse_long*)p)[0] : ((const int*)p)[0];
+            uint64_t last = longIndex ? ((const SuiteSparse_long*)p)[header->ncol] : ((const int*)p)[header->ncol];
+            if (first != 0 || last != header->nnz){
+                return nullptr;
+            }
+            return header;
+        }
+
+        // Checks that the column pointers are nondecreasing and that the row indices are in [0,nrow), and sets
+        // sorted if the row indices of each column are increasing. Reads the column pointers and row indices.
+        template<typename Int>
+        bool validPattern(const Int *p, const Int *i, Int nrow, Int ncol, bool &sorted){
+            for (Int j = 0; j < ncol; j++){
+                if (p[j] > p[j+1]){
+                    return false;
+                }
+            }
+            bool valid = true;
+            bool increasing = true;
+            #pragma omp parallel for schedule(dynamic,256) reduction(&&:valid,increasing)
+            for (Int j = 0; j < ncol; j++){
+                for (Int k = p[j]; k < p[j+1]; k++){
+                    valid = valid && i[k] >= 0 && i[k] < nrow;
+                    increasing = increasing && (k == p[j] || i[k-1] < i[k]);
+                }
+            }
+            sorted = increasing;
+            return valid;
+        }
+
+        bool validPattern(const BinaryHeader *header, const char *data, bool &sorted){
+            if (header->indexSize == sizeof(SuiteSparse_long)){
+                return validPattern((const SuiteSparse_long*)(data + header->pOffset),
+                                    (const SuiteSparse_long*)(data + header->iOffset),
+                                    (SuiteSparse_long)header->nrow, (SuiteSparse_long)header->ncol, sorted);
+            }
+            return validPattern((const int*)(data + header->pOffset), (const int*)(data + header->iOffset),
+                                (int)header->nrow, (int)header->ncol, sorted);
+        }
+
+        struct Chunk {
+            vector<int> rows;
+            vector<int> columns;
+            vector<double> values;
+            long lines = 0;
+            bool failed = false;
+        };
+
+        enum MatrixMarketSymmetry {
+            MM_GENERAL,
+            MM_SYMMETRIC,
+            MM_SKEW_SYMMETRIC
+        };
+
+        // Parses the entry lines in [p, end) into 0-based triplets. Symmetric entries are moved to the upper
+        // triangle, and skew symmetric entries are expanded to both triangles.
+        void parseChunk(const char *p, const char *end, long nrow, long ncol, bool pattern,
+                        MatrixMarketSymmetry mmSymmetry, Chunk &chunk){
+            chunk.rows.reserve((end-p)/16);
+            chunk.columns.reserve((end-p)/16);
+            chunk.values.reserve(pattern ? 0 : (end-p)/16);
+            while (p < end){
+                const char *lineStart = skipBlanks(p, end);
+                if (lineStart == end || *lineStart == '\n' || *lineStart == '%'){
+                    p = nextLine(lineStart, end);
+                    continue;
+                }
+                p = lineStart;
+                long row, column;
+                double value = 1;
+                if (!parseIndex(p, end, row) || !parseIndex(p, end, column) || (!pattern && !parseDouble(p, end, value)) ||
+                    row < 1 || row > nrow || column < 1 || column > ncol){
+                    chunk.failed = true;
+                    return;
+                }
+                row--;
+                column--;
+                chunk.lines++;
+                if (mmSymmetry == MM_SYMMETRIC && row > column){
+                    std::swap(row, column);
+                }
+                chunk.rows.push_back((int)row);
+                chunk.columns.push_back((int)column);
+                if (!pattern){
+                    chunk.values.push_back(value);
+                }
+                if (mmSymmetry == MM_SKEW_SYMMETRIC && row != column){
+                    chunk.rows.push_back((int)column);
+                    chunk.columns.push_back((int)row);
+                    if (!pattern){
+                        chunk.values.push_back(-value);
+                    }
+                }
+                p = nextLine(p, end);
+            }
+        }
+
+        bool readHeader(const char *&p, const char *end, bool &pattern, MatrixMarketSymmetry &mmSymmetry,
+                        long &nrow, long &ncol, long &nnz){
+            const char *headerEnd = nextLine(p, end);
+            string header(p, headerEnd);
+            transform(header.begin(), header.end(), header.begin(), ::tolower);
+            if (header.compare(0, 14, "%%matrixmarket") != 0 || header.find("coordinate") == string::npos){
+                return false;
+            }
+            if (header.find("complex") != string::npos || header.find("hermitian") != string::npos){
+                return false;
+            }
+            pattern = header.find("pattern") != string::npos;
+            mmSymmetry = header.find("skew-symmetric") != string::npos ? MM_SKEW_SYMMETRIC :
+                (header.find("symmetric") != string::npos ? MM_SYMMETRIC : MM_GENERAL);
+            p = headerEnd;
+            // skip comments and empty lines (only blanks may be left before the end of the file)
+            while (p < end){
+                const char *q = skipBlanks(p, end);
+                if (q < end && *q != '%' && *q != '\n'){
+                    break;
+                }
+                p = nextLine(q, end);
+            }
+            bool ok = parseIndex(p, end, nrow) && parseIndex(p, end, ncol) && parseIndex(p, end, nnz);
+            p = nextLine(p, end);
+            return ok && nrow <= INT32_MAX && ncol <= INT32_MAX;
+        }
+
+        // Moves the parsed entries into a CSC matrix with sorted rows and summed duplicates (the chunks are cleared)
+        template<typename Int>
+        cholmod_sparse *compress(vector<Chunk> &chunks, long nrow, long ncol, size_t entries, Symmetry symmetry, bool pattern){
+            int numberOfChunks = (int)chunks.size();
+            // counting sort by column: count[c][j] becomes the position where chunk c writes its first entry of column j
+            vector<vector<Int>> count(numberOfChunks, vector<Int>(ncol+1, 0));
+#pragma omp parallel for schedule(static, 1)
+            for (int c = 0; c < numberOfChunks; c++){
+                for (int column : chunks[c].columns){
+                    count[c][column]++;
+                }
+            }
+            cholmod_sparse *sparse = OOCHOLMOD_CALL(sizeof(Int) == sizeof(int) ? CHOLMOD_INT : CHOLMOD_LONG, allocate_sparse,
+                                                    nrow, ncol, max<size_t>(entries, 1), true, true, symmetry, CHOLMOD_REAL);
+            Int *Ap = (Int*)sparse->p;
+            Int *Ai = (Int*)sparse->i;
+            double *Ax = (double*)sparse->x;
+            Int position = 0;
+            for (long j = 0; j < ncol; j++){
+                Ap[j] = position;
+                for (int c = 0; c < numberOfChunks; c++){
+                    Int columnCount = count[c][j];
+                    count[c][j] = position;
+                    position += columnCount;
+                }
+            }
+            Ap[ncol] = position;
+#pragma omp parallel for schedule(static, 1)
+            for (int c = 0; c < numberOfChunks; c++){
+                const Chunk &chunk = chunks[c];
+                vector<Int> &next = count[c];
+                for (size_t k = 0; k < chunk.rows.size(); k++){
+                    Int index = next[chunk.columns[k]]++;
+                    Ai[index] = chunk.rows[k];
+                    Ax[index] = pattern ? 1.0 : chunk.values[k];
+                }
+            }
+            chunks.clear();
+            count.clear();
+
+            // sort the rows of each column (already sorted for files written column by column) and sum duplicates
+            vector<Int> columnSize(ncol);
+            bool hasDuplicates = false;
+#pragma omp parallel for schedule(dynamic, 1024) reduction(||:hasDuplicates)
+            for (long j = 0; j < ncol; j++){
+                Int from = Ap[j], to = Ap[j+1];
+                bool sorted = true;
+                for (Int k = from+1; k < to && sorted; k++){
+                    sorted = Ai[k-1] < Ai[k];
+                }
+                if (!sorted){
+                    vector<pair<Int, double>> column(to-from);
+                    for (Int k = from; k < to; k++){
+                        column[k-from] = make_pair(Ai[k], Ax[k]);
+                    }
+                    stable_sort(column.begin(), column.end(),
+                                [](const pair<Int, double> &a, const pair<Int, double> &b){ return a.first < b.first; });
+                    Int size = 0;
+                    for (auto &entry : column){
+                        if (size > 0 && Ai[from+size-1] == entry.first){
+                            Ax[from+size-1] += entry.second;
+                        } else {
+                            Ai[from+size] = entry.first;
+                            Ax[from+size] = entry.second;
+                            size++;
+                        }
+                    }
+                    columnSize[j] = size;
+                    hasDuplicates = hasDuplicates || size != to-from;
+                } else {
+                    columnSize[j] = to-from;
+                }
+            }
+            if (hasDuplicates){
+                Int index = 0;
+                for (long j = 0; j < ncol; j++){
+                    Int from = Ap[j];
+                    Ap[j] = index;
+                    memmove(Ai+index, Ai+from, columnSize[j]*sizeof(Int));
+                    memmove(Ax+index, Ax+from, columnSize[j]*sizeof(double));
+                    index += columnSize[j];
+                }
+                Ap[ncol] = index;
+            }
+            return sparse;
+        }
+    }
+
+    SparseMatrix SparseMatrix::read(const char *name){
+        MappedFile file(name);
+        if (!file.isOpen()){
+            std::cout<<"Cannot open matrix market file "<<name<<"\n";
+            return SparseMatrix();
+        }
+        file.adviseSequential();
+        const char *p = file.begin();
+        const char *end = file.end();
+        bool pattern = false;
+        MatrixMarketSymmetry mmSymmetry = MM_GENERAL;
+        long nrow = 0, ncol = 0, nnz = 0;
+        if (p == end || !readHeader(p, end, pattern, mmSymmetry, nrow, ncol, nnz) ||
+            (mmSymmetry != MM_GENERAL && nrow != ncol)){
+            std::cout<<"Unsupported matrix market file "<<name<<" (only real, integer and pattern coordinate matrices can be read)\n";
+            return SparseMatrix();
+        }
+
+        // split the entries in chunks starting at line boundaries
+        int numberOfChunks = 1;
+#ifdef _OPENMP
+        numberOfChunks = omp_get_max_threads();
+#endif
+        const size_t minChunkSize = 1 << 20;
+        numberOfChunks = (int)max<size_t>(1, min<size_t>(numberOfChunks, (end-p)/minChunkSize));
+        vector<const char*> chunkStart(numberOfChunks+1, end);
+        chunkStart[0] = p;
+        for (int c = 1; c < numberOfChunks; c++){
+            chunkStart[c] = nextLine(max(chunkStart[c-1], p + (end-p)/numberOfChunks*c), end);
+        }
+
+        vector<Chunk> chunks(numberOfChunks);
+#pragma omp parallel for schedule(static, 1)
+        for (int c = 0; c < numberOfChunks; c++){
+            parseChunk(chunkStart[c], chunkStart[c+1], nrow, ncol, pattern, mmSymmetry, chunks[c]);
+        }
+        long lines = 0;
+        for (Chunk &chunk : chunks){
+            if (chunk.failed){
+                std::cout<<"Invalid entry in matrix market file "<<name<<"\n";
+                return SparseMatrix();
+            }
+            lines += chunk.lines;
+        }
+        if (lines != nnz){
+            std::cout<<"Matrix market file "<<name<<" has "<<lines<<" entries, but the header specifies "<<nnz<<"\n";
+            return SparseMatrix();
+        }
+
+        Symmetry symmetry = mmSymmetry == MM_SYMMETRIC ? SYMMETRIC_UPPER : ASYMMETRIC;
+        size_t entries = 0;
+        for (Chunk &chunk : chunks){
+            entries += chunk.rows.size();
+        }
+        // 64 bit indices only when needed, since they double the memory of the row indices
+        cholmod_sparse *sparse = entries > INT32_MAX ?
+            compress<SuiteSparse_long>(chunks, nrow, ncol, entries, symmetry, pattern) :
+            compress<int>(chunks, nrow, ncol, entries, symmetry, pattern);
+        return SparseMatrix(sparse);
+    }
+    
+    void SparseMatrix::writeBinary(const char* name) const {
+        if (!sparse){
+            std::cout<<"No sparse matrix to write - have not been build !\n";
+            return;
+        }
+#ifdef DEBUG
+        assert(sparse->packed);
+#endif
+        BinaryHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+        header.version = binaryVersion;
+        header.byteOrder = binaryByteOrder;
+        header.stype = sparse->stype;
+        header.indexSize = (uint32_t)indexSize();
+        header.nrow = nrow;
+        header.ncol = ncol;
+        header.nnz = indexType == INDEX_LONG ? jColumnLong[ncol] : jColumn[ncol];
+        header.pOffset = alignOffset(sizeof(BinaryHeader));
+        header.iOffset = alignOffset(header.pOffset + (header.ncol+1)*header.indexSize);
+        header.xOffset = alignOffset(header.iOffset + header.nnz*header.indexSize);
+        header.checksum = checksum(sparse->p, (header.ncol+1)*header.indexSize, sparse->i, header.nnz*header.indexSize,
+                                   sparse->x, header.nnz*sizeof(double));
+        
+        FILE *out = fopen(name, "wb");
+        if (!out){
+            std::cout<<"Cannot write "<<name<<"\n";
+            return;
+        }
+        vector<char> padding(binaryAlignment, 0);
+        auto writeAt = [&](uint64_t offset, const void *data, size_t bytes){
+            long position = ftell(out);
+            fwrite(padding.data(), 1, offset - position, out);
+            fwrite(data, 1, bytes, out);
+        };
+        fwrite(&header, sizeof(header), 1, out);
+        writeAt(header.pOffset, sparse->p, (header.ncol+1)*header.indexSize);
+        writeAt(header.iOffset, sparse->i, header.nnz*header.indexSize);
+        writeAt(header.xOffset, sparse->x, header.nnz*sizeof(double));
+        fclose(out);
+    }
+    
+    bool SparseMatrix::verifyBinary(const char* name){
+        MappedFile file(name);
+        file.adviseSequential();
+        const BinaryHeader *header = binaryHeader(file);
+        if (!header){
+            return false;
+        }
+        const char *data = file.begin();
+        bool sorted;
+        return validPattern(header, data, sorted) && header->checksum == checksum(data + header->pOffset, (header->ncol+1)*header->indexSize,
+                                            data + header->iOffset, header->nnz*header->indexSize,
+                                            data + header->xOffset, header->nnz*sizeof(double));
+    }
+    
+    SparseMatrix::SparseMatrix(const std::string& name, MapMode mode)
+    :sparse{nullptr}, triplet{nullptr}, nrow{0}, ncol{1}, values{nullptr}, iRow{nullptr}, jColumn{nullptr},
+    iRowLong{nullptr}, jColumnLong{nullptr}, symmetry{ASYMMETRIC}, indexType{INDEX_INT}, maxTripletElements{0}, mappedFile{nullptr}
+    {
+        MappedFile *file = new MappedFile(name.c_str(), mode == MAP_COPY_ON_WRITE);
+        const BinaryHeader *header = binaryHeader(*file);
+        bool sorted = false;
+        if (!header || !validPattern(header, file->begin(), sorted)){
+            std::cout<<"Cannot map binary matrix file "<<name<<"\n";
+            delete file;
+            return;
+        }
+        mappedFile = file;
+        char *data = file->begin();
+        cholmod_sparse *sparse = new cholmod_sparse();
+        sparse->nrow = header->nrow;
+        sparse->ncol = header->ncol;
+        sparse->nzmax = header->nnz;
+        sparse->p = data + header->pOffset;
+        sparse->i = data + header->iOffset;
+        sparse->x = data + header->xOffset;
+        sparse->nz = nullptr;
+        sparse->z = nullptr;
+        sparse->stype = header->stype;
+        sparse->itype = header->indexSize == sizeof(int) ? CHOLMOD_INT : CHOLMOD_LONG;
+        sparse->xtype = CHOLMOD_REAL;
+        sparse->dtype = CHOLMOD_DOUBLE;
+        sparse->sorted = sorted;
+        sparse->packed = true;
+        setSparse(sparse);
+        nrow = static_cast<unsigned int>(header->nrow);
+        ncol = static_cast<unsigned int>(header->ncol);
+        symmetry = static_cast<Symmetry>(header->stype);
+    }
+}
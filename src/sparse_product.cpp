@@ -0,0 +1,397 @@
+//
+//  sparse_product.cpp
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include <cassert>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "sparse_product.h"
+#include "config_singleton.h"
+
+using namespace std;
+
+namespace oocholmod {
+
+    namespace {
+        // Returns a copy of the columns of M (of M' if transpose) with the index type of M. Both triangular parts of a
+        // symmetric M are included, the rows of each column are sorted and entry k of the copy has the value with
+        // index slots[k] in M. The values of the copy are not set.
+        template<typename Int>
+        cholmod_sparse *copyPattern(const cholmod_sparse *M, bool transpose, vector<long>& slots){
+            const Int *Mp = (const Int*)M->p;
+            const Int *Mi = (const Int*)M->i;
+            long nrow = M->nrow, ncol = M->ncol;
+            bool symmetric = M->stype != 0;
+            transpose = transpose && !symmetric;
+            long columns = transpose ? nrow : ncol;
+            vector<Int> next(columns + 1, 0);
+            for (long j = 0; j < ncol; j++){
+                for (Int k = Mp[j]; k < Mp[j+1]; k++){
+                    long row = Mi[k];
+                    next[(transpose ? row : j) + 1]++;
+                    if (symmetric && row != j){
+                        next[row + 1]++;
+                    }
+                }
+            }
+            for (long c = 0; c < columns; c++){
+                next[c+1] += next[c];
+            }
+            long elements = next[columns];
+            cholmod_sparse *copy = OOCHOLMOD_CALL(M->itype, allocate_sparse, transpose ? ncol : nrow, columns,
+                                                  max<long>(elements, 1), true, true, 0, CHOLMOD_REAL);
+            Int *Cp = (Int*)copy->p;
+            Int *Ci = (Int*)copy->i;
+            std::copy(next.begin(), next.end(), Cp);
+            slots.resize(elements);
+            // the columns of M are visited in increasing order, so the rows of each column of the copy are sorted
+            for (long j = 0; j < ncol; j++){
+                for (Int k = Mp[j]; k < Mp[j+1]; k++){
+                    long row = Mi[k];
+                    Int index = next[transpose ? row : j]++;
+                    Ci[index] = transpose ? j : row;
+                    slots[index] = k;
+                    if (symmetric && row != j){
+                        index = next[row]++;
+                        Ci[index] = j;
+                        slots[index] = k;
+                    }
+                }
+            }
+            return copy;
+        }
+
+        inline int threadNumber(){
+#ifdef _OPENMP
+            return omp_get_thread_num();
+#else
+            return 0;
+#endif
+        }
+    }
+
+    SpGEMMPlan::SpGEMMPlan()
+    :product{NONE}, symmetric{false}, elementsC{0}
+    {
+        A.copy = B.copy = Pt.copy = nullptr;
+        A.elements = B.elements = Pt.elements = 0;
+    }
+
+    SpGEMMPlan::SpGEMMPlan(SpGEMMPlan&& move)
+    :product{move.product}, symmetric{move.symmetric}, A(std::move(move.A)), B(std::move(move.B)), Pt(std::move(move.Pt)),
+    elementsC{move.elementsC}, workspaces{std::move(move.workspaces)}
+    {
+        move.product = NONE;
+        move.A.copy = move.B.copy = move.Pt.copy = nullptr;
+    }
+
+    SpGEMMPlan& SpGEMMPlan::operator=(SpGEMMPlan&& other){
+        if (this != &other){
+            release();
+            product = other.product;
+            symmetric = other.symmetric;
+            A = std::move(other.A);
+            B = std::move(other.B);
+            Pt = std::move(other.Pt);
+            elementsC = other.elementsC;
+            workspaces = std::move(other.workspaces);
+
+            other.product = NONE;
+            other.A.copy = other.B.copy = other.Pt.copy = nullptr;
+        }
+        return *this;
+    }
+
+    SpGEMMPlan::~SpGEMMPlan(){
+        release();
+    }
+
+    void SpGEMMPlan::release(){
+        for (Operand *operand : {&A, &B, &Pt}){
+            if (operand->copy){
+                OOCHOLMOD_CALL(operand->copy->itype, free_sparse, &operand->copy);
+            }
+            operand->copy = nullptr;
+            operand->slots.clear();
+        }
+    }
+
+    bool SpGEMMPlan::isInitialized() const {
+        return product != NONE;
+    }
+
+    void SpGEMMPlan::setOperand(Operand& operand, const SparseMatrix& M, bool transpose){
+        operand.elements = OOCHOLMOD_CALL(M.itype(), nnz, M.sparse);
+        if (!transpose && M.getSymmetry() == ASYMMETRIC){
+            return;
+        }
+        if (M.getIndexType() == INDEX_LONG){
+            operand.copy = copyPattern<SuiteSparse_long>(M.sparse, transpose, operand.slots);
+        } else {
+            operand.copy = copyPattern<int>(M.sparse, transpose, operand.slots);
+        }
+    }
+
+    const cholmod_sparse *SpGEMMPlan::columns(Operand& operand, const SparseMatrix& M){
+        if (!operand.copy){
+            return M.sparse;
+        }
+        const double *Mx = M.values;
+        double *x = (double*)operand.copy->x;
+        long elements = operand.slots.size();
+        const long *slots = operand.slots.data();
+#pragma omp parallel for schedule(static)
+        for (long k = 0; k < elements; k++){
+            x[k] = Mx[slots[k]];
+        }
+        return operand.copy;
+    }
+
+    SparseMatrix SpGEMMPlan::analyze(const SparseMatrix& A, const SparseMatrix& B){
+#ifdef DEBUG
+        assert(A.getMatrixState() == BUILT && B.getMatrixState() == BUILT);
+        assert(A.getColumns() == B.getRows());
+        assert(A.getIndexType() == B.getIndexType());
+        assert(A.sparse->packed && B.sparse->packed);
+#endif
+        release();
+        product = PRODUCT;
+        symmetric = false;
+        setOperand(this->A, A, false);
+        setOperand(this->B, B, false);
+        const cholmod_sparse *a = this->A.copy ? this->A.copy : A.sparse;
+        const cholmod_sparse *b = this->B.copy ? this->B.copy : B.sparse;
+        SparseMatrix res = A.getIndexType() == INDEX_LONG
+            ? symbolic<SuiteSparse_long>(a, b, A.getRows(), B.getColumns(), ASYMMETRIC)
+            : symbolic<int>(a, b, A.getRows(), B.getColumns(), ASYMMETRIC);
+        multiply(A, B, res);
+        return res;
+    }
+
+    SparseMatrix SpGEMMPlan::analyzeGalerkin(const SparseMatrix& P, const SparseMatrix& A){
+#ifdef DEBUG
+        assert(P.getMatrixState() == BUILT && A.getMatrixState() == BUILT);
+        assert(P.getSymmetry() == ASYMMETRIC);
+        assert(A.getRows() == A.getColumns() && A.getColumns() == P.getRows());
+        assert(A.getIndexType() == P.getIndexType());
+        assert(A.sparse->packed && P.sparse->packed);
+#endif
+        release();
+        product = GALERKIN;
+        symmetric = A.getSymmetry() != ASYMMETRIC;
+        setOperand(this->A, A, false);
+        setOperand(B, P, false);
+        setOperand(Pt, P, true);
+        const cholmod_sparse *a = this->A.copy ? this->A.copy : A.sparse;
+        int stype = symmetric ? SYMMETRIC_UPPER : ASYMMETRIC;
+        SparseMatrix res = A.getIndexType() == INDEX_LONG
+            ? symbolic<SuiteSparse_long>(a, P.sparse, P.getColumns(), P.getColumns(), stype)
+            : symbolic<int>(a, P.sparse, P.getColumns(), P.getColumns(), stype);
+        galerkin(P, A, res);
+        return res;
+    }
+
+    void SpGEMMPlan::resetWorkspaces(long n, long nrowC){
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+        workspaces.resize(threads);
+        for (Workspace& ws : workspaces){
+            ws.mark.assign(n, -1);
+            ws.rows.reserve(n);
+            ws.w.resize(n);
+            ws.position.assign(nrowC, -1);
+        }
+    }
+
+    // collects the rows of column j of the result in ws.rows (unsorted) and returns the number of rows. B is P for
+    // the Galerkin product.
+    template<typename Int>
+    long SpGEMMPlan::symbolicColumn(const cholmod_sparse *A, const cholmod_sparse *B, long j, Workspace& ws) const {
+        const Int *Ap = (const Int*)A->p;
+        const Int *Ai = (const Int*)A->i;
+        const Int *Bp = (const Int*)B->p;
+        const Int *Bi = (const Int*)B->i;
+        ws.rows.clear();
+        for (Int q = Bp[j]; q < Bp[j+1]; q++){
+            Int k = Bi[q];
+            for (Int a = Ap[k]; a < Ap[k+1]; a++){
+                long row = Ai[a];
+                if (ws.mark[row] != j){
+                    ws.mark[row] = j;
+                    ws.rows.push_back(row);
+                }
+            }
+        }
+        if (product == PRODUCT){
+            return ws.rows.size();
+        }
+        // the pattern of A*P(:,j) is followed by the rows of P'*(A*P(:,j))
+        const Int *Ptp = (const Int*)Pt.copy->p;
+        const Int *Pti = (const Int*)Pt.copy->i;
+        size_t visited = ws.rows.size();
+        for (size_t r = 0; r < visited; r++){
+            long i = ws.rows[r];
+            for (Int t = Ptp[i]; t < Ptp[i+1]; t++){
+                long c = Pti[t];
+                if (symmetric && c > j){
+                    break; // the rows of P' are sorted
+                }
+                if (ws.position[c] != j){
+                    ws.position[c] = j;
+                    ws.rows.push_back(c);
+                }
+            }
+        }
+        ws.rows.erase(ws.rows.begin(), ws.rows.begin() + visited);
+        return ws.rows.size();
+    }
+
+    template<typename Int>
+    SparseMatrix SpGEMMPlan::symbolic(const cholmod_sparse *A, const cholmod_sparse *B, long nrowC, long ncolC, int stype){
+        long nrowA = A->nrow;
+        resetWorkspaces(nrowA, nrowC);
+        // count the rows of each column, then allocate the result and fill in its rows
+        vector<Int> count(ncolC + 1, 0);
+#pragma omp parallel for schedule(dynamic, 64)
+        for (long j = 0; j < ncolC; j++){
+            count[j+1] = symbolicColumn<Int>(A, B, j, workspaces[threadNumber()]);
+        }
+        for (long j = 0; j < ncolC; j++){
+            count[j+1] += count[j];
+        }
+        elementsC = count[ncolC];
+        int itype = A->itype;
+        cholmod_sparse *sparse = OOCHOLMOD_CALL(itype, allocate_sparse, nrowC, ncolC, max<size_t>(elementsC, 1), true, true, stype,
+                                                CHOLMOD_REAL);
+        Int *Cp = (Int*)sparse->p;
+        Int *Ci = (Int*)sparse->i;
+        std::copy(count.begin(), count.end(), Cp);
+        resetWorkspaces(nrowA, nrowC);
+#pragma omp parallel for schedule(dynamic, 64)
+        for (long j = 0; j < ncolC; j++){
+            Workspace& ws = workspaces[threadNumber()];
+            symbolicColumn<Int>(A, B, j, ws);
+            std::copy(ws.rows.begin(), ws.rows.end(), Ci + Cp[j]);
+            sort(Ci + Cp[j], Ci + Cp[j+1]);
+        }
+        return SparseMatrix(sparse);
+    }
+
+    // B is P for the Galerkin product
+    template<typename Int>
+    void SpGEMMPlan::numeric(const cholmod_sparse *A, const cholmod_sparse *B, cholmod_sparse *C){
+        const Int *Ap = (const Int*)A->p;
+        const Int *Ai = (const Int*)A->i;
+        const double *Ax = (const double*)A->x;
+        const Int *Bp = (const Int*)B->p;
+        const Int *Bi = (const Int*)B->i;
+        const double *Bx = (const double*)B->x;
+        const Int *Cp = (const Int*)C->p;
+        const Int *Ci = (const Int*)C->i;
+        double *Cx = (double*)C->x;
+        long ncolC = C->ncol;
+        // a Workspace per thread (the number of threads may have changed since analyze)
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+        if ((int)workspaces.size() < threads){
+            resetWorkspaces(workspaces[0].mark.size(), workspaces[0].position.size());
+        }
+        for (Workspace& ws : workspaces){
+            fill(ws.mark.begin(), ws.mark.end(), -1);
+        }
+#pragma omp parallel for schedule(dynamic, 64)
+        for (long j = 0; j < ncolC; j++){
+            Workspace& ws = workspaces[threadNumber()];
+            for (Int q = Cp[j]; q < Cp[j+1]; q++){
+                ws.position[Ci[q]] = q;
+                Cx[q] = 0;
+            }
+            if (product == PRODUCT){
+                for (Int q = Bp[j]; q < Bp[j+1]; q++){
+                    Int k = Bi[q];
+                    double bkj = Bx[q];
+                    for (Int a = Ap[k]; a < Ap[k+1]; a++){
+                        Cx[ws.position[Ai[a]]] += Ax[a]*bkj;
+                    }
+                }
+                continue;
+            }
+            // w = A*P(:,j)
+            ws.rows.clear();
+            for (Int q = Bp[j]; q < Bp[j+1]; q++){
+                Int k = Bi[q];
+                double pkj = Bx[q];
+                for (Int a = Ap[k]; a < Ap[k+1]; a++){
+                    long row = Ai[a];
+                    double v = Ax[a]*pkj;
+                    if (ws.mark[row] != j){
+                        ws.mark[row] = j;
+                        ws.w[row] = v;
+                        ws.rows.push_back(row);
+                    } else {
+                        ws.w[row] += v;
+                    }
+                }
+            }
+            // C(:,j) = P'*w
+            const Int *Ptp = (const Int*)Pt.copy->p;
+            const Int *Pti = (const Int*)Pt.copy->i;
+            const double *Ptx = (const double*)Pt.copy->x;
+            for (long i : ws.rows){
+                double wi = ws.w[i];
+                for (Int t = Ptp[i]; t < Ptp[i+1]; t++){
+                    long c = Pti[t];
+                    if (symmetric && c > j){
+                        break; // the rows of P' are sorted
+                    }
+                    Cx[ws.position[c]] += Ptx[t]*wi;
+                }
+            }
+        }
+    }
+
+    void SpGEMMPlan::multiply(const SparseMatrix& A, const SparseMatrix& B, SparseMatrix& C){
+#ifdef DEBUG
+        assert(product == PRODUCT);
+        assert(A.getMatrixState() == BUILT && B.getMatrixState() == BUILT && C.getMatrixState() == BUILT);
+        assert((size_t)OOCHOLMOD_CALL(A.itype(), nnz, A.sparse) == this->A.elements);
+        assert((size_t)OOCHOLMOD_CALL(B.itype(), nnz, B.sparse) == this->B.elements);
+        assert((size_t)OOCHOLMOD_CALL(C.itype(), nnz, C.sparse) == elementsC);
+#endif
+        const cholmod_sparse *a = columns(this->A, A);
+        const cholmod_sparse *b = columns(this->B, B);
+        if (A.getIndexType() == INDEX_LONG){
+            numeric<SuiteSparse_long>(a, b, C.sparse);
+        } else {
+            numeric<int>(a, b, C.sparse);
+        }
+    }
+
+    void SpGEMMPlan::galerkin(const SparseMatrix& P, const SparseMatrix& A, SparseMatrix& C){
+#ifdef DEBUG
+        assert(product == GALERKIN);
+        assert(P.getMatrixState() == BUILT && A.getMatrixState() == BUILT && C.getMatrixState() == BUILT);
+        assert((size_t)OOCHOLMOD_CALL(A.itype(), nnz, A.sparse) == this->A.elements);
+        assert((size_t)OOCHOLMOD_CALL(P.itype(), nnz, P.sparse) == B.elements);
+        assert((size_t)OOCHOLMOD_CALL(C.itype(), nnz, C.sparse) == elementsC);
+#endif
+        const cholmod_sparse *a = columns(this->A, A);
+        columns(Pt, P);
+        if (A.getIndexType() == INDEX_LONG){
+            numeric<SuiteSparse_long>(a, P.sparse, C.sparse);
+        } else {
+            numeric<int>(a, P.sparse, C.sparse);
+        }
+    }
+}
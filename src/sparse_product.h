@@ -0,0 +1,82 @@
+//
+//  sparse_product.h
+//  OOCholmod
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#pragma once
+
+#include <vector>
+
+#include "sparse_matrix.h"
+
+namespace oocholmod {
+
+    /// Products of sparse matrices with fixed patterns. analyze computes the pattern of the product once (the symbolic
+    /// phase) and returns the product. multiply then only computes the values, in parallel over the columns, into the
+    /// matrix returned by analyze. Use it when the values change but the patterns do not, for instance in each
+    /// nonlinear iteration.
+    ///
+    /// The Galerkin product P'AP (the coarse operator of multigrid) is fused: each column is computed from a column of
+    /// AP that is never stored. It is SYMMETRIC_UPPER if A is symmetric (only the upper triangle is computed).
+    class SpGEMMPlan {
+    public:
+        SpGEMMPlan();
+        SpGEMMPlan(SpGEMMPlan&& move);
+        SpGEMMPlan& operator=(SpGEMMPlan&& other);
+        virtual ~SpGEMMPlan();
+
+        /// Computes the pattern of A*B and returns A*B (with the index type of A)
+        SparseMatrix analyze(const SparseMatrix& A, const SparseMatrix& B);
+        /// Computes the values of C = A*B, where C was returned by analyze and A and B have the analyzed patterns
+        void multiply(const SparseMatrix& A, const SparseMatrix& B, SparseMatrix& C);
+
+        /// Computes the pattern of P'AP and returns P'AP (with the index type of A). P must be unsymmetric.
+        SparseMatrix analyzeGalerkin(const SparseMatrix& P, const SparseMatrix& A);
+        /// Computes the values of C = P'AP, where C was returned by analyzeGalerkin and P and A have the analyzed patterns
+        void galerkin(const SparseMatrix& P, const SparseMatrix& A, SparseMatrix& C);
+
+        bool isInitialized() const;
+    private:
+        SpGEMMPlan(const SpGEMMPlan& that) = delete; // prevent copy constructor
+
+        // An operand of the product. Unsymmetric operands are used directly. A symmetric operand (both triangular
+        // parts) and P' of the Galerkin product are copied, and before each product the values of the copy are
+        // gathered from the operand (entry k of the copy has the value with index slots[k] in the operand).
+        struct Operand {
+            cholmod_sparse *copy;       // nullptr if the operand is used directly
+            std::vector<long> slots;
+            size_t elements;            // number of stored elements of the operand
+        };
+        // per thread
+        struct Workspace {
+            std::vector<long> mark;     // mark[i] == j if row i of A*B(:,j) has been visited
+            std::vector<long> rows;     // the visited rows
+            std::vector<double> w;      // column j of A*P (Galerkin product)
+            std::vector<long> position; // entry of row r in column j of the result (or marks in the symbolic phase)
+        };
+        enum Product { NONE, PRODUCT, GALERKIN };
+
+        void release();
+        void setOperand(Operand& operand, const SparseMatrix& M, bool transpose);
+        // the columns of the operand (the copy with the current values of M, or M itself)
+        const cholmod_sparse *columns(Operand& operand, const SparseMatrix& M);
+        template<typename Int>
+        long symbolicColumn(const cholmod_sparse *A, const cholmod_sparse *B, long j, Workspace& ws) const;
+        template<typename Int>
+        SparseMatrix symbolic(const cholmod_sparse *A, const cholmod_sparse *B, long nrowC, long ncolC, int stype);
+        template<typename Int>
+        void numeric(const cholmod_sparse *A, const cholmod_sparse *B, cholmod_sparse *C);
+        void resetWorkspaces(long n, long nrowC);
+
+        Product product;
+        bool symmetric; // only the upper triangle of the result is computed
+        Operand A;
+        Operand B;      // B, or P for the Galerkin product
+        Operand Pt;     // P' for the Galerkin product
+        size_t elementsC;
+        std::vector<Workspace> workspaces;
+    };
+}
@@ -0,0 +1,508 @@
+//
+//  benchmark.cpp
+//  OOCholmod
+//
+//  Benchmark suite for the sparse matrix operations. Every operation is run a number of warm-up
+//  times followed by a number of timed repetitions, and the median and 95th percentile are
+//  reported. Results can be written as JSON to compare builds:
+//
+//      bench [-r repetitions] [-w warmup] [-f matrix-filter] [-o results.json] [-quick]
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 DTU Compute. All rights reserved.
+//  License: LGPL 3.0
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "sparse_matrix.h"
+#include "dense_matrix.h"
+#include "float_sparse_matrix.h"
+#include "factor.h"
+#include "amg.h"
+#include "element_coloring.h"
+#include "config_singleton.h"
+#include "timer.h"
+
+using namespace std;
+using namespace oocholmod;
+
+namespace {
+
+    struct Entry {
+        int row;
+        int column;
+        double value;
+    };
+
+    // A symmetric positive definite test matrix. Only the upper triangular part is stored.
+    struct TestMatrix {
+        string name;
+        int n;
+        vector<Entry> entries;
+    };
+
+    struct Result {
+        string matrix;
+        int n;
+        long nnz;
+        string operation;
+        vector<double> times; // seconds
+        double flops;         // floating point operations per run (0 if not meaningful)
+    };
+
+    struct Options {
+        int repetitions = 10;
+        int warmup = 2;
+        string filter;
+        string jsonFile;
+        bool quick = false;
+    };
+
+    // deterministic pseudo random numbers, so runs of different builds use the same matrices
+    unsigned int nextRandom(unsigned int &state){
+        state = state*1664525u + 1013904223u;
+        return state >> 8;
+    }
+
+    void addDiagonal(TestMatrix &M, double value){
+        for (int i=0;i<M.n;i++){
+            M.entries.push_back({i, i, value});
+        }
+    }
+
+    TestMatrix laplacian2D(int k){
+        TestMatrix M{"laplace2d", k*k, {}};
+        addDiagonal(M, 4);
+        for (int y=0;y<k;y++){
+            for (int x=0;x<k;x++){
+                int i = x + y*k;
+                if (x+1 < k) M.entries.push_back({i, i+1, -1});
+                if (y+1 < k) M.entries.push_back({i, i+k, -1});
+            }
+        }
+        return M;
+    }
+
+    TestMatrix laplacian3D(int k){
+        TestMatrix M{"laplace3d", k*k*k, {}};
+        addDiagonal(M, 6);
+        for (int z=0;z<k;z++){
+            for (int y=0;y<k;y++){
+                for (int x=0;x<k;x++){
+                    int i = x + (y + z*k)*k;
+                    if (x+1 < k) M.entries.push_back({i, i+1, -1});
+                    if (y+1 < k) M.entries.push_back({i, i+k, -1});
+                    if (z+1 < k) M.entries.push_back({i, i+k*k, -1});
+                }
+            }
+        }
+        return M;
+    }
+
+    // random symmetric pattern with perColumn off-diagonal entries above the diagonal, made
+    // positive definite by diagonal dominance
+    TestMatrix randomMatrix(int n, int perColumn){
+        TestMatrix M{"random", n, {}};
+        unsigned int state = 42;
+        vector<double> diagonal(n, 1);
+        for (int j=1;j<n;j++){
+            vector<int> rows;
+            for (int k=0;k<perColumn && k<j;k++){
+                rows.push_back(nextRandom(state) % j);
+            }
+            sort(rows.begin(), rows.end());
+            rows.erase(unique(rows.begin(), rows.end()), rows.end());
+            for (int i : rows){
+                double value = -(nextRandom(state) % 1000 + 1) / 1000.0;
+                M.entries.push_back({i, j, value});
+                diagonal[i] -= value;
+                diagonal[j] -= value;
+            }
+        }
+        for (int i=0;i<n;i++){
+            M.entries.push_back({i, i, diagonal[i]});
+        }
+        return M;
+    }
+
+    TestMatrix bandedMatrix(int n, int bandwidth){
+        TestMatrix M{"banded", n, {}};
+        addDiagonal(M, 2*bandwidth + 1);
+        for (int j=0;j<n;j++){
+            for (int i=max(0, j-bandwidth);i<j;i++){
+                M.entries.push_back({i, j, -1});
+            }
+        }
+        return M;
+    }
+
+    vector<TestMatrix> testMatrices(bool quick){
+        vector<TestMatrix> res;
+        res.push_back(laplacian2D(100));
+        res.push_back(laplacian3D(20));
+        res.push_back(randomMatrix(2000, 4));
+        res.push_back(bandedMatrix(20000, 10));
+        if (!quick){
+            res.push_back(laplacian2D(300));
+            res.push_back(laplacian3D(35));
+            res.push_back(randomMatrix(5000, 4));
+            res.push_back(bandedMatrix(200000, 10));
+        }
+        return res;
+    }
+
+    // Visits the entries in a scattered order (similar to a finite element assembly)
+    vector<int> scatteredOrder(size_t size){
+        vector<int> order(size);
+        size_t stride = 7919; // prime
+        while (size % stride == 0 && size > 1){
+            stride += 2;
+        }
+        for (size_t i=0;i<size;i++){
+            order[i] = (int)((i*stride) % size);
+        }
+        return order;
+    }
+
+    SparseMatrix assemble(const TestMatrix &M, const vector<int> &order){
+        SparseMatrix A{(unsigned int)M.n, (unsigned int)M.n, true, M.entries.size()};
+        for (int k : order){
+            const Entry &e = M.entries[k];
+            A(e.row, e.column) += e.value;
+        }
+        return A;
+    }
+
+    // Runs f (which returns the measured time in seconds) warmup + repetitions times
+    vector<double> repeat(const Options &options, function<double()> f){
+        for (int i=0;i<options.warmup;i++){
+            f();
+        }
+        vector<double> times;
+        for (int i=0;i<options.repetitions;i++){
+            times.push_back(f());
+        }
+        return times;
+    }
+
+    double percentile(vector<double> times, double p){
+        sort(times.begin(), times.end());
+        if (p == 50 && times.size() % 2 == 0){
+            return (times[times.size()/2 - 1] + times[times.size()/2])/2;
+        }
+        // nearest rank
+        size_t rank = (size_t)ceil(p/100 * times.size());
+        return times[max<size_t>(rank, 1) - 1];
+    }
+
+    double gflops(const Result &r){
+        double median = percentile(r.times, 50);
+        return r.flops > 0 && median > 0 ? r.flops/median*1e-9 : 0;
+    }
+
+    void print(const Result &r){
+        cout << setw(10) << r.matrix << setw(9) << r.n << setw(10) << r.nnz << setw(20) << r.operation
+             << fixed << setprecision(3)
+             << setw(12) << percentile(r.times, 50)*1000
+             << setw(12) << percentile(r.times, 95)*1000;
+        if (r.flops > 0){
+            cout << setw(10) << setprecision(2) << gflops(r);
+        }
+        cout << endl;
+    }
+
+    void writeJSON(const string &filename, const Options &options, const vector<Result> &results){
+        ofstream out(filename);
+        out << "{\n  \"repetitions\": " << options.repetitions << ",\n  \"warmup\": " << options.warmup
+            << ",\n  \"benchmarks\": [\n";
+        out << setprecision(9);
+        for (size_t i=0;i<results.size();i++){
+            const Result &r = results[i];
+            out << "    {\"matrix\": \"" << r.matrix << "\", \"n\": " << r.n << ", \"nnz\": " << r.nnz
+                << ", \"operation\": \"" << r.operation << "\""
+                << ", \"median_ms\": " << percentile(r.times, 50)*1000
+                << ", \"p95_ms\": " << percentile(r.times, 95)*1000
+                << ", \"min_ms\": " << *min_element(r.times.begin(), r.times.end())*1000;
+            if (r.flops > 0){
+                out << ", \"gflops\": " << gflops(r);
+            }
+            out << ", \"times_ms\": [";
+            for (size_t j=0;j<r.times.size();j++){
+                out << (j ? ", " : "") << r.times[j]*1000;
+            }
+            out << "]}" << (i+1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    void benchmark(const TestMatrix &M, const Options &options, vector<Result> &results){
+        const vector<int> order = scatteredOrder(M.entries.size());
+        long offDiagonal = 0;
+        for (const Entry &e : M.entries){
+            offDiagonal += e.row != e.column;
+        }
+        const long nnz = M.n + 2*offDiagonal; // of the full symmetric matrix
+        auto add = [&](const string &operation, double flops, function<double()> f){
+            Result r{M.name, M.n, nnz, operation, repeat(options, f), flops};
+            print(r);
+            results.push_back(r);
+        };
+
+        add("assembly", 0, [&]{
+            Timer timer;
+            timer.start();
+            SparseMatrix A = assemble(M, order);
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        add("build", 0, [&]{
+            SparseMatrix A = assemble(M, order);
+            Timer timer;
+            timer.start();
+            A.build();
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        SparseMatrix A = assemble(M, order);
+        A.build();
+
+        add("update", 0, [&]{
+            Timer timer;
+            timer.start();
+            for (int k : order){
+                const Entry &e = M.entries[k];
+                A(e.row, e.column) = e.value;
+            }
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        // Parallel reassembly into the built pattern. Each entry is an element with the dofs row and column that
+        // adds to A(row, column) and to both diagonal entries, so elements sharing a dof conflict (as on a mesh).
+        SparseMatrix B = A.copy();
+        vector<int> elementDofs;
+        for (const Entry &e : M.entries){
+            elementDofs.push_back(e.row);
+            elementDofs.push_back(e.column);
+        }
+        const long elements = (long)M.entries.size();
+        vector<vector<int>> colors = colorElements(elementDofs, 2);
+        
+        add("reassembly", 0, [&]{
+            Timer timer;
+            timer.start();
+            B.zero();
+            for (long k = 0; k < elements; k++){
+                const Entry &e = M.entries[k];
+                B(e.row, e.column) += e.value;
+                B(e.row, e.row) += 0.25;
+                B(e.column, e.column) += 0.25;
+            }
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+        
+        add("reassembly-atomic", 0, [&]{
+            Timer timer;
+            timer.start();
+            B.zero();
+#pragma omp parallel for
+            for (long k = 0; k < elements; k++){
+                const Entry &e = M.entries[k];
+                B.atomicAdd(e.row, e.column, e.value);
+                B.atomicAdd(e.row, e.row, 0.25);
+                B.atomicAdd(e.column, e.column, 0.25);
+            }
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+        
+        add("reassembly-colored", 0, [&]{
+            Timer timer;
+            timer.start();
+            B.zero();
+            assembleColored(colors, [&](int k){
+                const Entry &e = M.entries[k];
+                B.add(e.row, e.column, e.value);
+                B.add(e.row, e.row, 0.25);
+                B.add(e.column, e.column, 0.25);
+            });
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        DenseMatrix x{(unsigned int)M.n, 1, 1.};
+        add("spmv", 2.0*nnz, [&]{
+            Timer timer;
+            timer.start();
+            DenseMatrix y = A * x;
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        FloatSparseMatrix AFloat{A};
+        FloatDenseMatrix xFloat{(unsigned int)M.n, 1, 1.f};
+        add("spmv-float", 2.0*nnz, [&]{
+            Timer timer;
+            timer.start();
+            FloatDenseMatrix y = AFloat * xFloat;
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        add("add", (double)nnz, [&]{
+            Timer timer;
+            timer.start();
+            SparseMatrix B = A + A;
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        add("multiply", 0, [&]{
+            Timer timer;
+            timer.start();
+            SparseMatrix B = A * A;
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        add("analyze", 0, [&]{
+            Timer timer;
+            timer.start();
+            Factor F = A.analyze();
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        Factor F = A.analyze();
+        // flop count and nonzeros of L for the selected ordering
+        double factorFlops = ConfigSingleton::getCommonPtr()->fl;
+        double lnz = ConfigSingleton::getCommonPtr()->lnz;
+        add("factorize", factorFlops, [&]{
+            Timer timer;
+            timer.start();
+            F.factorize(A);
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        add("solve", 4.0*lnz, [&]{
+            Timer timer;
+            timer.start();
+            DenseMatrix y = solve(F, x);
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        DenseMatrix x16{(unsigned int)M.n, 16, 1.};
+        add("solve-16", 64.0*lnz, [&]{
+            Timer timer;
+            timer.start();
+            DenseMatrix y = solve(F, x16);
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        // the same factor stored in single precision
+        Factor FSingle = A.analyze();
+        FSingle.factorize(A, SINGLE_PRECISION);
+        add("solve-single", 4.0*lnz, [&]{
+            Timer timer;
+            timer.start();
+            DenseMatrix y = solve(FSingle, x);
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        add("solve-single-16", 64.0*lnz, [&]{
+            Timer timer;
+            timer.start();
+            DenseMatrix y = solve(FSingle, x16);
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+
+        add("amg-setup", 0, [&]{
+            AMG hierarchy;
+            Timer timer;
+            timer.start();
+            hierarchy.setup(A);
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+        
+        AMG amg;
+        amg.setup(A);
+        add("amg-pcg", 0, [&]{
+            Timer timer;
+            timer.start();
+            DenseMatrix y = solve(amg, x);
+            timer.stop();
+            return timer.getElapsedTimeInSec();
+        });
+    }
+
+    bool parseOptions(int argc, char *argv[], Options &options){
+        for (int i=1;i<argc;i++){
+            string arg = argv[i];
+            bool hasValue = i+1 < argc;
+            if (arg == "-r" && hasValue){
+                options.repetitions = max(1, atoi(argv[++i]));
+            } else if (arg == "-w" && hasValue){
+                options.warmup = max(0, atoi(argv[++i]));
+            } else if (arg == "-f" && hasValue){
+                options.filter = argv[++i];
+            } else if (arg == "-o" && hasValue){
+                options.jsonFile = argv[++i];
+            } else if (arg == "-quick"){
+                options.quick = true;
+            } else {
+                cerr << "Usage: " << argv[0] << " [-r repetitions] [-w warmup] [-f matrix-filter] [-o results.json] [-quick]" << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]){
+    Options options;
+    if (!parseOptions(argc, argv, options)){
+        return 1;
+    }
+#ifdef _OPENMP
+    cout << "OpenMP threads: " << omp_get_max_threads() << endl;
+#else
+    cerr << "Warning: built without OpenMP, the parallel kernels (and reassembly-atomic and reassembly-colored) run "
+            "serially" << endl;
+#endif
+    cout << setw(10) << "matrix" << setw(9) << "n" << setw(10) << "nnz" << setw(20) << "operation"
+         << setw(12) << "median ms" << setw(12) << "p95 ms" << setw(10) << "GFLOP/s" << endl;
+    vector<Result> results;
+    for (const TestMatrix &M : testMatrices(options.quick)){
+        if (M.name.find(options.filter) == string::npos){
+            continue;
+        }
+        benchmark(M, options, results);
+    }
+    if (!options.jsonFile.empty()){
+        writeJSON(options.jsonFile, options, results);
+    }
+    ConfigSingleton::destroy();
+    return 0;
+}
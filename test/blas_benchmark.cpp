@@ -0,0 +1,137 @@
+//
+//  blas_benchmark.cpp
+//  OOCholmod
+//
+//  Measures the built-in BLAS kernels (used when the library is built with NO_BLAS) and,
+//  when compiled with HAVE_CBLAS, compares them with the system cblas (OpenBLAS, ATLAS, ...).
+//
+//  Created by Morten Nobel-Jørgensen / Asger Nyman Christiansen
+//  Copyright (c) 2013 Morten Nobel-Joergensen. All rights reserved.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "oo_blas_kernels.h"
+#include "timer.h"
+
+#ifdef HAVE_CBLAS
+#include <cblas.h>
+#endif
+
+using namespace std;
+using namespace oocholmod;
+
+namespace {
+    vector<double> randomVector(size_t n){
+        vector<double> res(n);
+        for (size_t i = 0; i < n; i++){
+            res[i] = rand()/(double)RAND_MAX - 0.5;
+        }
+        return res;
+    }
+
+    // runs f in batches (long enough for the timer resolution) until at least minTime seconds
+    // have passed and returns the fastest time per call
+    template<typename F>
+    double bestTime(F f, double minTime = 0.2){
+        f(); // warm up
+        int batch = 1;
+        double best = 1e300;
+        double total = 0;
+        int runs = 0;
+        while (total < minTime || runs < 3){
+            Timer timer;
+            timer.start();
+            for (int i = 0; i < batch; i++){
+                f();
+            }
+            timer.stop();
+            double t = timer.getElapsedTimeInSec();
+            total += t;
+            if (t < 1e-3){
+                batch *= 2;
+                continue;
+            }
+            best = min(best, t/batch);
+            runs++;
+        }
+        return best;
+    }
+
+    void report(const char *name, int size, double flops, double kernelTime, double cblasTime){
+        cout << setw(8) << name << setw(10) << size
+             << setw(14) << fixed << setprecision(2) << flops/kernelTime*1e-9;
+        if (cblasTime > 0){
+            cout << setw(14) << flops/cblasTime*1e-9 << setw(10) << setprecision(2) << cblasTime/kernelTime;
+        }
+        cout << endl;
+    }
+
+    double maxDifference(const vector<double> &a, const vector<double> &b){
+        double res = 0;
+        for (size_t i = 0; i < a.size(); i++){
+            res = max(res, fabs(a[i] - b[i]));
+        }
+        return res;
+    }
+}
+
+int main(int argc, char *argv[]){
+    cout << "Built-in kernels use " << (kernels::usesAVX2() ? "AVX2/FMA" : "scalar code") << endl;
+#ifdef HAVE_CBLAS
+    cout << setw(8) << "kernel" << setw(10) << "n" << setw(14) << "GFLOP/s" << setw(14) << "cblas GFLOP/s" << setw(10) << "ratio" << endl;
+#else
+    cout << setw(8) << "kernel" << setw(10) << "n" << setw(14) << "GFLOP/s" << endl;
+#endif
+
+    int vectorSizes[] = {1000, 100000, 10000000};
+    for (int n : vectorSizes){
+        vector<double> x = randomVector(n);
+        vector<double> y = randomVector(n);
+        volatile double sink = 0;
+        double kernelTime = bestTime([&]{ sink = kernels::ddot(n, x.data(), 1, y.data(), 1); });
+        double cblasTime = 0;
+#ifdef HAVE_CBLAS
+        cblasTime = bestTime([&]{ sink = cblas_ddot(n, x.data(), 1, y.data(), 1); });
+#endif
+        report("ddot", n, 2.0*n, kernelTime, cblasTime);
+
+        kernelTime = bestTime([&]{ kernels::daxpy(n, 1e-9, x.data(), 1, y.data(), 1); });
+#ifdef HAVE_CBLAS
+        cblasTime = bestTime([&]{ cblas_daxpy(n, 1e-9, x.data(), 1, y.data(), 1); });
+#endif
+        report("daxpy", n, 2.0*n, kernelTime, cblasTime);
+    }
+
+    int matrixSizes[] = {64, 256, 1024, 2048};
+    for (int n : matrixSizes){
+        vector<double> A = randomVector((size_t)n*n);
+        vector<double> B = randomVector((size_t)n*n);
+        vector<double> x = randomVector(n);
+        vector<double> y(n);
+        double kernelTime = bestTime([&]{ kernels::dgemv(false, n, n, 1.0, A.data(), n, x.data(), 1, 0.0, y.data(), 1); });
+        double cblasTime = 0;
+#ifdef HAVE_CBLAS
+        cblasTime = bestTime([&]{ cblas_dgemv(CblasColMajor, CblasNoTrans, n, n, 1.0, A.data(), n, x.data(), 1, 0.0, y.data(), 1); });
+#endif
+        report("dgemv", n, 2.0*n*n, kernelTime, cblasTime);
+
+        vector<double> C((size_t)n*n);
+        kernelTime = bestTime([&]{ kernels::dgemm(false, false, n, n, n, 1.0, A.data(), n, B.data(), n, 0.0, C.data(), n); });
+#ifdef HAVE_CBLAS
+        vector<double> reference((size_t)n*n);
+        cblasTime = bestTime([&]{ cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, n, n, n, 1.0, A.data(), n, B.data(), n, 0.0, reference.data(), n); });
+        if (maxDifference(C, reference) > 1e-9*n){
+            cerr << "dgemm differs from cblas for n = " << n << endl;
+            return 1;
+        }
+#endif
+        report("dgemm", n, 2.0*n*n*(double)n, kernelTime, cblasTime);
+    }
+    return 0;
+}
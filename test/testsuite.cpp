@@ -12,6 +12,15 @@
 #include "sparse_matrix.h"
 #include "factor.h"
 #include "dense_matrix.h"
+#include "float_sparse_matrix.h"
+#include "dense_factor.h"
+#include "sparse_product.h"
+#include "lu_factor.h"
+#include "element_coloring.h"
+#include "amg.h"
+#include "oo_blas_kernels.h"
+#include "solver_stats.h"
+#include "config_singleton.h"
 #include "timer.h"
 
 using namespace std;
@@ -122,6 +131,124 @@ int SolveDenseDenseTestObj()
     return 1;
 }
 
+int LargeSolveDenseDenseTestObj()
+{
+    // larger than the panel width of the blocked LU fallback, and requiring pivoting
+    int n = 300;
+    DenseMatrix A{n, n};
+    DenseMatrix x{n, 2};
+    for (int j=0;j<n;j++){
+        for (int i=0;i<n;i++){
+            A(i, j) = rand()/(double)RAND_MAX - 0.5;
+        }
+        x(j, 0) = 1;
+        x(j, 1) = cos(j);
+    }
+    DenseMatrix b = A * x;
+    
+    DenseMatrix res = solve(A, b);
+    for (int i=0;i<n*2;i++){
+        TINYTEST_ASSERT(fabs(x.getData()[i] - res.getData()[i]) < 1e-8);
+    }
+    return 1;
+}
+
+int DenseLUTest()
+{
+    DenseMatrix A{3,3, 1.};
+    A(0, 0) = -1;
+    A(0, 1) = 5;
+    A(0, 2) = -3;
+    A(1, 2) = 5;
+    A(2, 0) = -1;
+    
+    DenseMatrix b{3, 2, 1.};
+    b(0) = 6;
+    b(1) = -4;
+    b(2) = 27;
+    
+    DenseLU F;
+    TINYTEST_ASSERT(F.factorize(A));
+    double expected[6] = {-23.8750, -1.0625, 4.1875, -0.5, 0.25, 0.25};
+    for (int i=0;i<3;i++){
+        // solve several times with the same factorization
+        DenseMatrix x = solve(F, b);
+        assertEqual(expected, x.getData(), 6);
+    }
+    F.solveInPlace(b);
+    assertEqual(expected, b.getData(), 6);
+    
+    DenseMatrix singular{2,2, 1.};
+    TINYTEST_ASSERT(!F.factorize(move(singular)));
+    return 1;
+}
+
+int DenseCholeskyTest()
+{
+    DenseMatrix A{3,3, 0.};
+    A(0, 0) = 4;
+    A(1, 1) = 5;
+    A(2, 2) = 6;
+    A(0, 1) = A(1, 0) = 2;
+    A(1, 2) = A(2, 1) = -1;
+    
+    DenseMatrix x{3, 2, 1.};
+    x(1,1) = -3;
+    DenseMatrix b = A * x;
+    
+    DenseCholesky F;
+    TINYTEST_ASSERT(F.factorize(A));
+    DenseMatrix res = solve(F, b);
+    assertEqual(x.getData(), res.getData(), 6);
+    F.solveInPlace(b);
+    assertEqual(x.getData(), b.getData(), 6);
+    
+    A(2, 2) = -6;
+    TINYTEST_ASSERT(!F.factorize(move(A)));
+    return 1;
+}
+
+int BlasKernelsTest()
+{
+    // sizes cross the register tile and the k blocking of the packed dgemm
+    int m = 37, n = 23, k = 300;
+    vector<double> A(m*k), B(k*n), C(m*n), expected(m*n);
+    for (int i = 0; i < m*k; i++) A[i] = sin(i);
+    for (int i = 0; i < k*n; i++) B[i] = cos(i);
+    for (int i = 0; i < m*n; i++) C[i] = i;
+    for (int t = 0; t < 4; t++){
+        bool transA = t & 1;
+        bool transB = t & 2;
+        int lda = transA ? k : m;
+        int ldb = transB ? n : k;
+        for (int j = 0; j < n; j++){
+            for (int i = 0; i < m; i++){
+                double sum = 0;
+                for (int p = 0; p < k; p++){
+                    sum += (transA ? A[i*lda + p] : A[p*lda + i]) * (transB ? B[p*ldb + j] : B[j*ldb + p]);
+                }
+                expected[i + j*m] = 2*sum - 0.5*C[i + j*m];
+            }
+        }
+        vector<double> res = C;
+        kernels::dgemm(transA, transB, m, n, k, 2, A.data(), lda, B.data(), ldb, -0.5, res.data(), m);
+        assertEqual(expected.data(), res.data(), m*n);
+    }
+    
+    vector<double> x(k, 1.0), y(2*m, 1.0);
+    kernels::dgemv(false, m, k, 1, A.data(), m, x.data(), 1, 1, y.data(), 2);
+    for (int i = 0; i < m; i++){
+        double sum = 1;
+        for (int p = 0; p < k; p++) sum += A[p*m + i];
+        TINYTEST_ASSERT(fabs(sum - y[2*i]) < 1e-10);
+        TINYTEST_EQUAL(1.0, y[2*i+1]);
+    }
+    
+    double big[2] = {3e200, 4e200};
+    TINYTEST_ASSERT(fabs(kernels::dnrm2(2, big, 1) - 5e200) < 1e188);
+    return 1;
+}
+
 int SolveSparseDenseTestObj()
 {
     SparseMatrix A{3,3, true};
@@ -207,6 +334,242 @@ int SolveSparseDenseFactorTestObj()
     return 1;
 }
 
+int SinglePrecisionFactorTest()
+{
+    int size = 100;
+    SparseMatrix A{size, size, true};
+    for (int i=0;i<size;i++){
+        A(i, i) = 4;
+        if (i+1 < size){
+            A(i, i+1) = -1;
+        }
+        if (i+7 < size){
+            A(i, i+7) = -1;
+        }
+    }
+    A.build();
+    
+    DenseMatrix b{size, 1, 1.};
+    Factor F = A.analyze();
+    TINYTEST_ASSERT(F.factorize(A, SINGLE_PRECISION));
+    TINYTEST_ASSERT(F.getPrecision() == SINGLE_PRECISION);
+    
+    // single precision solve only has single precision accuracy
+    DenseMatrix x = solve(F, b);
+    DenseMatrix r = b - A * x;
+    TINYTEST_ASSERT(r.norm(0) < 1e-4);
+    
+    RefinementInfo info;
+    DenseMatrix xRefined = solve(F, A, b, &info);
+    TINYTEST_ASSERT(info.converged);
+    TINYTEST_ASSERT(info.iterations > 0);
+    DenseMatrix rRefined = b - A * xRefined;
+    TINYTEST_ASSERT(rRefined.norm(0) < 1e-12);
+    
+    // refactor in double precision
+    TINYTEST_ASSERT(F.factorize(A));
+    TINYTEST_ASSERT(F.getPrecision() == DOUBLE_PRECISION);
+    DenseMatrix xDouble = solve(F, b);
+    for (int i=0;i<size;i++){
+        TINYTEST_ASSERT(fabs(xDouble(i) - xRefined(i)) < 1e-10);
+    }
+
+    // several blocks of right hand sides
+    int columns = 20;
+    DenseMatrix B{size, columns};
+    for (int i=0;i<size;i++){
+        for (int c=0;c<columns;c++){
+            B(i, c) = (i % (c+2)) - 0.5*c;
+        }
+    }
+    DenseMatrix XDouble = solve(F, B);
+    TINYTEST_ASSERT(F.factorize(A, SINGLE_PRECISION));
+    DenseMatrix XSingle = solve(F, B);
+    for (int i=0;i<size;i++){
+        for (int c=0;c<columns;c++){
+            TINYTEST_ASSERT(fabs(XDouble(i, c) - XSingle(i, c)) < 1e-4);
+        }
+    }
+    return 1;
+}
+
+int LongIndexTest()
+{
+    int size = 50;
+    SparseMatrix A{size, size, true};
+    SparseMatrix L{size, size, true, 10, INDEX_LONG}; // small capacity to test the triplet growth
+    for (int i=0;i<size;i++){
+        A(i, i) = 4;
+        L(i, i) = 4;
+        if (i+3 < size){
+            A(i, i+3) = -1;
+            L(i, i+3) = -1;
+        }
+    }
+    A.build();
+    L.build();
+    TINYTEST_ASSERT(A.getIndexType() == INDEX_INT);
+    TINYTEST_ASSERT(L.getIndexType() == INDEX_LONG);
+    TINYTEST_EQUAL(A.getNumberOfElements(), L.getNumberOfElements());
+    TINYTEST_ASSERT(A == L);
+    TINYTEST_ASSERT(A.toDense() == L.toDense());
+    
+    SparseMatrix sum = L + L*2.;
+    TINYTEST_ASSERT(sum.getIndexType() == INDEX_LONG);
+    TINYTEST_EQUAL(-3, sum(0, 3));
+    TINYTEST_EQUAL(A.norm(1), L.norm(1));
+    
+    DenseMatrix b{size, 1, 1.};
+    DenseMatrix x = solve(A, b);
+    Factor F = L.analyze();
+    TINYTEST_ASSERT(F.factorize(L));
+    DenseMatrix xLong = solve(F, b);
+    for (int i=0;i<size;i++){
+        TINYTEST_ASSERT(fabs(x(i) - xLong(i)) < 1e-12);
+    }
+    TINYTEST_ASSERT(F.factorize(L, SINGLE_PRECISION));
+    DenseMatrix xSingle = solve(F, b);
+    TINYTEST_ASSERT((b - L * xSingle).norm(0) < 1e-4);
+    
+    L.writeBinary("long_index_test.csc");
+    SparseMatrix M{"long_index_test.csc", MAP_READ_ONLY};
+    TINYTEST_ASSERT(M.getIndexType() == INDEX_LONG);
+    TINYTEST_ASSERT(M == A);
+    remove("long_index_test.csc");
+    return 1;
+}
+
+int FloatMatrixTest()
+{
+    int size = 40;
+    SparseMatrix A{size, size, true};
+    FloatSparseMatrix B{size, size, true};
+    for (int i=0;i<size;i++){
+        A(i, i) = 4;
+        B(i, i) = 3;
+        B(i, i) += 1; // duplicates are summed
+        if (i+5 < size){
+            A(i, i+5) = -1.5;
+            B(i+5, i) = -1.5; // moved to the upper triangular part
+        }
+    }
+    A.build();
+    B.build();
+    TINYTEST_ASSERT(B.getMatrixState() == BUILT);
+    TINYTEST_EQUAL(A.getNumberOfElements(), B.getNumberOfElements());
+    TINYTEST_EQUAL(-1.5, B(0, 5));
+    TINYTEST_EQUAL(-1.5, B(5, 0));
+    TINYTEST_ASSERT(A == B.toDouble());
+    TINYTEST_ASSERT(B == FloatSparseMatrix(A));
+    
+    vector<float> data(size);
+    for (int i=0;i<size;i++){
+        data[i] = i*0.25f;
+    }
+    FloatDenseMatrix x{size};
+    x.set(data.data());
+    FloatDenseMatrix y = B * x;
+    DenseMatrix yDouble = A * x.toDouble();
+    for (int i=0;i<size;i++){
+        TINYTEST_ASSERT(fabs(y(i) - yDouble(i)) < 1e-5);
+    }
+    TINYTEST_ASSERT(fabs(x.dot(y) - x.toDouble().dot(yDouble)) < 1e-3);
+    
+    Factor F = A.analyze();
+    TINYTEST_ASSERT(F.factorize(B.toDouble()));
+    FloatDenseMatrix z = solve(F, y);
+    z -= x;
+    TINYTEST_ASSERT(z.norm(0) < 1e-5);
+    
+    vector<float> out(size);
+    yDouble.toFloat().get(out.data());
+    TINYTEST_EQUAL(out[3], (float)yDouble(3));
+    
+    // unsymmetric with many elements per row (the parallel chunks of columns), and several right hand sides
+    SparseMatrix C{size, size};
+    for (int j=0;j<size;j++){
+        for (int k=0;k<16;k++){
+            C((j*7 + k*5) % size, j) = 1 + 0.125f*k;
+        }
+    }
+    C.build();
+    FloatSparseMatrix CFloat{C};
+    FloatDenseMatrix X{size, 3, 0.f};
+    for (int i=0;i<size;i++){
+        for (int c=0;c<3;c++){
+            X(i, c) = 0.5f*c + i*0.25f;
+        }
+    }
+    FloatDenseMatrix yc = CFloat * x;
+    DenseMatrix ycDouble = C * x.toDouble();
+    FloatDenseMatrix Y = CFloat * X;
+    DenseMatrix YDouble = C * X.toDouble();
+    for (int i=0;i<size;i++){
+        TINYTEST_ASSERT(fabs(yc(i) - ycDouble(i)) < 1e-3);
+        for (int c=0;c<3;c++){
+            TINYTEST_ASSERT(fabs(Y(i, c) - YDouble(i, c)) < 1e-3);
+        }
+    }
+    return 1;
+}
+
+int SolverStatsTest()
+{
+    SparseMatrix A{3,3, true};
+    A(0, 0) = 4;
+    A(0, 1) = 1;
+    A(1, 1) = 4;
+    A(1, 2) = 1;
+    A(2, 2) = 4;
+    A.build();
+    DenseMatrix b{3, 1, 1.};
+    
+    SolverStats::reset();
+    Factor F = A.analyze();
+    TINYTEST_ASSERT(F.factorize(A));
+    DenseMatrix x = solve(F, b);
+    
+    TINYTEST_EQUAL(1, SolverStats::count("analyze"));
+    TINYTEST_EQUAL(1, SolverStats::count("factorize"));
+    TINYTEST_EQUAL(1, SolverStats::count("solve"));
+    const PhaseStats *factorize = SolverStats::last("factorize");
+    TINYTEST_ASSERT(factorize != nullptr);
+    TINYTEST_EQUAL(3, factorize->n);
+    TINYTEST_ASSERT(factorize->lnz >= 3);
+    TINYTEST_ASSERT(factorize->success);
+    TINYTEST_ASSERT(factorize->duration >= 0);
+    TINYTEST_ASSERT(SolverStats::toJSON().find("\"factorize\"") != string::npos);
+    TINYTEST_ASSERT(SolverStats::toChromeTrace().find("\"ph\": \"X\"") != string::npos);
+    
+    A.zero();
+    TINYTEST_ASSERT(!F.factorize(A));
+    TINYTEST_ASSERT(!SolverStats::last("factorize")->success);
+    
+    SolverStats::setEnabled(false);
+    x = solve(F, b);
+    SolverStats::setEnabled(true);
+    TINYTEST_EQUAL(1, SolverStats::count("solve"));
+    
+    // the peak memory of a call does not include earlier calls, and is kept for an enclosing timer
+    cholmod_common *Common = ConfigSingleton::getCommonPtr(CHOLMOD_INT);
+    size_t peak = Common->memory_inuse + 12345;
+    Common->memory_usage = peak;
+    {
+        ScopedTimer timer("inner");
+    }
+    TINYTEST_EQUAL(Common->memory_inuse, SolverStats::last("inner")->memoryUsage);
+    TINYTEST_EQUAL(peak, Common->memory_usage);
+    
+    // timers finishing on several threads
+#pragma omp parallel for
+    for (int i = 0; i < 1000; i++){
+        ScopedTimer timer(i % 2 ? "odd" : "even");
+    }
+    TINYTEST_EQUAL(500, SolverStats::count("odd"));
+    TINYTEST_EQUAL(500, SolverStats::count("even"));
+    return 1;
+}
+
 int AddSparseSparseTestObj()
 {
     SparseMatrix A(3,3, true);
@@ -726,50 +1089,6 @@ int IndexTest(){
     return 1;
 }
 
-int LargeMatrixPerformance(){
-    Timer timer;
-    
-    int size = 30000;
-    int testSize = 5000;
-    SparseMatrix A{size,size};
-    timer.start();
-    int offsetX = 0;
-    int offsetY = 0;
-    for (int x=0;x<testSize;x++) for (int y=0;y<testSize;y++){
-        // using non linear access to simulate real usage
-        offsetX+=23;
-        offsetX+=47;
-        A((x+offsetX)%size, (y+offsetY)%size) = x+y;
-    }
-    timer.stop();
-    cout <<"Initializing "<<timer.getElapsedTimeInMilliSec()<<endl;
-    timer.start();
-    A.build();
-    timer.stop();
-    cout <<"Building "<<timer.getElapsedTimeInMilliSec()<<endl;
-
-    timer.start();
-    // build index
-    double x = A(0,0);
-    timer.stop();
-    cout <<"Indexing "<<timer.getElapsedTimeInMilliSec()<<endl;
-    
-    // set new values
-    timer.start();
-    offsetX = 0;
-    offsetY = 0;
-    for (int x=0;x<testSize;x++) for (int y=0;y<testSize;y++){
-        // using non linear access to simulate real usage
-        offsetX+=23;
-        offsetX+=47;
-        A((x+offsetX)%size, (y+offsetY)%size) = x+y;
-    }
-    timer.stop();
-    cout <<"Updating "<<timer.getElapsedTimeInMilliSec()<<endl;
-    
-    return 1;
-}
-
 int DropSmallEntriesTest(){
     SparseMatrix A{3,3, true};
     A(0, 0) = 1;
@@ -788,6 +1107,971 @@ int DropSmallEntriesTest(){
     return 1;
 }
 
+int ReadMatrixMarketTest(){
+    SparseMatrix A{4,4, true};
+    A(0, 0) = 1;
+    A(0, 1) = -0.25;
+    A(0, 3) = 1e-20;
+    A(1, 1) = 3.5;
+    A(2, 3) = 123456.789;
+    A(3, 3) = 2;
+    A.build();
+    A.write("read_test.mtx");
+    SparseMatrix B = SparseMatrix::read("read_test.mtx");
+    TINYTEST_ASSERT(B.getMatrixState() == BUILT);
+    TINYTEST_ASSERT(B.getSymmetry() == SYMMETRIC_UPPER);
+    TINYTEST_ASSERT(A == B);
+    
+    // general matrix with comments, unsorted and duplicate entries
+    FILE *file = fopen("read_test.mtx", "w");
+    fprintf(file, "%%%%MatrixMarket matrix coordinate real general\n%% comment\n3 2 4\n3 1 1.5e2\n1 1 -2\n3 1 1\n2 2 .5\n");
+    fclose(file);
+    SparseMatrix C = SparseMatrix::read("read_test.mtx");
+    TINYTEST_ASSERT(C.getSymmetry() == ASYMMETRIC);
+    TINYTEST_EQUAL(3, C.getRows());
+    TINYTEST_EQUAL(2, C.getColumns());
+    TINYTEST_EQUAL(3, C.getNumberOfElements());
+    TINYTEST_EQUAL(-2, C(0, 0));
+    TINYTEST_EQUAL(151, C(2, 0));
+    TINYTEST_EQUAL(0.5, C(1, 1));
+    remove("read_test.mtx");
+    
+    SparseMatrix missing = SparseMatrix::read("missing_file.mtx");
+    TINYTEST_ASSERT(missing.getMatrixState() != BUILT);
+    
+    // only blanks after the header, up to the end of a page (the end of the mapped file must not be read)
+    file = fopen("read_test.mtx", "w");
+    long written = fprintf(file, "%%%%MatrixMarket matrix coordinate real general\n");
+    for (; written < 4096; written++){
+        fputc(' ', file);
+    }
+    fclose(file);
+    SparseMatrix blank = SparseMatrix::read("read_test.mtx");
+    TINYTEST_ASSERT(blank.getMatrixState() != BUILT);
+    remove("read_test.mtx");
+    return 1;
+}
+
+int BinaryMatrixTest(){
+    SparseMatrix A{4,4, true};
+    A(0, 0) = 1;
+    A(0, 1) = -0.25;
+    A(1, 1) = 3.5;
+    A(2, 3) = 123456.789;
+    A(3, 3) = 2;
+    A.build();
+    A.writeBinary("binary_test.csc");
+    TINYTEST_ASSERT(SparseMatrix::verifyBinary("binary_test.csc"));
+    {
+        SparseMatrix B{"binary_test.csc", MAP_READ_ONLY};
+        TINYTEST_ASSERT(B.getMatrixState() == BUILT);
+        TINYTEST_ASSERT(B.getSymmetry() == SYMMETRIC_UPPER);
+        TINYTEST_ASSERT(A == B);
+        
+        SparseMatrix C{"binary_test.csc", MAP_COPY_ON_WRITE};
+        C(1, 1) = 7;
+        TINYTEST_EQUAL(7, C(1, 1));
+        TINYTEST_EQUAL(3.5, B(1, 1));
+        
+        DenseMatrix x{4, 1, 1.};
+        DenseMatrix y = A * x;
+        DenseMatrix z = B * x;
+        TINYTEST_ASSERT(y == z);
+        
+        SparseMatrix moved = std::move(B);
+        TINYTEST_ASSERT(A == moved);
+        
+        // dropping entries copies the mapped matrix to memory
+        SparseMatrix D{"binary_test.csc", MAP_READ_ONLY};
+        D.dropSmallEntries(1);
+        TINYTEST_EQUAL(0, D(0, 1));
+        TINYTEST_EQUAL(3.5, D(1, 1));
+        TINYTEST_EQUAL(-0.25, A(0, 1));
+    }
+    // the copy on write mapping must not change the file
+    TINYTEST_ASSERT(SparseMatrix::verifyBinary("binary_test.csc"));
+    
+    FILE *file = fopen("binary_test.csc", "r+b");
+    fseek(file, -1, SEEK_END);
+    fputc(0x55, file);
+    fclose(file);
+    TINYTEST_ASSERT(!SparseMatrix::verifyBinary("binary_test.csc"));
+    
+    // invalid headers and row indices are rejected when mapping (stype is at byte 16, nnz at 40, pOffset at 48
+    // and iOffset at 56)
+    auto patch = [](long offset, const void *data, size_t bytes){
+        FILE *file = fopen("binary_test.csc", "r+b");
+        fseek(file, offset, SEEK_SET);
+        fwrite(data, 1, bytes, file);
+        fclose(file);
+    };
+    auto headerField = [](long offset){
+        uint64_t value = 0;
+        FILE *file = fopen("binary_test.csc", "rb");
+        fseek(file, offset, SEEK_SET);
+        size_t read = fread(&value, sizeof(value), 1, file);
+        fclose(file);
+        return read == 1 ? value : 0;
+    };
+    auto rejected = [](){
+        SparseMatrix M{"binary_test.csc", MAP_READ_ONLY};
+        return M.getMatrixState() != BUILT && !SparseMatrix::verifyBinary("binary_test.csc");
+    };
+    A.writeBinary("binary_test.csc");
+    int stype = 2;
+    patch(16, &stype, sizeof(stype));
+    TINYTEST_ASSERT(rejected());
+    
+    A.writeBinary("binary_test.csc");
+    long iOffset = headerField(56);
+    int row = 4;
+    patch(iOffset + 2*sizeof(int), &row, sizeof(row));
+    TINYTEST_ASSERT(rejected());
+    row = -1;
+    patch(iOffset + 2*sizeof(int), &row, sizeof(row));
+    TINYTEST_ASSERT(rejected());
+    
+    // nnz*8 overflows to 8, so the arrays would seem to fit in the file
+    SparseMatrix L{4, 4, true, 200, INDEX_LONG};
+    L(0, 0) = 1;
+    L.build();
+    L.writeBinary("binary_test.csc");
+    uint64_t nnz = (uint64_t(1) << 61) + 1;
+    patch(40, &nnz, sizeof(nnz));
+    patch(headerField(48) + 4*sizeof(nnz), &nnz, sizeof(nnz));
+    TINYTEST_ASSERT(rejected());
+    remove("binary_test.csc");
+    
+    SparseMatrix missing{"missing_file.csc", MAP_READ_ONLY};
+    TINYTEST_ASSERT(missing.getMatrixState() != BUILT);
+    TINYTEST_ASSERT(!SparseMatrix::verifyBinary("missing_file.csc"));
+    return 1;
+}
+
+int SubmatrixPartitionTest(){
+    int size = 30;
+    SparseMatrix A{size, size, true};
+    SparseMatrix B{size, size, false, 200, INDEX_LONG};
+    for (int i=0;i<size;i++){
+        A(i, i) = 10 + i;
+        B(i, i) = 10 + i;
+        for (int j : {i+1, i+7}){
+            if (j < size){
+                A(i, j) = -1 - 0.01*(i+j);
+                B(j, i) = -2 - 0.01*(i+j);
+            }
+        }
+    }
+    A.build();
+    B.build();
+    
+    vector<int> rows = {17, 3, 4, 29, 10};
+    vector<int> columns = {3, 10, 11, 0};
+    for (SparseMatrix *M : {&A, &B}){
+        SparseMatrix S = M->submatrix(rows, columns);
+        TINYTEST_EQUAL(rows.size(), S.getRows());
+        TINYTEST_EQUAL(columns.size(), S.getColumns());
+        TINYTEST_ASSERT(S.getSymmetry() == ASYMMETRIC);
+        TINYTEST_ASSERT(S.getIndexType() == M->getIndexType());
+        for (int r=0;r<rows.size();r++){
+            for (int c=0;c<columns.size();c++){
+                TINYTEST_EQUAL((*M)(rows[r], columns[c]), S(r, c));
+            }
+        }
+    }
+    SparseMatrix S = A.submatrix(rows, rows);
+    TINYTEST_ASSERT(S.getSymmetry() == SYMMETRIC_UPPER);
+    for (int r=0;r<rows.size();r++){
+        for (int c=0;c<rows.size();c++){
+            TINYTEST_EQUAL(A(rows[r], rows[c]), S(r, c));
+        }
+    }
+    
+    // interior (0) and interface (1) blocks
+    vector<int> part(size);
+    vector<vector<int>> indices(2);
+    for (int i=0;i<size;i++){
+        part[i] = i%4 == 0 ? 1 : 0;
+        indices[part[i]].push_back(i);
+    }
+    for (SparseMatrix *M : {&A, &B}){
+        vector<SparseMatrix> blocks = M->partition(part, 2);
+        TINYTEST_EQUAL(4, blocks.size());
+        size_t elements = 0;
+        for (int p=0;p<2;p++){
+            for (int q=0;q<2;q++){
+                SparseMatrix &block = blocks[p*2+q];
+                TINYTEST_EQUAL(indices[p].size(), block.getRows());
+                TINYTEST_EQUAL(indices[q].size(), block.getColumns());
+                TINYTEST_ASSERT(block.getSymmetry() == (p == q ? M->getSymmetry() : ASYMMETRIC));
+                TINYTEST_ASSERT(block == M->submatrix(indices[p], indices[q]));
+                elements += block.getNumberOfElements();
+            }
+        }
+        if (M == &B){
+            TINYTEST_EQUAL(B.getNumberOfElements(), elements);
+        }
+    }
+    return 1;
+}
+
+int ConcatenationTest(){
+    int n = 5, m = 2;
+    SparseMatrix K{n, n, true};
+    SparseMatrix B{m, n};
+    for (int i=0;i<n;i++){
+        K(i, i) = 4 + i;
+        if (i+2 < n){
+            K(i, i+2) = -1;
+        }
+        B(i%m, i) = i + 1;
+    }
+    K.build();
+    B.build();
+    
+    SparseMatrix S = saddlePoint(K, B);
+    TINYTEST_ASSERT(S.getSymmetry() == SYMMETRIC_UPPER);
+    TINYTEST_EQUAL(n+m, S.getRows());
+    TINYTEST_EQUAL(K.getNumberOfElements() + B.getNumberOfElements(), S.getNumberOfElements());
+    for (int r=0;r<n+m;r++){
+        for (int c=0;c<n+m;c++){
+            double expected = 0;
+            if (r < n && c < n){
+                expected = K(r, c);
+            } else if (r >= n && c < n){
+                expected = B(r-n, c);
+            } else if (r < n && c >= n){
+                expected = B(c-n, r);
+            }
+            TINYTEST_EQUAL(expected, S(r, c));
+        }
+    }
+    
+    SparseMatrix H = horzcat(K, transposed(B));
+    SparseMatrix V = vertcat(K, B);
+    SparseMatrix D = blockDiag(K, K);
+    SparseMatrix E = blockDiag(B, K);
+    TINYTEST_ASSERT(H.getSymmetry() == ASYMMETRIC);
+    TINYTEST_ASSERT(D.getSymmetry() == SYMMETRIC_UPPER);
+    TINYTEST_ASSERT(E.getSymmetry() == ASYMMETRIC);
+    TINYTEST_EQUAL(n+m, H.getColumns());
+    TINYTEST_EQUAL(n+m, V.getRows());
+    for (int r=0;r<n;r++){
+        for (int c=0;c<n;c++){
+            TINYTEST_EQUAL(K(r, c), H(r, c));
+            TINYTEST_EQUAL(K(r, c), V(r, c));
+            TINYTEST_EQUAL(K(r, c), D(r+n, c+n));
+            TINYTEST_EQUAL(K(r, c), E(r+m, c+n));
+            TINYTEST_EQUAL(0, D(r, c+n));
+            if (r < m){
+                TINYTEST_EQUAL(B(r, c), H(c, r+n));
+                TINYTEST_EQUAL(B(r, c), V(r+n, c));
+                TINYTEST_EQUAL(B(r, c), E(r, c));
+            }
+        }
+    }
+    TINYTEST_ASSERT(H.submatrix({0, 1, 2, 3, 4}, {5, 6}) == transposed(B));
+    return 1;
+}
+
+int ScaleEquilibrateTest(){
+    int size = 6;
+    SparseMatrix A{size, size, true};
+    SparseMatrix B{size, size};
+    for (int i=0;i<size;i++){
+        double s = pow(10., i-2);
+        A(i, i) = 4*s*s;
+        B(i, i) = 4*s;
+        if (i+1 < size){
+            A(i, i+1) = -s*s*10;
+            B(i+1, i) = -1/s;
+        }
+    }
+    A.build();
+    B.build();
+    DenseMatrix original = A.toDense();
+    
+    DenseMatrix rA, cA;
+    for (SparseMatrix *M : {&A, &B}){
+        DenseMatrix before = M->toDense();
+        DenseMatrix r, c;
+        M->equilibrate(r, c);
+        TINYTEST_ASSERT(M->getSymmetry() != SYMMETRIC_UPPER || r == c);
+        DenseMatrix after = M->toDense();
+        for (int i=0;i<size;i++){
+            double rowMax = 0, columnMax = 0;
+            for (int j=0;j<size;j++){
+                TINYTEST_ASSERT(fabs(after(i, j) - r(i)*before(i, j)*c(j)) <= 1e-12*fabs(after(i, j)));
+                rowMax = max(rowMax, fabs(after(i, j)));
+                columnMax = max(columnMax, fabs(after(j, i)));
+            }
+            TINYTEST_ASSERT(rowMax > 0.9 && rowMax < 1.1);
+            TINYTEST_ASSERT(columnMax > 0.9 && columnMax < 1.1);
+        }
+        if (M == &A){
+            rA = r.copy();
+            cA = c.copy();
+        }
+    }
+    
+    // solve with the equilibrated matrix: x = diag(c) (DAD)^-1 diag(r) b
+    DenseMatrix b{size, 1, 1.};
+    Factor F = A.analyze();
+    TINYTEST_ASSERT(F.factorize(A));
+    DenseMatrix rb = b.copy();
+    rb.elemMultiply(rA);
+    DenseMatrix x = solve(F, rb);
+    x.elemMultiply(cA);
+    DenseMatrix residual = original*x - b;
+    TINYTEST_ASSERT(residual.norm(0) < 1e-12*original.norm(0)*x.norm(0));
+    
+    // scale and set the null space in one pass
+    SparseMatrix N{size, size, true};
+    DenseMatrix v{size, 1, 1.};
+    v(1) = 0;
+    v(4) = 0;
+    DenseMatrix d{size};
+    for (int i=0;i<size;i++){
+        N(i, i) = 2;
+        if (i+1 < size){
+            N(i, i+1) = -1;
+        }
+        d(i) = i+1;
+    }
+    N.build();
+    SparseMatrix M = N.copy();
+    N.setNullSpace(v);
+    M.scale(d);
+    for (int i=0;i<size;i++){
+        for (int j=0;j<size;j++){
+            double expected = v(i)*v(j)*(i == j ? 2 : (abs(i-j) == 1 ? -1 : 0));
+            if (i == j && v(i) == 0){
+                expected = 1;
+            }
+            TINYTEST_EQUAL(expected, N(i, j));
+            TINYTEST_EQUAL(d(i)*d(j)*(i == j ? 2 : (abs(i-j) == 1 ? -1 : 0)), M(i, j));
+        }
+    }
+    N.setNullSpace(v, 0.5);
+    TINYTEST_EQUAL(0.5, N(4, 4));
+    return 1;
+}
+
+int DirichletTest(){
+    int size = 8;
+    SparseMatrix A{size, size, true};
+    SparseMatrix B{size, size};
+    for (int i=0;i<size;i++){
+        A(i, i) = 4;
+        B(i, i) = 4;
+        for (int j : {i+1, i+3}){
+            if (j < size){
+                A(i, j) = -1;
+                B(i, j) = -1;
+                B(j, i) = -0.5;
+            }
+        }
+    }
+    A.build();
+    B.build();
+    vector<int> dofs = {5, 0};
+    vector<double> values = {-2, 1};
+    for (SparseMatrix *M : {&A, &B}){
+        DenseMatrix original = M->toDense();
+        size_t elements = M->getNumberOfElements();
+        DenseMatrix b{size, 1, 1.};
+        M->applyDirichlet(dofs, values, b);
+        TINYTEST_EQUAL(elements, M->getNumberOfElements());
+        for (int i=0;i<size;i++){
+            if (i != 0 && i != 5){
+                TINYTEST_EQUAL(0, (*M)(0, i));
+                TINYTEST_EQUAL(0, (*M)(i, 5));
+                TINYTEST_EQUAL(original(i, 2), (*M)(i, 2));
+            }
+        }
+        TINYTEST_EQUAL(1, (*M)(5, 5));
+        DenseMatrix x = M == &A ? solve(A, b) : solve(M->toDense(), b);
+        TINYTEST_ASSERT(fabs(x(5) + 2) < 1e-12);
+        TINYTEST_ASSERT(fabs(x(0) - 1) < 1e-12);
+        DenseMatrix residual = original * x;
+        for (int i=1;i<size;i++){
+            if (i != 5){
+                TINYTEST_ASSERT(fabs(residual(i) - 1) < 1e-12);
+            }
+        }
+    }
+    return 1;
+}
+
+int SymmetrizeExpandTest(){
+    int size = 6;
+    SparseMatrix A{size, size};
+    for (int i=0;i<size;i++){
+        A(i, i) = 4 + i;
+        for (int j : {i+1, i+4}){
+            if (j < size){
+                A(i, j) = -1 - j;
+                A(j, i) = -1 - j;
+            }
+        }
+    }
+    A.build();
+    DenseMatrix dense = A.toDense();
+    size_t elements = A.getNumberOfElements();
+    for (Symmetry storage : {SYMMETRIC_UPPER, SYMMETRIC_LOWER}){
+        SparseMatrix B = A.copy();
+        B.symmetrize(storage);
+        TINYTEST_ASSERT(B.getSymmetry() == storage);
+        TINYTEST_EQUAL((elements + size)/2, B.getNumberOfElements());
+        TINYTEST_ASSERT(dense == B.toDense());
+        B.symmetrize(storage == SYMMETRIC_UPPER ? SYMMETRIC_LOWER : SYMMETRIC_UPPER);
+        TINYTEST_ASSERT(dense == B.toDense());
+        B.expand();
+        TINYTEST_ASSERT(B.getSymmetry() == ASYMMETRIC);
+        TINYTEST_EQUAL(elements, B.getNumberOfElements());
+        TINYTEST_ASSERT(dense == B.toDense());
+    }
+    
+    // large enough to be expanded in several chunks
+    int n = 4000, band = 40;
+    SparseMatrix C{n, n, true};
+    for (int j=0;j<n;j++){
+        for (int i=max(0, j-band);i<=j;i++){
+            C(i, j) = i + 0.5*j;
+        }
+    }
+    C.build();
+    size_t stored = C.getNumberOfElements();
+    C.expand();
+    TINYTEST_EQUAL(2*stored - n, C.getNumberOfElements());
+    for (int j=0;j<n;j+=7){
+        for (int i=max(0, j-band);i<=j;i++){
+            TINYTEST_EQUAL(i + 0.5*j, C(i, j));
+            TINYTEST_EQUAL(i + 0.5*j, C(j, i));
+        }
+    }
+    C.symmetrize();
+    TINYTEST_EQUAL(stored, C.getNumberOfElements());
+    TINYTEST_EQUAL(0.5*(n-1) + n-2, C(n-2, n-1));
+    return 1;
+}
+
+int SparseTransposeTest(){
+    SparseMatrix A{3, 4};
+    A(0, 0) = 1;
+    A(0, 3) = 2;
+    A(1, 1) = 3;
+    A(2, 1) = 4;
+    A(2, 2) = 5;
+    A(1, 3) = 6;
+    A.build();
+    DenseMatrix dense = A.toDense();
+    
+    SparseMatrix T = transposed(A);
+    TINYTEST_EQUAL(4, T.getRows());
+    TINYTEST_EQUAL(3, T.getColumns());
+    TINYTEST_ASSERT(transposed(dense) == T.toDense());
+    
+    // same pattern: the values are gathered into the buffers of T
+    const double *buffer = &T(0, 0);
+    A(2, 1) = -4;
+    A(0, 3) = -2;
+    transposed(A, T);
+    TINYTEST_ASSERT(buffer == &T(0, 0));
+    TINYTEST_EQUAL(-4, T(1, 2));
+    TINYTEST_EQUAL(-2, T(3, 0));
+    TINYTEST_EQUAL(6, T(3, 1));
+
+    // a matrix with the size and number of entries of A but another pattern is transposed in full
+    SparseMatrix D{3, 4};
+    D(0, 0) = 5;
+    D(0, 1) = 1;
+    D(1, 1) = 6;
+    D(1, 2) = 2;
+    D(2, 0) = 3;
+    D(2, 3) = 4;
+    D.build();
+    transposed(D, T);
+    TINYTEST_ASSERT(transposed(D.toDense()) == T.toDense());
+    transposed(A, T);
+    TINYTEST_ASSERT(transposed(A.toDense()) == T.toDense());
+
+    // another pattern is written to the same buffers when they are large enough
+    SparseMatrix B{3, 4};
+    B(1, 0) = 7;
+    B(2, 3) = 8;
+    B.build();
+    transposed(B, T);
+    TINYTEST_ASSERT(buffer == &T(0, 1));
+    TINYTEST_EQUAL(2, T.getNumberOfElements());
+    TINYTEST_ASSERT(transposed(B.toDense()) == T.toDense());
+    
+    A.transpose();
+    TINYTEST_EQUAL(4, A.getRows());
+    TINYTEST_EQUAL(-4, A(1, 2));
+    A.transpose();
+    TINYTEST_EQUAL(3, A.getRows());
+    TINYTEST_EQUAL(-4, A(2, 1));
+    SparseMatrix C = transposed(move(A));
+    TINYTEST_EQUAL(6, C(3, 1));
+
+    // after transpose() the remembered entries refer to the old pattern of T
+    SparseMatrix Dt = transposed(D);
+    T.transpose();
+    transposed(Dt, T);
+    TINYTEST_ASSERT(D.toDense() == T.toDense());
+    return 1;
+}
+
+int SparseMultiplyTest(){
+    SparseMatrix A{3, 4};
+    A(0, 0) = 1;
+    A(0, 3) = 2;
+    A(1, 1) = 3;
+    A(2, 1) = 4;
+    A(2, 2) = 5;
+    A(1, 3) = 6;
+    A.build();
+    DenseMatrix dense = A.toDense();
+    DenseMatrix x{4, 2};
+    DenseMatrix z{3, 2};
+    for (int c=0;c<2;c++){
+        for (int i=0;i<4;i++){
+            x(i, c) = i + 1 - 3*c;
+        }
+        for (int i=0;i<3;i++){
+            z(i, c) = 2*i - c;
+        }
+    }
+    
+    DenseMatrix y{3, 2, 1.};
+    multiply(A, x, y, 2, -1);
+    DenseMatrix expected = dense*x;
+    for (int c=0;c<2;c++){
+        for (int i=0;i<3;i++){
+            TINYTEST_ASSERT(fabs(2*expected(i, c) - 1 - y(i, c)) < 1e-12);
+        }
+    }
+    
+    // transposed into a column of a larger matrix (beta = 0 ignores the values in y)
+    DenseMatrix Y{4, 3, NAN};
+    DenseMatrix column = Y.column(1);
+    multiply(A, z.column(0), column, 1, 0, true);
+    expected = transposed(dense)*z;
+    for (int i=0;i<4;i++){
+        TINYTEST_ASSERT(fabs(expected(i, 0) - Y(i, 1)) < 1e-12);
+    }
+    DenseMatrix w{4, 2, 1.};
+    multiply(A, z, w, 0.5, 3, true);
+    for (int c=0;c<2;c++){
+        for (int i=0;i<4;i++){
+            TINYTEST_ASSERT(fabs(0.5*expected(i, c) + 3 - w(i, c)) < 1e-12);
+        }
+    }
+    
+    SparseMatrix S{3, 3, true};
+    S(0, 0) = 2;
+    S(0, 2) = -1;
+    S(1, 1) = 3;
+    S(2, 2) = 4;
+    S.build();
+    DenseMatrix s{3, 1, 1.};
+    multiply(S, z.column(0), s, 1, 1, true);
+    expected = S.toDense()*z;
+    for (int i=0;i<3;i++){
+        TINYTEST_ASSERT(fabs(expected(i, 0) + 1 - s(i)) < 1e-12);
+    }
+    return 1;
+}
+
+int SpGEMMPlanTest(){
+    int n = 9, coarse = 3;
+    SparseMatrix A{n, n, true};
+    SparseMatrix P{n, coarse};
+    for (int i=0;i<n;i++){
+        A(i, i) = 2 + i;
+        if (i+1 < n){
+            A(i, i+1) = -1;
+        }
+        // piecewise linear interpolation
+        P(i, i/3) = 1;
+        if (i%3 != 1 && i/3 + (i%3 == 2 ? 1 : -1) >= 0 && i/3 + (i%3 == 2 ? 1 : -1) < coarse){
+            P(i, i/3 + (i%3 == 2 ? 1 : -1)) = 0.5;
+        }
+    }
+    A.build();
+    P.build();
+    SparseMatrix B = A.copy();
+    B.expand();
+    
+    SpGEMMPlan plan;
+    TINYTEST_ASSERT(!plan.isInitialized());
+    SparseMatrix AP = plan.analyze(A, P);
+    TINYTEST_ASSERT(plan.isInitialized());
+    TINYTEST_ASSERT(AP == B*P);
+    
+    SpGEMMPlan galerkin;
+    SparseMatrix C = galerkin.analyzeGalerkin(P, A);
+    TINYTEST_ASSERT(C.getSymmetry() == SYMMETRIC_UPPER);
+    DenseMatrix expected = transposed(P.toDense())*(A.toDense()*P.toDense());
+    TINYTEST_ASSERT(C.toDense() == expected);
+    SpGEMMPlan unsymmetric;
+    SparseMatrix D = unsymmetric.analyzeGalerkin(P, B);
+    TINYTEST_ASSERT(D.getSymmetry() == ASYMMETRIC);
+    TINYTEST_ASSERT(D.toDense() == expected);
+    
+    // new values with the same patterns
+    for (int i=0;i<n;i++){
+        A(i, i) = 10 - i;
+        B(i, i) = 10 - i;
+    }
+    P(4, 1) = 2;
+    const double *values = &C(0, 0);
+    plan.multiply(A, P, AP);
+    galerkin.galerkin(P, A, C);
+    unsymmetric.galerkin(P, B, D);
+    TINYTEST_ASSERT(values == &C(0, 0));
+    TINYTEST_ASSERT(AP == B*P);
+    expected = transposed(P.toDense())*(A.toDense()*P.toDense());
+    TINYTEST_ASSERT(C.toDense() == expected);
+    TINYTEST_ASSERT(D.toDense() == expected);
+    return 1;
+}
+
+int AMGTest(){
+    // 2D Poisson problem (5 point stencil)
+    int m = 40, n = m*m;
+    SparseMatrix A{n, n, true};
+    for (int y=0;y<m;y++){
+        for (int x=0;x<m;x++){
+            int i = y*m + x;
+            A(i, i) = 4;
+            if (x+1 < m){
+                A(i, i+1) = -1;
+            }
+            if (y+1 < m){
+                A(i, i+m) = -1;
+            }
+        }
+    }
+    A.build();
+    DenseMatrix b{n, 1};
+    for (int i=0;i<n;i++){
+        b(i) = sin(0.1*i) + 1;
+    }
+    AMGOptions options;
+    options.maxCoarseSize = 50;
+    AMG M;
+    TINYTEST_ASSERT(!M.isInitialized());
+    TINYTEST_ASSERT(M.setup(A, options));
+    TINYTEST_ASSERT(M.getNumberOfLevels() >= 3);
+    const vector<AMGLevelInfo>& levels = M.getLevelInfo();
+    TINYTEST_EQUAL(n, levels[0].rows);
+    for (int l=1;l<M.getNumberOfLevels();l++){
+        TINYTEST_ASSERT(levels[l].rows < levels[l-1].rows);
+    }
+    TINYTEST_ASSERT(levels.back().rows <= 50);
+    
+    RefinementInfo info;
+    DenseMatrix x = solve(M, b, &info, 100, 1e-10);
+    TINYTEST_ASSERT(info.converged);
+    TINYTEST_ASSERT(info.iterations < 40);
+    DenseMatrix exact = solve(A, b);
+    for (int i=0;i<n;i++){
+        TINYTEST_ASSERT(fabs(x(i) - exact(i)) < 1e-6*fabs(exact(i)));
+    }
+    TINYTEST_ASSERT(levels[0].solveTime > 0);
+    M.resetSolveTimes();
+    TINYTEST_EQUAL(0, M.getLevelInfo()[0].solveTime);
+    return 1;
+}
+
+int SelectedInverseTest(){
+    // tridiagonal [-1 2 -1] has determinant n+1
+    int size = 30;
+    SparseMatrix T{size, size, true};
+    for (int i=0;i<size;i++){
+        T(i, i) = 2;
+        if (i+1 < size){
+            T(i, i+1) = -1;
+        }
+    }
+    T.build();
+    Factor FT = T.analyze();
+    TINYTEST_ASSERT(FT.factorize(T));
+    TINYTEST_ASSERT(fabs(FT.logDeterminant() - log(size + 1.)) < 1e-10);
+    Factor FS = T.analyze();
+    TINYTEST_ASSERT(FS.factorize(T, SINGLE_PRECISION));
+    TINYTEST_ASSERT(fabs(FS.logDeterminant() - log(size + 1.)) < 1e-4);
+    
+    // 2D grid (with fill in L)
+    int m = 6, n = m*m;
+    SparseMatrix A{n, n, true};
+    for (int y=0;y<m;y++){
+        for (int x=0;x<m;x++){
+            int i = y*m + x;
+            A(i, i) = 4.5 + 0.1*x;
+            if (x+1 < m){
+                A(i, i+1) = -1;
+            }
+            if (y+1 < m){
+                A(i, i+m) = -1;
+            }
+        }
+    }
+    A.build();
+    Factor F = A.analyze();
+    TINYTEST_ASSERT(F.factorize(A));
+    DenseMatrix identity{n, n, 0.};
+    for (int i=0;i<n;i++){
+        identity(i, i) = 1;
+    }
+    DenseMatrix inverse = solve(F, identity);
+    SparseMatrix Z = selectedInverse(F);
+    TINYTEST_ASSERT(Z.getSymmetry() == SYMMETRIC_UPPER);
+    DenseMatrix d = inverseDiagonal(F);
+    for (int j=0;j<n;j++){
+        TINYTEST_ASSERT(fabs(d(j) - inverse(j, j)) < 1e-12);
+        for (int i=0;i<=j;i++){
+            if (A.hasElement(i, j)){
+                TINYTEST_ASSERT(Z.hasElement(i, j));
+            }
+            if (Z.hasElement(i, j)){
+                TINYTEST_ASSERT(fabs(Z(i, j) - inverse(i, j)) < 1e-12);
+            }
+        }
+    }
+    // log(det(A)) by dense Gaussian elimination
+    double logDet = 0;
+    DenseMatrix Ad = A.toDense();
+    for (int k=0;k<n;k++){
+        // Gaussian elimination without pivoting (A is positive definite)
+        logDet += log(Ad(k, k));
+        for (int i=k+1;i<n;i++){
+            double f = Ad(i, k)/Ad(k, k);
+            for (int j=k;j<n;j++){
+                Ad(i, j) -= f*Ad(k, j);
+            }
+        }
+    }
+    TINYTEST_ASSERT(fabs(F.logDeterminant() - logDet) < 1e-10);
+    return 1;
+}
+
+int LDLTest(){
+    // quasi-definite KKT system [K B'; B -eps*I] with K positive definite (n x n) and B of full row rank (m x n)
+    int n = 25, m = 5, size = n+m;
+    double eps = 1e-3;
+    SparseMatrix A{size, size, true};
+    for (int i=0;i<n;i++){
+        A(i, i) = 4;
+        if (i+1 < n){
+            A(i, i+1) = -1;
+        }
+    }
+    for (int k=0;k<m;k++){
+        for (int i=5*k;i<5*k+5;i++){
+            A(i, n+k) = 1 + 0.1*i; // B(k, i)
+        }
+        A(n+k, n+k) = -eps;
+    }
+    A.build();
+    Factor F = A.analyze(LDLT);
+    TINYTEST_ASSERT(F.getMode() == LDLT);
+    TINYTEST_ASSERT(F.factorize(A));
+    Inertia inertia = F.getInertia();
+    TINYTEST_ASSERT(inertia.positive == n);
+    TINYTEST_ASSERT(inertia.negative == m);
+    TINYTEST_ASSERT(inertia.zero == 0);
+    
+    DenseMatrix b{size, 1, 0.};
+    for (int i=0;i<size;i++){
+        b(i) = 1 + i%3;
+    }
+    DenseMatrix x = solve(F, b);
+    DenseMatrix r{size, 1, 0.};
+    multiply(A, x, r);
+    for (int i=0;i<size;i++){
+        TINYTEST_ASSERT(fabs(r(i) - b(i)) < 1e-10);
+    }
+    
+    // a zero pivot fails the factorization and is reported
+    SparseMatrix S{2, 2, true};
+    S(0, 0) = 1;
+    S(1, 1) = 0;
+    S.build();
+    Factor FS = S.analyze(LDLT);
+    TINYTEST_ASSERT(!FS.factorize(S));
+    inertia = FS.getInertia();
+    TINYTEST_ASSERT(inertia.zero == 1);
+    TINYTEST_ASSERT(inertia.positive <= 1 && inertia.negative == 0);
+    
+    // a positive definite matrix only has positive pivots in both modes
+    std::vector<int> dofs(n);
+    for (int i=0;i<n;i++){
+        dofs[i] = i;
+    }
+    SparseMatrix K = A.submatrix(dofs, dofs);
+    Factor FK = K.analyze();
+    TINYTEST_ASSERT(FK.factorize(K));
+    TINYTEST_ASSERT(FK.getInertia().positive == n);
+    return 1;
+}
+
+int LUFactorTest(){
+    // convection-diffusion matrix (unsymmetric)
+    int n = 40;
+    SparseMatrix A{n, n};
+    for (int i=0;i<n;i++){
+        A(i, i) = 2.5;
+        if (i > 0){
+            A(i, i-1) = -1.5;
+        }
+        if (i+1 < n){
+            A(i, i+1) = -0.5;
+        }
+    }
+    A(0, n-1) = 0.25;
+    A.build();
+    DenseMatrix b{n, 2, 0.};
+    for (int i=0;i<n;i++){
+        b(i, 0) = 1;
+        b(i, 1) = i%5;
+    }
+    LUFactor F;
+    TINYTEST_ASSERT(F.analyze(A));
+    TINYTEST_ASSERT(F.factorize(A));
+    TINYTEST_ASSERT(F.isInitialized());
+    DenseMatrix x = solve(F, b);
+    DenseMatrix r{n, 2, 0.};
+    multiply(A, x, r);
+    for (int i=0;i<n;i++){
+        TINYTEST_ASSERT(fabs(r(i, 0) - b(i, 0)) < 1e-12);
+        TINYTEST_ASSERT(fabs(r(i, 1) - b(i, 1)) < 1e-12);
+    }
+    // the transposed system
+    DenseMatrix xt = b.copy();
+    F.solveInPlace(xt, true);
+    multiply(A, xt, r, 1, 0, true);
+    for (int i=0;i<n;i++){
+        TINYTEST_ASSERT(fabs(r(i, 1) - b(i, 1)) < 1e-12);
+    }
+    
+    // new values with the same pattern reuse the pivots
+    for (int i=0;i<n;i++){
+        A(i, i) = 3 + 0.01*i;
+    }
+    TINYTEST_ASSERT(F.factorize(A));
+    TINYTEST_ASSERT(F.getNumberOfRefactorizations() == 1);
+    TINYTEST_ASSERT(F.getReciprocalCondition() > 0);
+    x = solve(F, b);
+    multiply(A, x, r);
+    for (int i=0;i<n;i++){
+        TINYTEST_ASSERT(fabs(r(i, 0) - b(i, 0)) < 1e-12);
+    }
+    
+    // solve(A, b) of an unsymmetric matrix uses an LU factorization
+    DenseMatrix y = solve(A, b);
+    for (int i=0;i<n;i++){
+        TINYTEST_ASSERT(fabs(y(i, 1) - x(i, 1)) < 1e-12);
+    }
+    
+    // a singular matrix
+    SparseMatrix S{2, 2};
+    S(0, 0) = 1;
+    S(0, 1) = 2;
+    S(1, 0) = 2;
+    S(1, 1) = 4;
+    S.build();
+    LUFactor FS;
+    TINYTEST_ASSERT(FS.analyze(S));
+    TINYTEST_ASSERT(!FS.factorize(S));
+    return 1;
+}
+
+int ParallelAssemblyTest(){
+    // quadrilateral mesh with m x m elements and 4 dofs per element
+    int m = 12, nodes = m+1, n = nodes*nodes;
+    std::vector<int> elementDofs;
+    for (int y=0;y<m;y++){
+        for (int x=0;x<m;x++){
+            int i = x + y*nodes;
+            int dofs[] = {i, i+1, i+nodes, i+nodes+1};
+            elementDofs.insert(elementDofs.end(), dofs, dofs+4);
+        }
+    }
+    int elements = m*m;
+    auto value = [](int e, int a, int b){
+        return (a == b ? 2.0 : -0.5)*(1 + 0.01*e);
+    };
+    SparseMatrix A{n, n, true};
+    for (int e=0;e<elements;e++){
+        for (int a=0;a<4;a++){
+            for (int b=0;b<4;b++){
+                int i = elementDofs[e*4+a], j = elementDofs[e*4+b];
+                if (i <= j){
+                    A(i, j) += value(e, a, b);
+                }
+            }
+        }
+    }
+    A.build();
+    SparseMatrix reference = A.copy();
+    
+    // atomic updates
+    A.zero();
+#pragma omp parallel for
+    for (int e=0;e<elements;e++){
+        for (int a=0;a<4;a++){
+            for (int b=0;b<4;b++){
+                int i = elementDofs[e*4+a], j = elementDofs[e*4+b];
+                if (i <= j){
+                    A.atomicAdd(i, j, value(e, a, b));
+                }
+            }
+        }
+    }
+    for (int j=0;j<n;j++){
+        for (int i=0;i<=j;i++){
+            TINYTEST_ASSERT(fabs(A(i, j) - reference(i, j)) < 1e-12);
+        }
+    }
+    
+    // no element of a color shares a dof with another element of the color
+    std::vector<std::vector<int>> colors = colorElements(elementDofs, 4);
+    TINYTEST_ASSERT(colors.size() == 4);
+    int colored = 0;
+    for (const std::vector<int>& color : colors){
+        std::vector<int> owner(n, -1);
+        for (int e : color){
+            for (int a=0;a<4;a++){
+                TINYTEST_ASSERT(owner[elementDofs[e*4+a]] == -1);
+                owner[elementDofs[e*4+a]] = e;
+            }
+        }
+        colored += color.size();
+    }
+    TINYTEST_ASSERT(colored == elements);
+    
+    A.zero();
+    assembleColored(colors, [&](int e){
+        for (int a=0;a<4;a++){
+            for (int b=0;b<4;b++){
+                int i = elementDofs[e*4+a], j = elementDofs[e*4+b];
+                if (i <= j){
+                    A.add(i, j, value(e, a, b));
+                }
+            }
+        }
+    });
+    for (int j=0;j<n;j++){
+        for (int i=0;i<=j;i++){
+            TINYTEST_ASSERT(fabs(A(i, j) - reference(i, j)) < 1e-12);
+        }
+    }
+    return 1;
+}
+
 int CopyTest(){
     SparseMatrix A{3,3, true};
     A(0, 0) = 1;
@@ -919,6 +2203,156 @@ int DenseSetGetTest(){
     return 1;
 }
 
+int DenseViewTest(){
+    const int rows = 4, cols = 3, ld = 6;
+    vector<double> buffer(ld*cols, -7); // padding rows are -7
+    {
+        DenseMatrix V{buffer.data(), rows, cols, ld};
+        TINYTEST_ASSERT(V.isView());
+        TINYTEST_EQUAL(ld, V.getLeadingDimension());
+        V.fill(1);
+        V(1, 2) = 5;
+        TINYTEST_EQUAL(5, buffer[2*ld + 1]);
+        TINYTEST_EQUAL(-7, buffer[rows]);
+        
+        DenseMatrix W = V.copy();
+        TINYTEST_ASSERT(!W.isView());
+        TINYTEST_ASSERT(V == W);
+        V *= 2;
+        V += W;
+        TINYTEST_EQUAL(15, buffer[2*ld + 1]);
+        TINYTEST_EQUAL(3, V(0, 0));
+        TINYTEST_EQUAL(-7, buffer[ld + rows]);
+        
+        // row 1 of the matrix as a row vector (the elements are ld apart)
+        DenseMatrix row{buffer.data() + 1, 1, cols, ld};
+        TINYTEST_EQUAL(3*3 + 3*3 + 15*15, row.dot(row));
+        TINYTEST_ASSERT(fabs(row.length() - sqrt(243.)) < 1e-12);
+        
+        DenseMatrix x{cols, 1, 1.};
+        DenseMatrix y = V * x;
+        TINYTEST_EQUAL(21, y(1));
+        TINYTEST_EQUAL(9, y(2));
+        
+        vector<double> out(rows*cols);
+        V.get(out.data());
+        TINYTEST_EQUAL(15, out[2*rows + 1]);
+        V.zero();
+        TINYTEST_EQUAL(0, buffer[2*ld + 1]);
+        TINYTEST_EQUAL(-7, buffer[2*ld + rows]);
+    }
+    TINYTEST_EQUAL(-7, buffer[rows]); // the view doesn't free or change the data when destroyed
+    
+    // solves written directly into external memory
+    int size = 5;
+    SparseMatrix A{size, size, true};
+    for (int i=0;i<size;i++){
+        A(i, i) = 4;
+        if (i+1 < size){
+            A(i, i+1) = -1;
+        }
+    }
+    A.build();
+    vector<double> bData(size, 1), xData(size), xPadded(2*size, -7);
+    DenseMatrix b{bData.data(), size};
+    DenseMatrix x{xData.data(), size};
+    DenseMatrix xp{xPadded.data(), size, 1, 2*size};
+    Factor F = A.analyze();
+    TINYTEST_ASSERT(F.factorize(A));
+    solve(F, b, x);
+    solve(F, b, xp);
+    DenseMatrix expected = solve(F, b);
+    TINYTEST_ASSERT(x.isView());
+    for (int i=0;i<size;i++){
+        TINYTEST_ASSERT(fabs(xData[i] - expected(i)) < 1e-12);
+        TINYTEST_ASSERT(fabs(xPadded[i] - expected(i)) < 1e-12);
+    }
+    
+    DenseLU LU;
+    TINYTEST_ASSERT(LU.factorize(A.toDense()));
+    LU.solveInPlace(b);
+    TINYTEST_ASSERT(fabs(bData[2] - expected(2)) < 1e-12);
+    return 1;
+}
+
+int DenseBlockViewTest(){
+    int size = 6;
+    SparseMatrix A{size, size, true};
+    for (int i=0;i<size;i++){
+        A(i, i) = 4;
+        if (i+1 < size){
+            A(i, i+1) = -1;
+        }
+    }
+    A.build();
+    DenseMatrix B{size, 4};
+    for (int c=0;c<4;c++){
+        for (int r=0;r<size;r++){
+            B(r, c) = r + 10*c;
+        }
+    }
+    
+    DenseMatrix middle = B.columnBlock(1, 2);
+    TINYTEST_EQUAL(size, middle.getRows());
+    TINYTEST_EQUAL(2, middle.getColumns());
+    TINYTEST_EQUAL(12, middle(2, 0));
+    TINYTEST_EQUAL(B.column(2).dot(B.column(3)), B.columnBlock(2, 2).column(0).dot(B.column(3)));
+    
+    // multi-RHS solve of a column block into a block of another matrix
+    Factor F = A.analyze();
+    TINYTEST_ASSERT(F.factorize(A));
+    DenseMatrix X{size, 4, 0.};
+    DenseMatrix Xmiddle = X.columnBlock(1, 2);
+    solve(F, middle, Xmiddle);
+    DenseMatrix expected = solve(F, middle.copy());
+    for (int c=0;c<2;c++){
+        TINYTEST_EQUAL(0, X(c*(size-1), 0)); // untouched columns
+        TINYTEST_EQUAL(0, X(c*(size-1), 3));
+        for (int r=0;r<size;r++){
+            TINYTEST_ASSERT(fabs(X(r, c+1) - expected(r, c)) < 1e-12);
+        }
+    }
+    DenseMatrix residual = A * X.columnBlock(1, 2) - middle;
+    TINYTEST_ASSERT(residual.norm(1) < 1e-12);
+    
+    // row and inner blocks in BLAS operations
+    DenseMatrix top = B.rowBlock(0, 2);
+    DenseMatrix product = top * B.block(1, 0, 4, 1);
+    TINYTEST_EQUAL(0*1 + 10*2 + 20*3 + 30*4, product(0));
+    TINYTEST_EQUAL(1*1 + 11*2 + 21*3 + 31*4, product(1));
+    DenseMatrix inner = B.block(2, 1, 3, 2);
+    inner *= -1;
+    TINYTEST_EQUAL(-13, B(3, 1));
+    TINYTEST_EQUAL(1, B(1, 1) - 10);
+    TINYTEST_EQUAL(5, B(5, 0));
+
+    // temporary views are copied before they are overwritten (the matrix is unchanged)
+    DenseMatrix before = B.copy();
+    DenseMatrix doubled = B.column(0) * 2.0;
+    TINYTEST_ASSERT(B == before);
+    TINYTEST_ASSERT(!doubled.isView());
+    TINYTEST_EQUAL(2*B(3, 0), doubled(3));
+    DenseMatrix sum = B.column(1) + B.column(0);
+    DenseMatrix difference = B.column(0) - before.column(1).copy();
+    TINYTEST_ASSERT(B == before);
+    TINYTEST_EQUAL(B(4, 1) + B(4, 0), sum(4));
+    TINYTEST_EQUAL(B(4, 0) - B(4, 1), difference(4));
+    DenseMatrix x = solve(B.block(0, 0, 2, 2), B.block(0, 3, 2, 1));
+    DenseLU LU;
+    TINYTEST_ASSERT(LU.factorize(B.block(0, 0, 2, 2)));
+    DenseMatrix xLU = solve(LU, B.block(0, 3, 2, 1));
+    TINYTEST_ASSERT(B == before);
+    TINYTEST_ASSERT(fabs(x(0) - xLU(0)) < 1e-12 && fabs(x(1) - xLU(1)) < 1e-12);
+    TINYTEST_ASSERT(fabs(B(0, 0)*x(0) + B(0, 1)*x(1) - B(0, 3)) < 1e-12);
+
+    // compound assignments still write through a view
+    DenseMatrix first = B.column(0);
+    first *= 2;
+    first += B.column(1);
+    TINYTEST_EQUAL(2*before(2, 0) + before(2, 1), B(2, 0));
+    return 1;
+}
+
 int SparseToDense(){
     SparseMatrix A{3,3};
     A(0, 0) = 1;
@@ -948,9 +2382,17 @@ TINYTEST_ADD_TEST(BuildSparseTestObj);
 TINYTEST_ADD_TEST(EqualSparseTestObj);
 TINYTEST_ADD_TEST(TestCaseFunctionOperatorObj);
 TINYTEST_ADD_TEST(SolveDenseDenseTestObj);
+TINYTEST_ADD_TEST(LargeSolveDenseDenseTestObj);
+TINYTEST_ADD_TEST(DenseLUTest);
+TINYTEST_ADD_TEST(DenseCholeskyTest);
+TINYTEST_ADD_TEST(BlasKernelsTest);
 TINYTEST_ADD_TEST(SolveSparseDenseTestObj);
 TINYTEST_ADD_TEST(SolveSparseSparseTestObj);
 TINYTEST_ADD_TEST(SolveSparseDenseFactorTestObj);
+TINYTEST_ADD_TEST(SinglePrecisionFactorTest);
+TINYTEST_ADD_TEST(LongIndexTest);
+TINYTEST_ADD_TEST(FloatMatrixTest);
+TINYTEST_ADD_TEST(SolverStatsTest);
 TINYTEST_ADD_TEST(AddSparseSparseTestObj);
 TINYTEST_ADD_TEST(AddDenseDenseTestObj);
 TINYTEST_ADD_TEST(AddEqualDenseDenseTestObj);
@@ -974,14 +2416,30 @@ TINYTEST_ADD_TEST(DynamicTripletGrow);
 TINYTEST_ADD_TEST(IndexTest2);
 TINYTEST_ADD_TEST(IndexTest);
 TINYTEST_ADD_TEST(LargeSparseMatrix);
-TINYTEST_ADD_TEST(LargeMatrixPerformance);
 TINYTEST_ADD_TEST(DropSmallEntriesTest);
 TINYTEST_ADD_TEST(CopyTest);
+TINYTEST_ADD_TEST(SubmatrixPartitionTest);
+TINYTEST_ADD_TEST(ConcatenationTest);
+TINYTEST_ADD_TEST(ScaleEquilibrateTest);
+TINYTEST_ADD_TEST(DirichletTest);
+TINYTEST_ADD_TEST(SymmetrizeExpandTest);
+TINYTEST_ADD_TEST(SparseTransposeTest);
+TINYTEST_ADD_TEST(SparseMultiplyTest);
+TINYTEST_ADD_TEST(SpGEMMPlanTest);
+TINYTEST_ADD_TEST(AMGTest);
+TINYTEST_ADD_TEST(SelectedInverseTest);
+TINYTEST_ADD_TEST(LDLTest);
+TINYTEST_ADD_TEST(LUFactorTest);
+TINYTEST_ADD_TEST(ParallelAssemblyTest);
+TINYTEST_ADD_TEST(ReadMatrixMarketTest);
+TINYTEST_ADD_TEST(BinaryMatrixTest);
 TINYTEST_ADD_TEST(NormTest);
 TINYTEST_ADD_TEST(AppendTest);
 TINYTEST_ADD_TEST(NumberOfElementsTest);
 TINYTEST_ADD_TEST(ZeroTest);
 TINYTEST_ADD_TEST(DenseSetGetTest);
+TINYTEST_ADD_TEST(DenseViewTest);
+TINYTEST_ADD_TEST(DenseBlockViewTest);
 TINYTEST_ADD_TEST(SparseToDense);
 TINYTEST_END_SUITE();
 